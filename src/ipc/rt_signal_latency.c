@@ -0,0 +1,369 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+  #include <sys/netmgr.h>
+#else
+  #include <sys/syscall.h>
+#endif
+
+#define NSEC_PER_SEC      1000000000LL
+#define ITERATIONS        5000
+#define SEND_GAP_NS       200000L    // lets the receiver block again between signals
+#define TIMER_PERIOD_NS   1000000L
+#define MEM_LOAD_BYTES    (32UL << 20)
+#define MAX_LOAD_THREADS  256
+
+enum source { SRC_SIGQUEUE, SRC_THREAD, SRC_TIMER, NUM_SOURCES };
+enum delivery { DLV_WAIT, DLV_HANDLER, NUM_DELIVERIES };
+enum profile { PROF_NONE, PROF_CPU, PROF_MEM, PROF_SYSCALL, NUM_PROFILES };
+
+static const char *source_names[NUM_SOURCES] = { "sigqueue", "pthread_sigqueue", "timer" };
+static const char *delivery_names[NUM_DELIVERIES] = { "sigwaitinfo", "handler" };
+static const char *profile_names[NUM_PROFILES] = { "none", "cpu", "mem", "syscall" };
+
+int sched_policy = SCHED_FIFO;
+
+static int test_signal;
+static enum source source;
+static enum delivery delivery;
+static int iterations = ITERATIONS;
+
+static volatile long long send_ns;          // sender's timestamp for the signal in flight
+static volatile long long handler_ns;       // set by the handler on arrival
+static volatile int load_stop;
+static enum profile load_profile;
+
+static pthread_t receiver_thread;
+#ifdef __QNX__
+static int receiver_tid;
+#else
+static pid_t receiver_tid;
+#endif
+static sem_t receiver_ready, delivered;
+static long long *samples;
+static int num_samples;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+int parse_sched_policy(const char *arg) {
+    if (strcmp(arg, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(arg, "rr") == 0) return SCHED_RR;
+    fprintf(stderr, "Unknown policy: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static void set_rt_priority(int offset) {
+    struct sched_param sp = { .sched_priority = sched_get_priority_max(sched_policy) - offset };
+    int rc = pthread_setschedparam(pthread_self(), sched_policy, &sp);
+    if (rc != 0)
+        fprintf(stderr, "pthread_setschedparam: %s\n", strerror(rc));
+}
+
+static void signal_handler(int sig, siginfo_t *info, void *ctx) {
+    (void)sig; (void)info; (void)ctx;
+    handler_ns = now_ns();
+}
+
+// Interference: one SCHED_OTHER thread per CPU running the selected profile
+static void* load_thread_func(void *arg) {
+    int cpu = (int)(intptr_t)arg;
+    pin_self(cpu);
+    volatile unsigned long counter = 0;
+    char *buf = NULL;
+    if (load_profile == PROF_MEM) {
+        buf = malloc(MEM_LOAD_BYTES);
+        if (!buf) return NULL;
+        memset(buf, 0, MEM_LOAD_BYTES);
+    }
+    while (!load_stop) {
+        switch (load_profile) {
+        case PROF_CPU:
+            counter++;
+            break;
+        case PROF_MEM:
+            for (size_t i = 0; i < MEM_LOAD_BYTES && !load_stop; i += 64)
+                buf[i]++;
+            break;
+        case PROF_SYSCALL:
+            getppid();
+            sched_yield();
+            break;
+        default:
+            return NULL;
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+static int send_to_receiver(void) {
+    union sigval v = { .sival_int = 0 };
+    switch (source) {
+    case SRC_SIGQUEUE:
+        // Process-directed: every other thread blocks the signal, so only
+        // the receiver can take it, but the kernel still has to find it
+        return sigqueue(getpid(), test_signal, v);
+    case SRC_THREAD:
+#ifdef __QNX__
+        return SignalKill(ND_LOCAL_NODE, getpid(), receiver_tid, test_signal, SI_QUEUE, 0);
+#else
+        return pthread_sigqueue(receiver_thread, test_signal, v);
+#endif
+    default:
+        return -1;
+    }
+}
+
+// Waits for the next test signal with the selected delivery; returns the
+// time it was observed by the receiving thread
+static long long receive_signal(const sigset_t *wait_set, const sigset_t *suspend_mask) {
+    if (delivery == DLV_WAIT) {
+        siginfo_t info;
+        while (sigwaitinfo(wait_set, &info) < 0 && errno == EINTR)
+            ;
+        return now_ns();
+    }
+    handler_ns = 0;
+    while (handler_ns == 0)
+        sigsuspend(suspend_mask);
+    return handler_ns;
+}
+
+static int create_thread_timer(timer_t *timer) {
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+#ifdef __QNX__
+    // QNX delivers SIGEV_SIGNAL_THREAD to the thread that created the timer
+    SIGEV_SIGNAL_THREAD_INIT(&sev, test_signal, 0, SI_TIMER);
+#else
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = test_signal;
+    sev._sigev_un._tid = receiver_tid;
+#endif
+    return timer_create(CLOCK_MONOTONIC, &sev, timer);
+}
+
+static void* receiver_func(void *arg) {
+    (void)arg;
+#ifdef __QNX__
+    receiver_tid = pthread_self();
+#else
+    receiver_tid = (pid_t)syscall(SYS_gettid);
+#endif
+    pin_self(0);
+    set_rt_priority(1);
+
+    sigset_t wait_set, suspend_mask;
+    sigemptyset(&wait_set);
+    sigaddset(&wait_set, test_signal);
+    pthread_sigmask(SIG_BLOCK, NULL, &suspend_mask);
+    sigdelset(&suspend_mask, test_signal);
+
+    if (source == SRC_TIMER) {
+        timer_t timer;
+        if (create_thread_timer(&timer) != 0) {
+            perror("timer_create");
+            sem_post(&receiver_ready);
+            return NULL;
+        }
+        long long first = now_ns() + 10 * TIMER_PERIOD_NS;
+        struct itimerspec its = {
+            .it_value = { first / NSEC_PER_SEC, first % NSEC_PER_SEC },
+            .it_interval = { 0, TIMER_PERIOD_NS }
+        };
+        sem_post(&receiver_ready);
+        timer_settime(timer, TIMER_ABSTIME, &its, NULL);
+        long long expected = first;
+        for (int i = 0; i < iterations; i++) {
+            long long t = receive_signal(&wait_set, &suspend_mask);
+            int overrun = timer_getoverrun(timer);
+            if (overrun > 0) expected += (long long)overrun * TIMER_PERIOD_NS;
+            samples[num_samples++] = t - expected;
+            expected += TIMER_PERIOD_NS;
+        }
+        timer_delete(timer);
+        return NULL;
+    }
+
+    sem_post(&receiver_ready);
+    for (int i = 0; i < iterations; i++) {
+        long long t = receive_signal(&wait_set, &suspend_mask);
+        samples[num_samples++] = t - send_ns;
+        sem_post(&delivered);
+    }
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_case(enum source s, enum delivery d, enum profile p) {
+    source = s;
+    delivery = d;
+    load_profile = p;
+    num_samples = 0;
+    load_stop = 0;
+    sem_init(&receiver_ready, 0, 0);
+    sem_init(&delivered, 0, 0);
+
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus > MAX_LOAD_THREADS) ncpus = MAX_LOAD_THREADS;
+    pthread_t loaders[MAX_LOAD_THREADS];
+    int nload = p == PROF_NONE ? 0 : ncpus;
+    // Explicitly SCHED_OTHER: after the first case main itself runs RT and
+    // would otherwise hand its policy down to the load
+    pthread_attr_t load_attr;
+    struct sched_param other = { .sched_priority = 0 };
+    pthread_attr_init(&load_attr);
+    pthread_attr_setinheritsched(&load_attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&load_attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&load_attr, &other);
+    for (int i = 0; i < nload; i++) {
+        if (pthread_create(&loaders[i], &load_attr, load_thread_func, (void *)(intptr_t)i) != 0) {
+            perror("pthread_create load");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_attr_destroy(&load_attr);
+
+    if (pthread_create(&receiver_thread, NULL, receiver_func, NULL) != 0) {
+        perror("pthread_create receiver");
+        exit(EXIT_FAILURE);
+    }
+    sem_wait(&receiver_ready);
+
+    if (s != SRC_TIMER) {
+        // Sender shares the receiver's CPU one priority below it, so every
+        // delivery is a preemption straight into the receiver
+        pin_self(0);
+        set_rt_priority(2);
+        struct timespec gap = { 0, SEND_GAP_NS };
+        for (int i = 0; i < iterations; i++) {
+            nanosleep(&gap, NULL);
+            send_ns = now_ns();
+            if (send_to_receiver() != 0) {
+                perror(source_names[s]);
+                exit(EXIT_FAILURE);
+            }
+            while (sem_wait(&delivered) != 0 && errno == EINTR)
+                ;
+        }
+    }
+    pthread_join(receiver_thread, NULL);
+
+    load_stop = 1;
+    for (int i = 0; i < nload; i++)
+        pthread_join(loaders[i], NULL);
+    sem_destroy(&receiver_ready);
+    sem_destroy(&delivered);
+
+    if (num_samples == 0) {
+        printf("%-17s %-12s %-8s no samples\n", source_names[s], delivery_names[d], profile_names[p]);
+        return;
+    }
+    double sum = 0;
+    for (int i = 0; i < num_samples; i++) sum += samples[i];
+    qsort(samples, num_samples, sizeof(long long), cmp_ll);
+    printf("%-17s %-12s %-8s %8.2f %8.2f %8.2f %8.2f %9.2f %9.2f\n",
+           source_names[s], delivery_names[d], profile_names[p],
+           samples[0] / 1e3, sum / num_samples / 1e3, samples[num_samples / 2] / 1e3,
+           samples[(int)(num_samples * 0.99)] / 1e3, samples[(int)(num_samples * 0.999)] / 1e3,
+           samples[num_samples - 1] / 1e3);
+    fflush(stdout);
+}
+
+static int match(const char *arg, const char **names, int n) {
+    if (!arg || strcmp(arg, "all") == 0) return -1;
+    for (int i = 0; i < n; i++)
+        if (strcmp(arg, names[i]) == 0) return i;
+    fprintf(stderr, "Unknown option: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [fifo|rr] [sigqueue|pthread_sigqueue|timer|all] "
+                "[sigwaitinfo|handler|all] [none|cpu|mem|syscall|all] [iterations=%d]\n",
+                argv[0], ITERATIONS);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1) sched_policy = parse_sched_policy(argv[1]);
+    int only_src = match(argc > 2 ? argv[2] : NULL, source_names, NUM_SOURCES);
+    int only_dlv = match(argc > 3 ? argv[3] : NULL, delivery_names, NUM_DELIVERIES);
+    int only_prof = match(argc > 4 ? argv[4] : NULL, profile_names, NUM_PROFILES);
+    if (argc > 5) {
+        iterations = atoi(argv[5]);
+        if (iterations <= 0) iterations = ITERATIONS;
+    }
+
+    test_signal = SIGRTMIN + 1;
+    samples = malloc(iterations * sizeof(long long));
+    if (!samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall (continuing)");
+
+    // Blocked everywhere from the start; the receiver only opens it in
+    // sigsuspend (handler mode) or takes it synchronously with sigwaitinfo
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, test_signal);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = signal_handler;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(test_signal, &sa, NULL);
+
+    printf("RT signal delivery latency (SIGRTMIN+1, %s, %d signals per case; us)\n",
+           sched_policy == SCHED_FIFO ? "FIFO" : "RR", iterations);
+    printf("%-17s %-12s %-8s %8s %8s %8s %8s %9s %9s\n", "source", "delivery", "load",
+           "min", "mean", "p50", "p99", "p99.9", "max");
+
+    for (int s = 0; s < NUM_SOURCES; s++) {
+        if (only_src >= 0 && s != only_src) continue;
+        for (int d = 0; d < NUM_DELIVERIES; d++) {
+            if (only_dlv >= 0 && d != only_dlv) continue;
+            for (int p = 0; p < NUM_PROFILES; p++) {
+                if (only_prof >= 0 && p != only_prof) continue;
+                run_case((enum source)s, (enum delivery)d, (enum profile)p);
+            }
+        }
+    }
+
+    free(samples);
+    return 0;
+}
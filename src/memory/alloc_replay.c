@@ -0,0 +1,526 @@
+// Replays an alloc_trace recording against malloc or any allocator in
+// allocators.h, as fast as possible, either serially in timestamp order or
+// with one replay thread per recorded thread.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "allocators.h"
+#include "latency_hist.h"
+#include "alloc_trace.h"
+
+#define MAX_REPLAY_THREADS  256      // recorded threads beyond this are folded together
+#define HELD_SAMPLE_EVERY   65536    // mallinfo walks every arena, so malloc is sampled
+#define ARENA_REPLAY_LIMIT  ((size_t)1 << 30)
+#define POOL_REPLAY_LIMIT   ((size_t)1 << 30)
+#define REPLAY_WINDOW       4096     // how far one thread may run ahead of the slowest
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  #define HAVE_MALLINFO2 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+  #define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+  #define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+enum mode { MODE_SERIAL, MODE_THREADS, NUM_MODES };
+static const char *mode_names[NUM_MODES] = { "serial", "threads" };
+
+// A trace event with addresses resolved to dense object numbers
+typedef struct {
+    uint32_t obj;               // object allocated, or freed for TRACE_FREE
+    uint32_t old_obj;           // realloc: object being resized, NO_OBJ if none
+    uint32_t size;
+    uint16_t tid;
+    uint8_t op;
+} replay_op_t;
+
+#define NO_OBJ UINT32_MAX
+
+typedef struct {
+    int id;
+    uint32_t *ops;              // indices into the op array, in timestamp order
+    long nops;
+    allocator_t *alloc;
+    unsigned long alloc_hist[HIST_BUCKETS];
+    unsigned long free_hist[HIST_BUCKETS];
+    size_t peak_held;
+    long long finish_ns;
+    long next_global;           // timeline index of the next op, LONG_MAX when done
+} __attribute__((aligned(64))) replayer_t;
+
+static replay_op_t *ops;
+static long num_ops;
+static uint32_t num_objs;
+static uint32_t *obj_size;
+static void **objs;
+static int num_tids;
+static size_t peak_live, max_size, total_bytes, peak_objs;
+static long unmatched;
+static pthread_barrier_t start_barrier;
+static replayer_t *replayers;
+static int num_replayers;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static size_t malloc_held(void) {
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 mi = mallinfo2();
+    return mi.arena + mi.hblkhd;
+#else
+    struct mallinfo mi = mallinfo();
+    return (size_t)(unsigned)mi.arena + (size_t)(unsigned)mi.hblkhd;
+#endif
+}
+
+// Open-addressing map from live address to object number. Deleted entries
+// become tombstones; the table is sized for every allocation in the trace,
+// so it never fills.
+typedef struct {
+    uint64_t *keys;             // 0 = empty, 1 = tombstone
+    uint32_t *vals;
+    size_t mask;
+} addr_map_t;
+
+static inline size_t addr_hash(uint64_t a) {
+    a ^= a >> 33;
+    a *= 0xff51afd7ed558ccdULL;
+    a ^= a >> 33;
+    return (size_t)a;
+}
+
+static void map_put(addr_map_t *m, uint64_t addr, uint32_t obj) {
+    size_t i = addr_hash(addr) & m->mask, slot = SIZE_MAX;
+    for (; m->keys[i]; i = (i + 1) & m->mask) {
+        if (m->keys[i] == addr) {
+            m->vals[i] = obj;   // address reused without a traced free
+            return;
+        }
+        if (m->keys[i] == 1 && slot == SIZE_MAX) slot = i;
+    }
+    if (slot == SIZE_MAX) slot = i;
+    m->keys[slot] = addr;
+    m->vals[slot] = obj;
+}
+
+static uint32_t map_take(addr_map_t *m, uint64_t addr) {
+    for (size_t i = addr_hash(addr) & m->mask; m->keys[i]; i = (i + 1) & m->mask) {
+        if (m->keys[i] == addr) {
+            m->keys[i] = 1;
+            return m->vals[i];
+        }
+    }
+    return NO_OBJ;
+}
+
+static alloc_trace_record_t *sort_base;
+
+static int cmp_record(const void *a, const void *b) {
+    const alloc_trace_record_t *x = &sort_base[*(const uint32_t *)a];
+    const alloc_trace_record_t *y = &sort_base[*(const uint32_t *)b];
+    if (x->ts_ns != y->ts_ns) return x->ts_ns < y->ts_ns ? -1 : 1;
+    return (*(const uint32_t *)a > *(const uint32_t *)b) - (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+// Sorts the records into one timeline and resolves addresses to objects
+static int load_trace(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(alloc_trace_header_t)) {
+        fprintf(stderr, "%s: not a trace\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    const alloc_trace_header_t *h = map;
+    if (h->magic != ALLOC_TRACE_MAGIC || h->version != ALLOC_TRACE_VERSION ||
+        h->record_size != sizeof(alloc_trace_record_t)) {
+        fprintf(stderr, "%s: bad trace header\n", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    long n = (long)((st.st_size - sizeof(*h)) / sizeof(alloc_trace_record_t));
+    sort_base = (alloc_trace_record_t *)((char *)map + sizeof(*h));
+
+    uint32_t *order = malloc(n * sizeof(uint32_t));
+    ops = malloc(n * sizeof(replay_op_t));
+    obj_size = malloc(n * sizeof(uint32_t));
+    size_t cap = 16;
+    while (cap < 2 * (size_t)n) cap *= 2;
+    addr_map_t m = { calloc(cap, sizeof(uint64_t)), malloc(cap * sizeof(uint32_t)), cap - 1 };
+    if (!order || !ops || !obj_size || !m.keys || !m.vals) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < n; i++) order[i] = (uint32_t)i;
+    qsort(order, n, sizeof(uint32_t), cmp_record);
+
+    size_t live = 0, live_objs = 0;
+    for (long i = 0; i < n; i++) {
+        const alloc_trace_record_t *r = &sort_base[order[i]];
+        replay_op_t *o = &ops[num_ops];
+        o->tid = r->tid;
+        o->size = r->size;
+        o->old_obj = NO_OBJ;
+        o->op = r->op;
+        if (r->tid >= num_tids) num_tids = r->tid + 1;
+
+        if (r->op == TRACE_FREE || (r->op == TRACE_REALLOC && r->addr == 0)) {
+            // free(), or realloc(p, 0) acting as one
+            uint64_t addr = r->op == TRACE_FREE ? r->addr : r->old_addr;
+            uint32_t obj = map_take(&m, addr);
+            if (obj == NO_OBJ) {
+                unmatched++;
+                continue;
+            }
+            o->op = TRACE_FREE;
+            o->obj = obj;
+            live -= obj_size[obj];
+            live_objs--;
+        } else {
+            if (r->op == TRACE_REALLOC && r->old_addr) {
+                o->old_obj = map_take(&m, r->old_addr);
+                if (o->old_obj == NO_OBJ) {
+                    unmatched++;
+                    o->op = TRACE_MALLOC;
+                } else {
+                    live -= obj_size[o->old_obj];
+                    live_objs--;
+                }
+            } else if (r->op == TRACE_REALLOC) {
+                o->op = TRACE_MALLOC;
+            }
+            o->obj = num_objs++;
+            obj_size[o->obj] = r->size;
+            map_put(&m, r->addr, o->obj);
+            live += r->size;
+            live_objs++;
+            total_bytes += r->size;
+            if (r->size > max_size) max_size = r->size;
+            if (live > peak_live) peak_live = live;
+            if (live_objs > peak_objs) peak_objs = live_objs;
+        }
+        num_ops++;
+    }
+
+    free(order);
+    free(m.keys);
+    free(m.vals);
+    munmap(map, st.st_size);
+    return 0;
+}
+
+// Waits for an object allocated by another replay thread to exist
+static inline void *await_obj(uint32_t obj) {
+    void *p;
+    for (int spins = 0; !(p = __atomic_load_n(&objs[obj], __ATOMIC_ACQUIRE)); spins++) {
+        if (spins > 1000) sched_yield();
+        cpu_relax();
+    }
+    return p;
+}
+
+static inline void publish(uint32_t obj, void *p) {
+    if (!p) {
+        fprintf(stderr, "allocation of %u bytes failed during replay\n", obj_size[obj]);
+        exit(EXIT_FAILURE);
+    }
+    *(volatile char *)p = 1;
+    __atomic_store_n(&objs[obj], p, __ATOMIC_RELEASE);
+}
+
+static void replay_op(replayer_t *r, const replay_op_t *o) {
+    allocator_t *a = r->alloc;
+    long long t0, t1;
+    switch (o->op) {
+    case TRACE_MALLOC: {
+        t0 = now_ns();
+        void *p = allocator_alloc(a, o->size);
+        t1 = now_ns();
+        publish(o->obj, p);
+        r->alloc_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+        break;
+    }
+    case TRACE_CALLOC: {
+        t0 = now_ns();
+        void *p;
+        if (a->kind == ALLOC_MALLOC) {
+            p = calloc(1, o->size);
+        } else {
+            p = allocator_alloc(a, o->size);
+            if (p) memset(p, 0, o->size);
+        }
+        t1 = now_ns();
+        publish(o->obj, p);
+        r->alloc_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+        break;
+    }
+    case TRACE_REALLOC: {
+        void *old = await_obj(o->old_obj);
+        t0 = now_ns();
+        void *p;
+        if (a->kind == ALLOC_MALLOC) {
+            p = realloc(old, o->size);
+        } else {
+            // The suite's allocators have no realloc: move like a caller would
+            p = allocator_alloc(a, o->size);
+            if (p) {
+                uint32_t keep = obj_size[o->old_obj] < o->size ? obj_size[o->old_obj] : o->size;
+                memcpy(p, old, keep);
+                allocator_free(a, old);
+            }
+        }
+        t1 = now_ns();
+        objs[o->old_obj] = NULL;
+        publish(o->obj, p);
+        r->alloc_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+        break;
+    }
+    case TRACE_FREE: {
+        void *p = await_obj(o->obj);
+        t0 = now_ns();
+        allocator_free(a, p);
+        t1 = now_ns();
+        objs[o->obj] = NULL;
+        r->free_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static long slowest_replayer(void) {
+    long min = LONG_MAX;
+    for (int t = 0; t < num_replayers; t++) {
+        long g = __atomic_load_n(&replayers[t].next_global, __ATOMIC_ACQUIRE);
+        if (g < min) min = g;
+    }
+    return min;
+}
+
+// Without the window a thread that only allocates would race through its
+// whole list before the threads that free catch up, and the replay would
+// hold far more memory than the program ever did. The slowest thread never
+// waits on the window and everything it depends on comes earlier in the
+// timeline, so this cannot deadlock.
+static void* replayer_function(void *arg) {
+    replayer_t *r = arg;
+    long slowest = 0;
+    pthread_barrier_wait(&start_barrier);
+    for (long i = 0; i < r->nops; i++) {
+        long g = r->ops[i];
+        __atomic_store_n(&r->next_global, g, __ATOMIC_RELEASE);
+        for (int spins = 0; g - slowest > REPLAY_WINDOW; spins++) {
+            slowest = slowest_replayer();
+            if (spins > 1000) sched_yield();
+            cpu_relax();
+        }
+        replay_op(r, &ops[g]);
+        if (r->alloc->kind != ALLOC_MALLOC) {
+            if (r->alloc->footprint > r->peak_held) r->peak_held = r->alloc->footprint;
+        } else if (r->id == 0 && (i & (HELD_SAMPLE_EVERY - 1)) == 0) {
+            size_t held = malloc_held();
+            if (held > r->peak_held) r->peak_held = held;
+        }
+    }
+    __atomic_store_n(&r->next_global, LONG_MAX, __ATOMIC_RELEASE);
+    r->finish_ns = now_ns();
+    return NULL;
+}
+
+static void run(enum allocator_kind kind, enum mode mode) {
+    const char *name = allocator_names[kind];
+    if (kind == ALLOC_ARENA && total_bytes > ARENA_REPLAY_LIMIT) {
+        printf("%-7s %-7s skipped: arena never frees and the trace allocates %.0f MB in total\n",
+               name, mode_names[mode], total_bytes / 1048576.0);
+        return;
+    }
+    // Every pool object is as big as the trace's largest request
+    size_t pool_bytes = peak_objs * alloc_round_up(max_size, ALLOC_ALIGN);
+    if (kind == ALLOC_POOL && pool_bytes > POOL_REPLAY_LIMIT) {
+        printf("%-7s %-7s skipped: %zu live objects of %zu B would need %.0f MB\n",
+               name, mode_names[mode], peak_objs, max_size, pool_bytes / 1048576.0);
+        return;
+    }
+    // One instance for the whole replay; locked when threads share it
+    int locked = mode == MODE_THREADS;
+    size_t slack = mode == MODE_THREADS ? REPLAY_WINDOW * (total_bytes / (num_objs ? num_objs : 1) + TLSF_HEADER) : 0;
+    size_t tlsf_region = 2 * (peak_live + peak_objs * (TLSF_HEADER + ALLOC_ALIGN) + slack) + 4 * max_size + (1 << 20);
+    allocator_t *a = kind == ALLOC_TLSF ? allocator_create_tlsf(tlsf_region, locked)
+                                        : allocator_create(kind, max_size, locked);
+    if (!a) {
+        printf("%-7s %-7s create failed\n", name, mode_names[mode]);
+        return;
+    }
+    memset(objs, 0, (size_t)num_objs * sizeof(void *));
+
+    int nthreads = mode == MODE_SERIAL ? 1 : (num_tids < MAX_REPLAY_THREADS ? num_tids : MAX_REPLAY_THREADS);
+    replayer_t *rs = NULL;
+    if (posix_memalign((void **)&rs, 64, nthreads * sizeof(replayer_t)) == 0)
+        memset(rs, 0, nthreads * sizeof(replayer_t));
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!rs || !tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    // Count first so each replayer's op list is only as long as its share
+    for (long i = 0; i < num_ops; i++)
+        rs[mode == MODE_SERIAL ? 0 : ops[i].tid % nthreads].nops++;
+    for (int t = 0; t < nthreads; t++) {
+        rs[t].id = t;
+        rs[t].alloc = a;
+        rs[t].ops = malloc((rs[t].nops ? rs[t].nops : 1) * sizeof(uint32_t));
+        if (!rs[t].ops) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        rs[t].nops = 0;
+    }
+    for (long i = 0; i < num_ops; i++) {
+        replayer_t *r = &rs[mode == MODE_SERIAL ? 0 : ops[i].tid % nthreads];
+        r->ops[r->nops++] = (uint32_t)i;
+    }
+    for (int t = 0; t < nthreads; t++)
+        rs[t].next_global = rs[t].nops ? rs[t].ops[0] : LONG_MAX;
+    replayers = rs;
+    num_replayers = nthreads;
+
+    pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+    for (int t = 0; t < nthreads; t++) {
+        if (pthread_create(&tids[t], NULL, replayer_function, &rs[t]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_barrier_wait(&start_barrier);
+    long long start = now_ns(), end = start;
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(tids[t], NULL);
+        if (rs[t].finish_ns > end) end = rs[t].finish_ns;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    static unsigned long alloc_merged[HIST_BUCKETS], free_merged[HIST_BUCKETS];
+    memset(alloc_merged, 0, sizeof(alloc_merged));
+    memset(free_merged, 0, sizeof(free_merged));
+    unsigned long na = 0, nf = 0;
+    size_t peak_held = kind == ALLOC_MALLOC ? malloc_held() : 0;
+    for (int t = 0; t < nthreads; t++) {
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            alloc_merged[b] += rs[t].alloc_hist[b];
+            free_merged[b] += rs[t].free_hist[b];
+            na += rs[t].alloc_hist[b];
+            nf += rs[t].free_hist[b];
+        }
+        if (rs[t].peak_held > peak_held) peak_held = rs[t].peak_held;
+        free(rs[t].ops);
+    }
+
+    printf("%-7s %-7s %7d %8.2f %6llu %7llu %8llu %9llu %6llu %7llu %9llu %9.1f %9.1f\n",
+           name, mode_names[mode], nthreads, end > start ? num_ops * 1e3 / (end - start) : 0.0,
+           na ? percentile(alloc_merged, na, 0.50) : 0, na ? percentile(alloc_merged, na, 0.99) : 0,
+           na ? percentile(alloc_merged, na, 0.9999) : 0, hist_max(alloc_merged),
+           nf ? percentile(free_merged, nf, 0.50) : 0, nf ? percentile(free_merged, nf, 0.99) : 0,
+           hist_max(free_merged), peak_live / 1048576.0, peak_held / 1048576.0);
+    fflush(stdout);
+
+    // Whatever the traced program never freed; destroy covers the others
+    if (kind == ALLOC_MALLOC)
+        for (uint32_t i = 0; i < num_objs; i++)
+            free(objs[i]);
+    allocator_destroy(a);
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    free(tids);
+    free(rs);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        fprintf(stderr, "Usage: %s trace_file [malloc|pool|slab|arena|tlsf|all] [serial|threads|all]\n",
+                argv[0]);
+        fprintf(stderr, "  record with: ALLOC_TRACE_FILE=trace LD_PRELOAD=./alloc_trace.so program (writes trace.<pid>)\n");
+        return EXIT_FAILURE;
+    }
+    int only_alloc = -1;
+    if (argc > 2 && strcmp(argv[2], "all") != 0) {
+        only_alloc = allocator_parse(argv[2]);
+        if (only_alloc < 0) {
+            fprintf(stderr, "Unknown allocator: %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+    int only_mode = -1;
+    if (argc > 3 && strcmp(argv[3], "all") != 0) {
+        for (int i = 0; i < NUM_MODES; i++)
+            if (strcmp(argv[3], mode_names[i]) == 0) only_mode = i;
+        if (only_mode < 0) {
+            fprintf(stderr, "Unknown mode: %s\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (load_trace(argv[1]) != 0) return EXIT_FAILURE;
+    if (num_ops == 0) {
+        // e.g. the trace of a shell the traced program exec'd
+        printf("%s: no allocations recorded\n", argv[1]);
+        return 0;
+    }
+    objs = calloc(num_objs ? num_objs : 1, sizeof(void *));
+    if (!objs) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("Replaying %s: %ld ops, %u objects, %d threads, peak live %.1f MB, largest %zu B",
+           argv[1], num_ops, num_objs, num_tids, peak_live / 1048576.0, max_size);
+    if (unmatched) printf(", %ld frees of untraced blocks dropped", unmatched);
+    printf("\nLatency in ns per call (realloc counts as alloc); held: allocator footprint, mallinfo for malloc\n");
+    printf("%-7s %-7s %7s %8s %6s %7s %8s %9s %6s %7s %9s %9s %9s\n", "alloc", "mode", "threads",
+           "Mops/s", "a_p50", "a_p99", "a_p99.99", "a_max", "f_p50", "f_p99", "f_max",
+           "live_MB", "held_MB");
+
+    for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+        if (only_alloc >= 0 && k != only_alloc) continue;
+        for (int md = 0; md < NUM_MODES; md++) {
+            if (only_mode >= 0 && md != only_mode) continue;
+            run((enum allocator_kind)k, (enum mode)md);
+        }
+    }
+
+    free(objs);
+    free(ops);
+    free(obj_size);
+    return 0;
+}
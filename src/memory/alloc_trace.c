@@ -0,0 +1,343 @@
+// LD_PRELOAD allocation recorder. Build and use:
+//
+//   gcc -O2 -shared -fPIC -o alloc_trace.so alloc_trace.c -ldl -pthread
+//   ALLOC_TRACE_FILE=svc.trace LD_PRELOAD=./alloc_trace.so ./service
+//   ./alloc_replay svc.trace.<pid>
+//
+// LD_PRELOAD is inherited, so every process the service execs is traced as
+// well; each writes its own <file>.<pid>. A fork()ed child that does not exec
+// stops tracing: its heap is the parent's, already in the parent's trace.
+//
+// Every malloc/calloc/realloc/free (and the aligned variants, recorded as
+// malloc) becomes a 32-byte record in a per-thread buffer; full buffers are
+// appended to the trace with one write(). The hot path is a clock read and a
+// store, with no locks and no allocation. Replay with alloc_replay.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+#include "alloc_trace.h"
+
+#define BUFFER_RECORDS  4096
+#define MAX_TRACED_THREADS 4096
+#define BOOTSTRAP_BYTES (64 * 1024)
+
+#define TLS __thread __attribute__((tls_model("initial-exec")))
+
+typedef struct {
+    alloc_trace_record_t rec[BUFFER_RECORDS];
+    int count;
+    int tid;
+    int registered;
+    int busy;                   // inside record(); trace_fini waits it out
+} thread_buffer_t;
+
+static TLS thread_buffer_t buffer;
+static TLS int in_hook;
+
+static int trace_fd = -1;
+static uint64_t start_ns;
+static int next_tid;
+static pthread_key_t exit_key;
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+// Buffers of live threads, flushed at process exit. Entries are added and
+// removed under write_lock, and a buffer is only touched by other threads
+// while it is held, so an exiting thread cannot free one from under them.
+static thread_buffer_t *live_buffers[MAX_TRACED_THREADS];
+static int stopping;            // set by trace_fini; record() drops events from then on
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void *__libc_memalign(size_t, size_t);
+extern void __libc_free(void *);
+#define real_malloc   __libc_malloc
+#define real_calloc   __libc_calloc
+#define real_realloc  __libc_realloc
+#define real_memalign __libc_memalign
+#define real_free     __libc_free
+#else
+// dlsym itself may allocate before the real functions are known; those early
+// requests are served from a static buffer that is never freed
+static void *(*next_malloc)(size_t);
+static void *(*next_calloc)(size_t, size_t);
+static void *(*next_realloc)(void *, size_t);
+static int (*next_posix_memalign)(void **, size_t, size_t);
+static void (*next_free)(void *);
+static char bootstrap[BOOTSTRAP_BYTES] __attribute__((aligned(16)));
+static size_t bootstrap_used;
+static int resolving;
+
+static void *bootstrap_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (bootstrap_used + size > sizeof(bootstrap)) return NULL;
+    void *p = bootstrap + bootstrap_used;
+    bootstrap_used += size;
+    return p;
+}
+
+static int is_bootstrap(void *p) {
+    return (char *)p >= bootstrap && (char *)p < bootstrap + sizeof(bootstrap);
+}
+
+static void resolve(void) {
+    if (next_free || resolving) return;
+    resolving = 1;
+    next_malloc = dlsym(RTLD_NEXT, "malloc");
+    next_calloc = dlsym(RTLD_NEXT, "calloc");
+    next_realloc = dlsym(RTLD_NEXT, "realloc");
+    next_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    next_free = dlsym(RTLD_NEXT, "free");
+    resolving = 0;
+}
+
+static void *real_malloc(size_t size) {
+    resolve();
+    return next_malloc ? next_malloc(size) : bootstrap_alloc(size);
+}
+
+static void *real_calloc(size_t n, size_t size) {
+    resolve();
+    return next_calloc ? next_calloc(n, size) : bootstrap_alloc(n * size);   // static buffer is zeroed
+}
+
+static void *real_realloc(void *p, size_t size) {
+    resolve();
+    if (is_bootstrap(p)) {
+        void *n = real_malloc(size);
+        if (n) memcpy(n, p, size);   // bootstrap blocks are few and small; over-read stays in the buffer
+        return n;
+    }
+    return next_realloc(p, size);
+}
+
+static void *real_memalign(size_t align, size_t size) {
+    void *p = NULL;
+    resolve();
+    return next_posix_memalign && next_posix_memalign(&p, align, size) == 0 ? p : NULL;
+}
+
+static void real_free(void *p) {
+    if (is_bootstrap(p)) return;
+    resolve();
+    if (next_free) next_free(p);
+}
+#endif
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Caller holds write_lock
+static void flush_locked(thread_buffer_t *b) {
+    if (b->count == 0 || trace_fd < 0) return;
+    size_t len = b->count * sizeof(alloc_trace_record_t);
+    const char *p = (const char *)b->rec;
+    while (len > 0) {
+        ssize_t n = write(trace_fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        p += n;
+        len -= n;
+    }
+    b->count = 0;
+}
+
+static void flush_buffer(thread_buffer_t *b) {
+    pthread_mutex_lock(&write_lock);
+    flush_locked(b);
+    pthread_mutex_unlock(&write_lock);
+}
+
+// Keep write_lock consistent across fork: no other thread can hold it then
+static void trace_atfork_prepare(void) {
+    pthread_mutex_lock(&write_lock);
+}
+
+static void trace_atfork_parent(void) {
+    pthread_mutex_unlock(&write_lock);
+}
+
+// The inherited buffers hold records the parent will write itself, and the
+// other threads they belong to do not exist here: drop them all
+static void trace_atfork_child(void) {
+    pthread_mutex_init(&write_lock, NULL);
+    memset(live_buffers, 0, sizeof(live_buffers));
+    buffer.count = 0;
+    if (trace_fd >= 0) close(trace_fd);
+    trace_fd = -1;
+}
+
+// pthread key destructor: the thread's TLS buffer is about to go away
+static void thread_exit(void *arg) {
+    thread_buffer_t *b = arg;
+    in_hook = 1;
+    pthread_mutex_lock(&write_lock);
+    flush_locked(b);
+    for (int i = 0; i < MAX_TRACED_THREADS; i++)
+        if (live_buffers[i] == b) live_buffers[i] = NULL;
+    pthread_mutex_unlock(&write_lock);
+    b->registered = 0;
+    in_hook = 0;
+}
+
+static void register_thread(thread_buffer_t *b) {
+    b->registered = 1;
+    b->tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+    pthread_setspecific(exit_key, b);
+    pthread_mutex_lock(&write_lock);
+    for (int i = 0; i < MAX_TRACED_THREADS; i++) {
+        if (!live_buffers[i]) {
+            live_buffers[i] = b;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&write_lock);
+}
+
+// ts is taken by the caller, before the call that makes an address reusable
+// by other threads, so sorting by ts never puts a reuse before its free
+static inline void record_at(uint64_t ts, uint8_t op, void *addr, void *old_addr, size_t size) {
+    if (trace_fd < 0 || in_hook) return;
+    in_hook = 1;
+    thread_buffer_t *b = &buffer;
+    // Pairs with trace_fini: either it sees busy and waits, or we see stopping
+    __atomic_store_n(&b->busy, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&stopping, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&b->busy, 0, __ATOMIC_RELEASE);
+        in_hook = 0;
+        return;
+    }
+    if (!b->registered) register_thread(b);
+    alloc_trace_record_t *r = &b->rec[b->count];
+    r->ts_ns = ts - start_ns;
+    r->addr = (uint64_t)(uintptr_t)addr;
+    r->old_addr = (uint64_t)(uintptr_t)old_addr;
+    r->size = size > UINT32_MAX ? UINT32_MAX : (uint32_t)size;
+    r->tid = (uint16_t)b->tid;
+    r->op = op;
+    r->pad = 0;
+    if (++b->count == BUFFER_RECORDS) flush_buffer(b);
+    __atomic_store_n(&b->busy, 0, __ATOMIC_RELEASE);
+    in_hook = 0;
+}
+
+static inline void record(uint8_t op, void *addr, void *old_addr, size_t size) {
+    record_at(now_ns(), op, addr, old_addr, size);
+}
+
+__attribute__((constructor))
+static void trace_init(void) {
+    in_hook = 1;
+    const char *path = getenv(ALLOC_TRACE_ENV);
+    if (!path || !*path) path = ALLOC_TRACE_DEFAULT;
+    pthread_key_create(&exit_key, thread_exit);
+    pthread_atfork(trace_atfork_prepare, trace_atfork_parent, trace_atfork_child);
+    char name[PATH_MAX];
+    int n = snprintf(name, sizeof(name), "%s.%ld", path, (long)getpid());
+    int fd = n > 0 && n < (int)sizeof(name) ? open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (fd < 0) {
+        in_hook = 0;
+        return;
+    }
+    start_ns = now_ns();
+    alloc_trace_header_t h = {
+        .magic = ALLOC_TRACE_MAGIC,
+        .version = ALLOC_TRACE_VERSION,
+        .record_size = sizeof(alloc_trace_record_t),
+        .start_ns = start_ns,
+    };
+    if (write(fd, &h, sizeof(h)) != sizeof(h)) {
+        close(fd);
+        in_hook = 0;
+        return;
+    }
+    trace_fd = fd;
+    in_hook = 0;
+}
+
+__attribute__((destructor))
+static void trace_fini(void) {
+    in_hook = 1;
+    if (trace_fd < 0) return;
+    // Other threads may still be running: stop new records, then flush each
+    // buffer once its thread is outside record()
+    __atomic_store_n(&stopping, 1, __ATOMIC_SEQ_CST);
+    flush_buffer(&buffer);
+    for (int i = 0; i < MAX_TRACED_THREADS; ) {
+        pthread_mutex_lock(&write_lock);
+        thread_buffer_t *b = live_buffers[i];
+        if (b && __atomic_load_n(&b->busy, __ATOMIC_ACQUIRE)) {
+            // It may need write_lock to finish, so wait without holding it
+            pthread_mutex_unlock(&write_lock);
+            sched_yield();
+            continue;
+        }
+        if (b) flush_locked(b);
+        pthread_mutex_unlock(&write_lock);
+        i++;
+    }
+    pthread_mutex_lock(&write_lock);
+    close(trace_fd);
+    trace_fd = -1;
+    pthread_mutex_unlock(&write_lock);
+}
+
+void *malloc(size_t size) {
+    void *p = real_malloc(size);
+    if (p) record(TRACE_MALLOC, p, NULL, size);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    void *p = real_calloc(n, size);
+    if (p) record(TRACE_CALLOC, p, NULL, n * size);
+    return p;
+}
+
+void *realloc(void *old, size_t size) {
+    uint64_t ts = now_ns();     // old may be handed out again before real_realloc returns
+    void *p = real_realloc(old, size);
+    if (p || size == 0) record_at(ts, TRACE_REALLOC, p, old, size);
+    return p;
+}
+
+void free(void *p) {
+    if (!p) return;
+    record(TRACE_FREE, p, NULL, 0);
+    real_free(p);
+}
+
+int posix_memalign(void **out, size_t align, size_t size) {
+    if (align < sizeof(void *) || (align & (align - 1))) return EINVAL;
+    void *p = real_memalign(align, size);
+    if (!p) return ENOMEM;
+    record(TRACE_MALLOC, p, NULL, size);
+    *out = p;
+    return 0;
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+    void *p = real_memalign(align, size);
+    if (p) record(TRACE_MALLOC, p, NULL, size);
+    return p;
+}
+
+void *memalign(size_t align, size_t size) {
+    void *p = real_memalign(align, size);
+    if (p) record(TRACE_MALLOC, p, NULL, size);
+    return p;
+}
@@ -0,0 +1,40 @@
+// On-disk format shared by the alloc_trace LD_PRELOAD recorder and
+// alloc_replay. A trace is one alloc_trace_header_t followed by fixed-size
+// records. Records are written in per-thread batches, so they are only
+// ordered within a thread; sort by ts_ns for a global order. Frees and
+// reallocs are stamped before the block is released, so an address never
+// reappears in that order before it has been freed. Events from threads still
+// running once the process starts exiting are dropped.
+//
+// Objects are identified by their address: unique while live, which is all
+// the replayer needs to pair every free/realloc with its allocation.
+#ifndef MEMORY_ALLOC_TRACE_H
+#define MEMORY_ALLOC_TRACE_H
+
+#include <stdint.h>
+
+#define ALLOC_TRACE_MAGIC    0x52544c41u   // "ALTR"
+#define ALLOC_TRACE_VERSION  1
+#define ALLOC_TRACE_ENV      "ALLOC_TRACE_FILE"   // each process appends .<pid>
+#define ALLOC_TRACE_DEFAULT  "alloc_trace.bin"
+
+enum alloc_trace_op { TRACE_MALLOC, TRACE_CALLOC, TRACE_REALLOC, TRACE_FREE };
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t start_ns;          // CLOCK_MONOTONIC when recording began
+} alloc_trace_header_t;
+
+typedef struct {
+    uint64_t ts_ns;             // since start_ns
+    uint64_t addr;              // returned block (malloc/calloc/realloc) or freed block
+    uint64_t old_addr;          // realloc only: the block passed in
+    uint32_t size;              // requested bytes (calloc: nmemb * size), 0 for free
+    uint16_t tid;               // small per-process thread number, in order of first event
+    uint8_t op;                 // enum alloc_trace_op
+    uint8_t pad;
+} alloc_trace_record_t;
+
+#endif
@@ -1,47 +1,507 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
-#define NUM_ALLOCATIONS 1000000   // Total number of allocations
-#define BLOCK_SIZE 64             // Size of each memory block in bytes
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
 
-double get_time_in_seconds() {
+#include "allocators.h"
+#include "latency_hist.h"
+
+#define CACHE_LINE_SIZE   64
+#define DEFAULT_DIST      "fixed:64"
+#define DEFAULT_OPS       2000000    // alloc + free operations per thread
+#define DEFAULT_LIVE      65536      // objects held at once by batch/interleave
+#define MAX_THREADS       256
+#define MAX_ALLOC_SIZE    (1 << 20)
+#define SIZE_TABLE        65536      // pre-drawn sizes, shared read-only
+#define RING_SIZE         1024       // producer -> consumer handoff queue
+#define LAT_SAMPLE_EVERY  8          // time one op in eight to keep clock reads off the fast path
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+  #define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+  #define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+enum pattern { PAT_BATCH, PAT_INTERLEAVE, PAT_PRODCONS, NUM_PATTERNS };
+static const char *pattern_names[NUM_PATTERNS] = { "batch", "interleave", "prodcons" };
+
+// Single-producer single-consumer ring carrying blocks to be freed by the
+// consumer thread
+typedef struct {
+    void *slots[RING_SIZE];
+    volatile unsigned long head __attribute__((aligned(CACHE_LINE_SIZE)));
+    volatile unsigned long tail __attribute__((aligned(CACHE_LINE_SIZE)));
+} ring_t;
+
+typedef struct {
+    int id;
+    int cpu;
+    enum pattern pattern;
+    long ops;
+    long live;
+    ring_t *ring;       // prodcons only: shared with the partner thread
+    int producer;
+    allocator_t *alloc; // own instance, or the pair's locked one for prodcons
+    size_t footprint;   // allocator bytes held when the run finished
+    unsigned long long rng;
+    unsigned long allocs, frees;
+    long long finish_ns;
+    unsigned long alloc_hist[HIST_BUCKETS];
+    unsigned long free_hist[HIST_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_t;
+
+static size_t sizes[SIZE_TABLE];
+static size_t max_size;
+static enum allocator_kind alloc_kind;
+static size_t tlsf_region;   // per instance, sized so the workload fits
+static pthread_barrier_t start_barrier;
+
+static inline long long now_ns(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec + ts.tv_nsec / 1e9;
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static inline unsigned long long xorshift64(unsigned long long *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static inline double uniform01(unsigned long long *s) {
+    return ((xorshift64(s) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static inline size_t clamp_size(double v) {
+    if (v < 1) return 1;
+    if (v > MAX_ALLOC_SIZE) return MAX_ALLOC_SIZE;
+    return (size_t)v;
+}
+
+// Recorded histogram: one "size count" pair per line, '#' comments allowed
+static int load_size_histogram(const char *path, unsigned long long *rng) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    size_t cap = 64, n = 0;
+    size_t *bin_size = malloc(cap * sizeof(size_t));
+    double *bin_cum = malloc(cap * sizeof(double));
+    double total = 0;
+    char line[256];
+    while (bin_size && bin_cum && fgets(line, sizeof(line), f)) {
+        unsigned long sz;
+        double count;
+        if (line[0] == '#' || sscanf(line, "%lu %lf", &sz, &count) != 2 || count <= 0) continue;
+        if (n == cap) {
+            cap *= 2;
+            bin_size = realloc(bin_size, cap * sizeof(size_t));
+            bin_cum = realloc(bin_cum, cap * sizeof(double));
+            if (!bin_size || !bin_cum) break;
+        }
+        total += count;
+        bin_size[n] = clamp_size((double)sz);
+        bin_cum[n++] = total;
+    }
+    fclose(f);
+    if (!bin_size || !bin_cum || n == 0) {
+        fprintf(stderr, "%s: no usable \"size count\" lines\n", path);
+        free(bin_size);
+        free(bin_cum);
+        return -1;
+    }
+    for (int i = 0; i < SIZE_TABLE; i++) {
+        double u = uniform01(rng) * total;
+        size_t lo = 0, hi = n - 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (bin_cum[mid] < u) lo = mid + 1; else hi = mid;
+        }
+        sizes[i] = bin_size[lo];
+    }
+    free(bin_size);
+    free(bin_cum);
+    return 0;
+}
+
+// Fills the shared size table from fixed:N, uniform:MIN-MAX,
+// lognormal:MEDIAN,SIGMA or hist:FILE
+static int build_size_table(const char *spec) {
+    unsigned long long rng = 0x2545f4914f6cdd1dULL;
+    unsigned long a, b;
+    double median, sigma;
+    if (sscanf(spec, "fixed:%lu", &a) == 1 && a > 0) {
+        for (int i = 0; i < SIZE_TABLE; i++) sizes[i] = clamp_size((double)a);
+    } else if (sscanf(spec, "uniform:%lu-%lu", &a, &b) == 2 && a > 0 && b >= a) {
+        for (int i = 0; i < SIZE_TABLE; i++)
+            sizes[i] = clamp_size((double)(a + xorshift64(&rng) % (b - a + 1)));
+    } else if (sscanf(spec, "lognormal:%lf,%lf", &median, &sigma) == 2 && median > 0 && sigma >= 0) {
+        // Box-Muller; most objects small, with a long tail of large ones
+        for (int i = 0; i < SIZE_TABLE; i++) {
+            double z = sqrt(-2.0 * log(uniform01(&rng))) * cos(2.0 * M_PI * uniform01(&rng));
+            sizes[i] = clamp_size(median * exp(sigma * z));
+        }
+    } else if (strncmp(spec, "hist:", 5) == 0) {
+        return load_size_histogram(spec + 5, &rng);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static inline void *timed_alloc(worker_t *w, size_t size) {
+    void *p;
+    if ((w->allocs++ & (LAT_SAMPLE_EVERY - 1)) == 0) {
+        long long t0 = now_ns();
+        p = allocator_alloc(w->alloc, size);
+        w->alloc_hist[hist_bucket((unsigned long long)(now_ns() - t0))]++;
+    } else {
+        p = allocator_alloc(w->alloc, size);
+    }
+    if (!p) {
+        fprintf(stderr, "%s(%zu) failed in worker %d\n", allocator_names[alloc_kind], size, w->id);
+        exit(EXIT_FAILURE);
+    }
+    *(volatile char *)p = 1;   // touch it, as a real caller would
+    return p;
 }
 
-int main() {
-    void **pointers = malloc(NUM_ALLOCATIONS * sizeof(void *));
-    if (pointers == NULL) {
-        perror("Failed to allocate pointer array");
-        return 1;
+static inline void timed_free(worker_t *w, void *p) {
+    if ((w->frees++ & (LAT_SAMPLE_EVERY - 1)) == 0) {
+        long long t0 = now_ns();
+        allocator_free(w->alloc, p);
+        w->free_hist[hist_bucket((unsigned long long)(now_ns() - t0))]++;
+    } else {
+        allocator_free(w->alloc, p);
     }
+}
 
-    printf("Testing memory throughput with %d allocations of %d bytes each...\n", NUM_ALLOCATIONS, BLOCK_SIZE);
+// Allocate `live` blocks, free them all, repeat: the original single-thread
+// test's shape. An arena gets its memory back from the reset at the end of
+// each batch, which is how arenas are meant to be used.
+static void run_batch(worker_t *w, void **slots) {
+    unsigned long idx = (unsigned long)w->id * 7919;
+    for (long done = 0; done < w->ops; ) {
+        long n = w->live;
+        if (n > (w->ops - done) / 2) n = (w->ops - done) / 2;
+        if (n <= 0) break;
+        for (long i = 0; i < n; i++)
+            slots[i] = timed_alloc(w, sizes[idx++ & (SIZE_TABLE - 1)]);
+        for (long i = 0; i < n; i++)
+            timed_free(w, slots[i]);
+        if (done + 2 * n >= w->ops) w->footprint = w->alloc->footprint;
+        allocator_reset(w->alloc);
+        done += 2 * n;
+    }
+}
 
-    double start_time = get_time_in_seconds();
+// Random replacement in a window of `live` blocks, so lifetimes vary and the
+// heap stays at a steady state instead of draining between phases
+static void run_interleave(worker_t *w, void **slots) {
+    unsigned long idx = (unsigned long)w->id * 7919;
+    for (long i = 0; i < w->live; i++)
+        slots[i] = allocator_alloc(w->alloc, sizes[idx++ & (SIZE_TABLE - 1)]);
+    pthread_barrier_wait(&start_barrier);
+    for (long done = 0; done < w->ops; done += 2) {
+        long s = (long)(xorshift64(&w->rng) % (unsigned long long)w->live);
+        timed_free(w, slots[s]);
+        slots[s] = timed_alloc(w, sizes[idx++ & (SIZE_TABLE - 1)]);
+    }
+    w->finish_ns = now_ns();
+    w->footprint = w->alloc->footprint;
+    for (long i = 0; i < w->live; i++)
+        allocator_free(w->alloc, slots[i]);
+}
 
-    // Allocation phase
-    for (int i = 0; i < NUM_ALLOCATIONS; i++) {
-        pointers[i] = malloc(BLOCK_SIZE);
-        if (pointers[i] == NULL) {
-            fprintf(stderr, "Failed to allocate memory at iteration %d\n", i);
-            return 1;
+// Producer allocates, consumer frees: every free is a remote free, which is
+// where per-thread caches have to hand memory back to the owning arena
+static void run_prodcons(worker_t *w) {
+    ring_t *r = w->ring;
+    unsigned long idx = (unsigned long)w->id * 7919;
+    long count = w->ops / 2;
+    for (long i = 0; i < count; i++) {
+        if (w->producer) {
+            void *p = timed_alloc(w, sizes[idx++ & (SIZE_TABLE - 1)]);
+            unsigned long head = r->head;
+            for (int spins = 0; head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= RING_SIZE; spins++) {
+                if (spins > 1000) sched_yield();   // partner may share our CPU
+                cpu_relax();
+            }
+            r->slots[head & (RING_SIZE - 1)] = p;
+            __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+        } else {
+            unsigned long tail = r->tail;
+            for (int spins = 0; __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail; spins++) {
+                if (spins > 1000) sched_yield();
+                cpu_relax();
+            }
+            void *p = r->slots[tail & (RING_SIZE - 1)];
+            __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+            timed_free(w, p);
         }
     }
+}
+
+static void* worker_function(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    if (pin_self(w->cpu) != 0)
+        fprintf(stderr, "warning: could not pin worker %d to CPU %d\n", w->id, w->cpu);
 
-    // Deallocation phase
-    for (int i = 0; i < NUM_ALLOCATIONS; i++) {
-        free(pointers[i]);
+    void **slots = NULL;
+    if (w->pattern != PAT_PRODCONS) {
+        // Created on the worker's own CPU so its memory is local there
+        w->alloc = alloc_kind == ALLOC_TLSF ? allocator_create_tlsf(tlsf_region, 0)
+                                            : allocator_create(alloc_kind, max_size, 0);
+        slots = malloc(w->live * sizeof(void *));
+        if (!w->alloc || !slots) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    switch (w->pattern) {
+    case PAT_BATCH:
+        pthread_barrier_wait(&start_barrier);
+        run_batch(w, slots);
+        w->finish_ns = now_ns();
+        break;
+    case PAT_INTERLEAVE:
+        run_interleave(w, slots);   // prefills before the barrier
+        break;
+    case PAT_PRODCONS:
+        pthread_barrier_wait(&start_barrier);
+        run_prodcons(w);
+        w->finish_ns = now_ns();
+        break;
+    default:
+        break;
+    }
+    free(slots);
+    if (w->pattern != PAT_PRODCONS)
+        allocator_destroy(w->alloc);
+    return NULL;
+}
+
+static void run_config(enum pattern pat, int nthreads, int ncpus, long ops, long live) {
+    if (pat == PAT_PRODCONS) {
+        nthreads &= ~1;   // whole producer/consumer pairs only
+        if (nthreads == 0) {
+            printf("%-10s %-7s %7d needs at least 2 threads\n", pattern_names[pat], allocator_names[alloc_kind], 1);
+            return;
+        }
+    }
+
+    worker_t *workers;
+    if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, nthreads * sizeof(worker_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    memset(workers, 0, nthreads * sizeof(worker_t));
+    ring_t *rings = NULL;
+    if (pat == PAT_PRODCONS &&
+        posix_memalign((void **)&rings, CACHE_LINE_SIZE, (nthreads / 2) * sizeof(ring_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    if (rings) memset(rings, 0, (nthreads / 2) * sizeof(ring_t));
+    // Each pair shares one locked instance: the producer allocates from it and
+    // the consumer frees back into it
+    allocator_t *pair_alloc[MAX_THREADS / 2] = { NULL };
+    for (int i = 0; rings && i < nthreads / 2; i++) {
+        pair_alloc[i] = alloc_kind == ALLOC_TLSF ? allocator_create_tlsf(tlsf_region, 1)
+                                                 : allocator_create(alloc_kind, max_size, 1);
+        if (!pair_alloc[i]) {
+            perror("allocator_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
     }
 
-    double end_time = get_time_in_seconds();
-    double total_time = end_time - start_time;
+    pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+    for (int i = 0; i < nthreads; i++) {
+        worker_t *w = &workers[i];
+        w->id = i;
+        w->cpu = i % ncpus;
+        w->pattern = pat;
+        w->ops = ops;
+        w->live = live;
+        w->rng = 0x9e3779b97f4a7c15ULL * (i + 1);
+        if (rings) {
+            w->ring = &rings[i / 2];
+            w->producer = (i & 1) == 0;
+            w->alloc = pair_alloc[i / 2];
+        }
+        if (pthread_create(&tids[i], NULL, worker_function, w) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    printf("Total time: %.6f seconds\n", total_time);
-    printf("Throughput: %.2f operations/second (alloc + free)\n", (NUM_ALLOCATIONS * 2) / total_time);
+    pthread_barrier_wait(&start_barrier);
+    long long start = now_ns(), end = start;
+    size_t footprint_pairs = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        if (workers[i].finish_ns > end) end = workers[i].finish_ns;
+    }
+    pthread_barrier_destroy(&start_barrier);
+    for (int i = 0; rings && i < nthreads / 2; i++) {
+        footprint_pairs += pair_alloc[i]->footprint;
+        allocator_destroy(pair_alloc[i]);
+    }
 
-    free(pointers);
+    static unsigned long alloc_merged[HIST_BUCKETS], free_merged[HIST_BUCKETS];
+    memset(alloc_merged, 0, sizeof(alloc_merged));
+    memset(free_merged, 0, sizeof(free_merged));
+    unsigned long total_ops = 0, alloc_samples = 0, free_samples = 0;
+    size_t footprint = 0;
+    for (int i = 0; i < nthreads; i++) {
+        total_ops += workers[i].allocs + workers[i].frees;
+        footprint += rings ? 0 : workers[i].footprint;
+        if (i == 0) footprint += footprint_pairs;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            alloc_merged[b] += workers[i].alloc_hist[b];
+            free_merged[b] += workers[i].free_hist[b];
+            alloc_samples += workers[i].alloc_hist[b];
+            free_samples += workers[i].free_hist[b];
+        }
+    }
+
+    double elapsed = (double)(end - start);
+    if (elapsed <= 0 || alloc_samples == 0 || free_samples == 0) {
+        printf("%-10s %-7s %7d no operations completed\n", pattern_names[pat], allocator_names[alloc_kind], nthreads);
+    } else {
+        double mops = total_ops * 1e3 / elapsed;
+        char foot[16] = "-";   // malloc's own footprint isn't visible from here
+        if (alloc_kind != ALLOC_MALLOC) snprintf(foot, sizeof(foot), "%.1f", footprint / 1048576.0);
+        printf("%-10s %-7s %7d %8.2f %8.2f %6llu %7llu %8llu %9llu %6llu %7llu %9llu %8s\n",
+               pattern_names[pat], allocator_names[alloc_kind], nthreads, mops, mops / nthreads,
+               percentile(alloc_merged, alloc_samples, 0.50),
+               percentile(alloc_merged, alloc_samples, 0.99),
+               percentile(alloc_merged, alloc_samples, 0.9999),
+               hist_max(alloc_merged),
+               percentile(free_merged, free_samples, 0.50),
+               percentile(free_merged, free_samples, 0.99),
+               hist_max(free_merged), foot);
+    }
+    fflush(stdout);
+
+    free(tids);
+    free(rings);
+    free(workers);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [max_threads=1] [dist=%s] [batch|interleave|prodcons|all] "
+            "[ops_per_thread=%d] [live=%d] [malloc|pool|slab|arena|tlsf|all]\n",
+            prog, DEFAULT_DIST, DEFAULT_OPS, DEFAULT_LIVE);
+    fprintf(stderr, "  dist: fixed:N | uniform:MIN-MAX | lognormal:MEDIAN,SIGMA | hist:FILE "
+            "(\"size count\" per line)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+        usage(argv[0]);
+
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    int max_threads = 1;
+    if (argc > 1) {
+        max_threads = atoi(argv[1]);
+        if (max_threads <= 0) max_threads = ncpus;
+        if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    }
+    const char *dist = argc > 2 ? argv[2] : DEFAULT_DIST;
+    int only = PAT_BATCH;
+    if (argc > 3) {
+        only = strcmp(argv[3], "all") == 0 ? -1 : -2;
+        for (int i = 0; i < NUM_PATTERNS; i++)
+            if (strcmp(argv[3], pattern_names[i]) == 0) only = i;
+        if (only == -2) usage(argv[0]);
+    }
+    long ops = argc > 4 ? atol(argv[4]) : DEFAULT_OPS;
+    long live = argc > 5 ? atol(argv[5]) : DEFAULT_LIVE;
+    if (ops < 2) ops = DEFAULT_OPS;
+    if (live < 1) live = DEFAULT_LIVE;
+    int only_alloc = ALLOC_MALLOC;
+    if (argc > 6) {
+        only_alloc = strcmp(argv[6], "all") == 0 ? -1 : allocator_parse(argv[6]);
+        if (only_alloc < 0 && strcmp(argv[6], "all") != 0) usage(argv[0]);
+    }
+
+    if (build_size_table(dist) != 0) {
+        fprintf(stderr, "Bad size distribution: %s\n", dist);
+        usage(argv[0]);
+    }
+    double mean = 0;
+    size_t min_size = sizes[0];
+    for (int i = 0; i < SIZE_TABLE; i++) {
+        mean += sizes[i];
+        if (sizes[i] > max_size) max_size = sizes[i];
+        if (sizes[i] < min_size) min_size = sizes[i];
+    }
+    mean /= SIZE_TABLE;
+    // Twice the live set plus slack, so TLSF fragmentation never runs it dry
+    long held = live > RING_SIZE ? live : RING_SIZE;
+    tlsf_region = (size_t)(2 * held * (mean + TLSF_HEADER + ALLOC_ALIGN)) + 4 * max_size + (1 << 20);
+
+    printf("Allocator throughput: %ld ops per thread, %ld live blocks, sizes %s (mean %.0f bytes), %d CPUs\n",
+           ops, live, dist, mean, ncpus);
+    printf("Latency in ns, sampled on one op in %d; ops = alloc + free\n", LAT_SAMPLE_EVERY);
+    printf("Footprint: MB held by the suite's allocator when the run ended (pool objects are %zu bytes)\n",
+           alloc_round_up(max_size, ALLOC_ALIGN));
+    printf("%-10s %-7s %7s %8s %8s %6s %7s %8s %9s %6s %7s %9s %8s\n",
+           "pattern", "alloc", "threads", "Mops/s", "Mops/thr", "a_p50", "a_p99", "a_p99.99", "a_max",
+           "f_p50", "f_p99", "f_max", "foot_MB");
+
+    for (int p = 0; p < NUM_PATTERNS; p++) {
+        if (only >= 0 && p != only) continue;
+        for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+            if (only_alloc >= 0 && k != only_alloc) continue;
+            alloc_kind = (enum allocator_kind)k;
+            // Every pool object is max_size bytes, so a mixed distribution's
+            // live set can need many times its real footprint
+            if (k == ALLOC_POOL && min_size != max_size) {
+                printf("%-10s %-7s skipped: needs fixed:N sizes\n", pattern_names[p], allocator_names[k]);
+                continue;
+            }
+            // Powers of two up to max_threads, always ending on max_threads
+            for (int t = 1; ; t *= 2) {
+                if (t > max_threads) t = max_threads;
+                run_config((enum pattern)p, t, ncpus, ops, live);
+                if (t == max_threads) break;
+            }
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
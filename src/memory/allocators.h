@@ -0,0 +1,472 @@
+// Suite-owned allocators behind one interface, so every memory benchmark can
+// run the same workload against malloc and against each of them.
+//
+//   pool   fixed-size objects (the largest size the workload asks for) on an
+//          intrusive free list, carved from 64 KB chunks
+//   slab   power-of-two size classes from 16 B to 32 KB, each class on its own
+//          SLAB_SIZE-aligned slabs; free() finds the class from the slab
+//          header by masking the pointer, larger blocks get a slab of their own
+//   arena  bump allocation from 1 MB chunks; free() is a no-op and memory only
+//          comes back on allocator_reset()
+//   tlsf   two-level segregated fit over one preallocated, mlock'd region:
+//          alloc and free are a bitmap search plus constant-time split and
+//          coalesce, so the worst case is bounded and never enters the kernel
+//
+// Instances are single-threaded unless created with locked = 1, which wraps
+// alloc/free in a spinlock for cross-thread frees. Header-only: include it
+// next to the benchmark's own code and build the single .c file as usual.
+#ifndef MEMORY_ALLOCATORS_H
+#define MEMORY_ALLOCATORS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define ALLOC_ALIGN       16
+#define POOL_CHUNK_SIZE   (64 * 1024)
+#define SLAB_SIZE         (256 * 1024)
+#define SLAB_HEADER_SIZE  64
+#define SLAB_MIN_SHIFT    4          // 16 B
+#define SLAB_MAX_SHIFT    15         // 32 KB
+#define SLAB_CLASSES      (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_LARGE        (-1)
+#define ARENA_CHUNK_SIZE  (1024 * 1024)
+
+// TLSF: the first level is the power of two, the second splits it into 16
+// linear classes; below 256 B the classes are simply 16 B apart
+#define TLSF_SL_LOG2        4
+#define TLSF_SL_COUNT       (1 << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT       (TLSF_SL_LOG2 + 4)
+#define TLSF_SMALL_BLOCK    (1 << TLSF_FL_SHIFT)
+#define TLSF_FL_MAX         40
+#define TLSF_FL_COUNT       (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_HEADER         16
+#define TLSF_MIN_PAYLOAD    16
+#define TLSF_FREE_BIT       ((size_t)1)
+#define TLSF_DEFAULT_REGION ((size_t)64 << 20)
+
+enum allocator_kind { ALLOC_MALLOC, ALLOC_POOL, ALLOC_SLAB, ALLOC_ARENA, ALLOC_TLSF, NUM_ALLOCATOR_KINDS };
+
+static const char *allocator_names[NUM_ALLOCATOR_KINDS] = { "malloc", "pool", "slab", "arena", "tlsf" };
+
+typedef struct free_obj {
+    struct free_obj *next;
+} free_obj_t;
+
+typedef struct mem_chunk {
+    struct mem_chunk *next;
+    size_t size;
+    size_t used;
+} mem_chunk_t;
+
+typedef struct {
+    size_t obj_size;
+    free_obj_t *free_list;
+    mem_chunk_t *chunks;
+} pool_t;
+
+typedef struct slab_header {
+    struct slab_header *next, *prev;
+    size_t bytes;
+    int size_class;
+} slab_header_t;
+
+typedef struct {
+    free_obj_t *free_list[SLAB_CLASSES];
+    char *bump[SLAB_CLASSES];        // unused tail of the class's newest slab
+    char *bump_end[SLAB_CLASSES];
+    slab_header_t *slabs;            // every slab, including large blocks
+} slab_t;
+
+typedef struct {
+    mem_chunk_t *chunks;             // newest first
+} arena_t;
+
+// Block header; the payload follows it. prev_phys is kept current for every
+// block so coalescing never has to search.
+typedef struct tlsf_block {
+    struct tlsf_block *prev_phys;    // NULL for the first block in the region
+    size_t size;                     // payload bytes | TLSF_FREE_BIT
+    struct tlsf_block *next_free;    // free blocks only, in the payload
+    struct tlsf_block *prev_free;
+} tlsf_block_t;
+
+typedef struct {
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    tlsf_block_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    char *region;
+    size_t region_size;
+    int mlocked;                     // 0 if mlock was refused; pages are prefaulted anyway
+} tlsf_t;
+
+typedef struct {
+    enum allocator_kind kind;
+    int locked;
+    pthread_spinlock_t lock;
+    size_t footprint;                // bytes currently held from malloc (or mmap for tlsf)
+    union {
+        pool_t pool;
+        slab_t slab;
+        arena_t arena;
+        tlsf_t tlsf;
+    } u;
+} allocator_t;
+
+static inline size_t alloc_round_up(size_t n, size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+// Returns the allocator_kind for a name, or -1
+static inline int allocator_parse(const char *name) {
+    for (int i = 0; i < NUM_ALLOCATOR_KINDS; i++)
+        if (strcmp(name, allocator_names[i]) == 0) return i;
+    return -1;
+}
+
+static inline mem_chunk_t *alloc_new_chunk(allocator_t *a, size_t payload) {
+    size_t hdr = alloc_round_up(sizeof(mem_chunk_t), ALLOC_ALIGN);
+    mem_chunk_t *c;
+    if (posix_memalign((void **)&c, ALLOC_ALIGN, hdr + payload) != 0) return NULL;
+    c->size = payload;
+    c->used = 0;
+    a->footprint += hdr + payload;
+    return c;
+}
+
+static inline char *alloc_chunk_data(mem_chunk_t *c) {
+    return (char *)c + alloc_round_up(sizeof(mem_chunk_t), ALLOC_ALIGN);
+}
+
+static inline void tlsf_mapping(size_t size, int *fl, int *sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        int f = 63 - __builtin_clzll(size);
+        *sl = (int)((size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT);
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+static inline tlsf_block_t *tlsf_next(tlsf_block_t *b) {
+    return (tlsf_block_t *)((char *)b + TLSF_HEADER + (b->size & ~TLSF_FREE_BIT));
+}
+
+static inline void tlsf_insert(tlsf_t *t, tlsf_block_t *b) {
+    int fl, sl;
+    tlsf_mapping(b->size & ~TLSF_FREE_BIT, &fl, &sl);
+    b->prev_free = NULL;
+    b->next_free = t->blocks[fl][sl];
+    if (b->next_free) b->next_free->prev_free = b;
+    t->blocks[fl][sl] = b;
+    t->fl_bitmap |= 1ULL << fl;
+    t->sl_bitmap[fl] |= 1u << sl;
+    b->size |= TLSF_FREE_BIT;
+}
+
+static inline void tlsf_remove(tlsf_t *t, tlsf_block_t *b) {
+    int fl, sl;
+    tlsf_mapping(b->size & ~TLSF_FREE_BIT, &fl, &sl);
+    if (b->next_free) b->next_free->prev_free = b->prev_free;
+    if (b->prev_free) {
+        b->prev_free->next_free = b->next_free;
+    } else {
+        t->blocks[fl][sl] = b->next_free;
+        if (!b->next_free) {
+            t->sl_bitmap[fl] &= ~(1u << sl);
+            if (!t->sl_bitmap[fl]) t->fl_bitmap &= ~(1ULL << fl);
+        }
+    }
+    b->size &= ~TLSF_FREE_BIT;
+}
+
+// One free block spanning the region, closed by a zero-size used sentinel
+static inline int tlsf_init(allocator_t *a, size_t region_size) {
+    tlsf_t *t = &a->u.tlsf;
+    region_size = alloc_round_up(region_size, 4096);
+    t->region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (t->region == MAP_FAILED) return -1;
+    t->region_size = region_size;
+    t->mlocked = mlock(t->region, region_size) == 0;
+    if (!t->mlocked) memset(t->region, 0, region_size);
+    a->footprint = region_size;
+
+    tlsf_block_t *first = (tlsf_block_t *)t->region;
+    first->prev_phys = NULL;
+    first->size = region_size - 2 * TLSF_HEADER;
+    tlsf_block_t *sentinel = tlsf_next(first);
+    sentinel->prev_phys = first;
+    sentinel->size = 0;
+    tlsf_insert(t, first);
+    return 0;
+}
+
+static inline void *tlsf_alloc(allocator_t *a, size_t size) {
+    tlsf_t *t = &a->u.tlsf;
+    size = alloc_round_up(size < TLSF_MIN_PAYLOAD ? TLSF_MIN_PAYLOAD : size, ALLOC_ALIGN);
+    // Round the search up to the next class so any block found there fits
+    size_t search = size;
+    if (search >= TLSF_SMALL_BLOCK)
+        search += ((size_t)1 << (63 - __builtin_clzll(search) - TLSF_SL_LOG2)) - 1;
+    int fl, sl;
+    tlsf_mapping(search, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT) return NULL;
+    uint32_t sl_map = t->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        uint64_t fl_map = t->fl_bitmap & (~0ULL << (fl + 1));
+        if (!fl_map) return NULL;
+        fl = __builtin_ctzll(fl_map);
+        sl_map = t->sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    tlsf_block_t *b = t->blocks[fl][sl];
+    tlsf_remove(t, b);
+
+    // Return the tail to the free lists if it can hold a block of its own
+    if (b->size >= size + TLSF_HEADER + TLSF_MIN_PAYLOAD) {
+        tlsf_block_t *rest = (tlsf_block_t *)((char *)b + TLSF_HEADER + size);
+        rest->prev_phys = b;
+        rest->size = b->size - size - TLSF_HEADER;
+        tlsf_next(rest)->prev_phys = rest;
+        b->size = size;
+        tlsf_insert(t, rest);
+    }
+    return (char *)b + TLSF_HEADER;
+}
+
+static inline void tlsf_free(allocator_t *a, void *ptr) {
+    tlsf_t *t = &a->u.tlsf;
+    tlsf_block_t *b = (tlsf_block_t *)((char *)ptr - TLSF_HEADER);
+    tlsf_block_t *prev = b->prev_phys;
+    if (prev && (prev->size & TLSF_FREE_BIT)) {
+        tlsf_remove(t, prev);
+        prev->size += TLSF_HEADER + b->size;
+        b = prev;
+        tlsf_next(b)->prev_phys = b;
+    }
+    tlsf_block_t *next = tlsf_next(b);
+    if (next->size & TLSF_FREE_BIT) {
+        tlsf_remove(t, next);
+        b->size += TLSF_HEADER + next->size;
+        tlsf_next(b)->prev_phys = b;
+    }
+    tlsf_insert(t, b);
+}
+
+// TLSF with an explicit region size; everything it hands out comes from there
+static inline allocator_t *allocator_create_tlsf(size_t region_size, int locked) {
+    allocator_t *a = calloc(1, sizeof(allocator_t));
+    if (!a) return NULL;
+    a->kind = ALLOC_TLSF;
+    if (tlsf_init(a, region_size) != 0) {
+        free(a);
+        return NULL;
+    }
+    a->locked = locked;
+    if (locked) pthread_spin_init(&a->lock, PTHREAD_PROCESS_PRIVATE);
+    return a;
+}
+
+// max_size: the largest request the workload will make (sizes the pool's
+// objects; ignored by the others). TLSF gets a TLSF_DEFAULT_REGION region.
+static inline allocator_t *allocator_create(enum allocator_kind kind, size_t max_size, int locked) {
+    if (kind == ALLOC_TLSF) return allocator_create_tlsf(TLSF_DEFAULT_REGION, locked);
+    allocator_t *a = calloc(1, sizeof(allocator_t));
+    if (!a) return NULL;
+    a->kind = kind;
+    a->locked = locked;
+    if (locked) pthread_spin_init(&a->lock, PTHREAD_PROCESS_PRIVATE);
+    if (kind == ALLOC_POOL) {
+        a->u.pool.obj_size = alloc_round_up(max_size < sizeof(free_obj_t) ? sizeof(free_obj_t) : max_size,
+                                            ALLOC_ALIGN);
+    }
+    return a;
+}
+
+static inline void *pool_alloc(allocator_t *a, size_t size) {
+    pool_t *p = &a->u.pool;
+    if (size > p->obj_size) return NULL;
+    free_obj_t *o = p->free_list;
+    if (o) {
+        p->free_list = o->next;
+        return o;
+    }
+    mem_chunk_t *c = p->chunks;
+    if (!c || c->used + p->obj_size > c->size) {
+        size_t payload = p->obj_size > POOL_CHUNK_SIZE ? p->obj_size : POOL_CHUNK_SIZE;
+        c = alloc_new_chunk(a, payload - payload % p->obj_size);
+        if (!c) return NULL;
+        c->next = p->chunks;
+        p->chunks = c;
+    }
+    void *r = alloc_chunk_data(c) + c->used;
+    c->used += p->obj_size;
+    return r;
+}
+
+static inline void pool_free(allocator_t *a, void *ptr) {
+    free_obj_t *o = ptr;
+    o->next = a->u.pool.free_list;
+    a->u.pool.free_list = o;
+}
+
+static inline int slab_class(size_t size) {
+    if (size <= (1u << SLAB_MIN_SHIFT)) return 0;
+    int shift = 64 - __builtin_clzll((unsigned long long)size - 1);
+    return shift > SLAB_MAX_SHIFT ? SLAB_LARGE : shift - SLAB_MIN_SHIFT;
+}
+
+static inline slab_header_t *slab_new(allocator_t *a, size_t bytes, int size_class) {
+    slab_header_t *h;
+    if (posix_memalign((void **)&h, SLAB_SIZE, bytes) != 0) return NULL;
+    h->bytes = bytes;
+    h->size_class = size_class;
+    h->prev = NULL;
+    h->next = a->u.slab.slabs;
+    if (h->next) h->next->prev = h;
+    a->u.slab.slabs = h;
+    a->footprint += bytes;
+    return h;
+}
+
+static inline void *slab_alloc(allocator_t *a, size_t size) {
+    slab_t *s = &a->u.slab;
+    int c = slab_class(size);
+    if (c == SLAB_LARGE) {
+        slab_header_t *h = slab_new(a, SLAB_HEADER_SIZE + size, SLAB_LARGE);
+        return h ? (char *)h + SLAB_HEADER_SIZE : NULL;
+    }
+    free_obj_t *o = s->free_list[c];
+    if (o) {
+        s->free_list[c] = o->next;
+        return o;
+    }
+    size_t obj = (size_t)1 << (c + SLAB_MIN_SHIFT);
+    if (!s->bump[c] || s->bump[c] + obj > s->bump_end[c]) {
+        slab_header_t *h = slab_new(a, SLAB_SIZE, c);
+        if (!h) return NULL;
+        s->bump[c] = (char *)h + (obj > SLAB_HEADER_SIZE ? obj : SLAB_HEADER_SIZE);
+        s->bump_end[c] = (char *)h + SLAB_SIZE;
+    }
+    void *r = s->bump[c];
+    s->bump[c] += obj;
+    return r;
+}
+
+static inline void slab_free(allocator_t *a, void *ptr) {
+    slab_t *s = &a->u.slab;
+    slab_header_t *h = (slab_header_t *)((uintptr_t)ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+    if (h->size_class == SLAB_LARGE) {
+        // Large blocks go straight back to malloc
+        if (h->prev) h->prev->next = h->next; else s->slabs = h->next;
+        if (h->next) h->next->prev = h->prev;
+        a->footprint -= h->bytes;
+        free(h);
+        return;
+    }
+    free_obj_t *o = ptr;
+    o->next = s->free_list[h->size_class];
+    s->free_list[h->size_class] = o;
+}
+
+static inline void *arena_alloc(allocator_t *a, size_t size) {
+    arena_t *ar = &a->u.arena;
+    size = alloc_round_up(size ? size : 1, ALLOC_ALIGN);
+    mem_chunk_t *c = ar->chunks;
+    if (!c || c->used + size > c->size) {
+        c = alloc_new_chunk(a, size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+        if (!c) return NULL;
+        c->next = ar->chunks;
+        ar->chunks = c;
+    }
+    void *r = alloc_chunk_data(c) + c->used;
+    c->used += size;
+    return r;
+}
+
+static inline void *allocator_alloc(allocator_t *a, size_t size) {
+    void *r;
+    if (a->kind == ALLOC_MALLOC) return malloc(size);
+    if (a->locked) pthread_spin_lock(&a->lock);
+    switch (a->kind) {
+    case ALLOC_POOL:  r = pool_alloc(a, size); break;
+    case ALLOC_SLAB:  r = slab_alloc(a, size); break;
+    case ALLOC_ARENA: r = arena_alloc(a, size); break;
+    case ALLOC_TLSF:  r = tlsf_alloc(a, size); break;
+    default:          r = NULL; break;
+    }
+    if (a->locked) pthread_spin_unlock(&a->lock);
+    return r;
+}
+
+static inline void allocator_free(allocator_t *a, void *ptr) {
+    if (!ptr) return;
+    if (a->kind == ALLOC_MALLOC) {
+        free(ptr);
+        return;
+    }
+    if (a->kind == ALLOC_ARENA) return;
+    if (a->locked) pthread_spin_lock(&a->lock);
+    if (a->kind == ALLOC_POOL)
+        pool_free(a, ptr);
+    else if (a->kind == ALLOC_SLAB)
+        slab_free(a, ptr);
+    else
+        tlsf_free(a, ptr);
+    if (a->locked) pthread_spin_unlock(&a->lock);
+}
+
+static inline void alloc_free_chunks(allocator_t *a, mem_chunk_t *c) {
+    while (c) {
+        mem_chunk_t *next = c->next;
+        a->footprint -= alloc_round_up(sizeof(mem_chunk_t), ALLOC_ALIGN) + c->size;
+        free(c);
+        c = next;
+    }
+}
+
+// Arena: drops every allocation at once, keeping the newest chunk for reuse.
+// The other allocators have nothing to do here.
+static inline void allocator_reset(allocator_t *a) {
+    if (a->kind != ALLOC_ARENA) return;
+    if (a->locked) pthread_spin_lock(&a->lock);
+    mem_chunk_t *keep = a->u.arena.chunks;
+    if (keep) {
+        alloc_free_chunks(a, keep->next);
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    if (a->locked) pthread_spin_unlock(&a->lock);
+}
+
+static inline void allocator_destroy(allocator_t *a) {
+    if (!a) return;
+    switch (a->kind) {
+    case ALLOC_POOL:
+        alloc_free_chunks(a, a->u.pool.chunks);
+        break;
+    case ALLOC_SLAB:
+        for (slab_header_t *h = a->u.slab.slabs; h; ) {
+            slab_header_t *next = h->next;
+            free(h);
+            h = next;
+        }
+        break;
+    case ALLOC_ARENA:
+        alloc_free_chunks(a, a->u.arena.chunks);
+        break;
+    case ALLOC_TLSF:
+        if (a->u.tlsf.mlocked) munlock(a->u.tlsf.region, a->u.tlsf.region_size);
+        munmap(a->u.tlsf.region, a->u.tlsf.region_size);
+        break;
+    default:
+        break;
+    }
+    if (a->locked) pthread_spin_destroy(&a->lock);
+    free(a);
+}
+
+#endif
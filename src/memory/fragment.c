@@ -1,34 +1,277 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-#define NUM_ALLOCS 1000000
-#define ALLOC_SIZE 2048
+#include "allocators.h"
 
-int main() {
-    void *ptrs[NUM_ALLOCS];
-    srand(time(NULL));
+#define DEFAULT_TARGET_MB  64      // live bytes each grow phase builds up to
+#define DEFAULT_ROUNDS     8
+#define SMALL_MIN          16
+#define SMALL_MAX          256
+#define LARGE_MIN          1024
+#define LARGE_MAX          (16 * 1024) // well below glibc's mmap threshold, so it stays in the heap
+#define LARGE_PCT          5           // of objects; about three quarters of the bytes
+#define SMALL_SURVIVE_PCT  50      // smalls kept by each shrink phase
+#define REMNANT_PCT        5       // smalls still live at the end, pinning pages
+#define FOOTPRINT_LIMIT    8       // stop a run once an allocator holds this many times the target
+#define MB                 (1024.0 * 1024.0)
 
-    // Step 1: Allocate memory
-    for (int i = 0; i < NUM_ALLOCS; i++) {
-        ptrs[i] = malloc(ALLOC_SIZE);
-        if (!ptrs[i]) break;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  #define HAVE_MALLINFO2 1
+#endif
+
+typedef struct {
+    void *ptr;
+    size_t size;
+    int large;
+} slot_t;
+
+// One snapshot of how much memory the process holds against what it uses
+typedef struct {
+    size_t live;       // bytes the workload asked for and still holds
+    size_t held;       // bytes the allocator holds: mallinfo arena + mmap, or footprint
+    long free_held;    // malloc's free bytes inside the heap (fordblks), -1 otherwise
+    long rss;          // process RSS
+    long heap_rss;     // RSS of [heap] from smaps
+    long anon_rss;     // RSS of other anonymous mappings from smaps
+} sample_t;
+
+static slot_t *slots;
+static long num_slots;
+static size_t live_bytes, peak_live, peak_held;
+static unsigned long long rng = 0x2545f4914f6cdd1dULL;
+
+static inline unsigned long long xorshift64(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static long read_rss(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return -1;
+    long size, resident;
+    int ok = fscanf(f, "%ld %ld", &size, &resident) == 2;
+    fclose(f);
+    return ok ? resident * sysconf(_SC_PAGESIZE) : -1;
+}
+
+// Rss summed over [heap] and over anonymous mappings (no path), in bytes
+static void read_smaps(long *heap_rss, long *anon_rss) {
+    *heap_rss = *anon_rss = -1;
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return;
+    *heap_rss = *anon_rss = 0;
+    char line[512];
+    int region = 0;   // 1 = heap, 2 = anonymous, 0 = anything else
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end;
+        char perms[8];
+        int path_at = 0;
+        if (sscanf(line, "%lx-%lx %7s %*s %*s %*s %n", &start, &end, perms, &path_at) == 3 && path_at > 0) {
+            const char *path = line + path_at;
+            if (strncmp(path, "[heap]", 6) == 0) region = 1;
+            else if (*path == '\n' || *path == '\0') region = 2;
+            else region = 0;
+            continue;
+        }
+        long kb;
+        if (region && sscanf(line, "Rss: %ld kB", &kb) == 1) {
+            if (region == 1) *heap_rss += kb * 1024;
+            else *anon_rss += kb * 1024;
+        }
+    }
+    fclose(f);
+}
+
+static void take_sample(allocator_t *a, sample_t *s) {
+    s->live = live_bytes;
+    s->free_held = -1;
+    if (a->kind == ALLOC_MALLOC) {
+#ifdef HAVE_MALLINFO2
+        struct mallinfo2 mi = mallinfo2();
+        s->held = mi.arena + mi.hblkhd;
+        s->free_held = (long)mi.fordblks;
+#else
+        struct mallinfo mi = mallinfo();
+        s->held = (size_t)(unsigned)mi.arena + (size_t)(unsigned)mi.hblkhd;
+        s->free_held = (long)(unsigned)mi.fordblks;
+#endif
+    } else {
+        s->held = a->footprint;
+    }
+    if (s->held > peak_held) peak_held = s->held;
+    s->rss = read_rss();
+    read_smaps(&s->heap_rss, &s->anon_rss);
+}
+
+static void print_mb(long v) {
+    if (v < 0) printf(" %8s", "-");
+    else printf(" %8.1f", v / MB);
+}
+
+static void print_sample(const char *alloc, const char *phase, int round, const sample_t *s) {
+    // External fragmentation: share of what the allocator holds that is not
+    // backing a live object
+    double frag = s->held > s->live ? 100.0 * (s->held - s->live) / s->held : 0.0;
+    printf("%-7s %-8s %5d %8.1f %8.1f %6.1f%%", alloc, phase, round, s->live / MB, s->held / MB, frag);
+    print_mb(s->free_held);
+    print_mb(s->rss);
+    print_mb(s->heap_rss);
+    print_mb(s->anon_rss);
+    printf("\n");
+}
+
+static void release(allocator_t *a, slot_t *s) {
+    allocator_free(a, s->ptr);
+    live_bytes -= s->size;
+    s->ptr = NULL;
+}
+
+// Grow phase: fill free slots with a small/large mix until the target is live
+static int grow(allocator_t *a, size_t target) {
+    long cursor = (long)(xorshift64() % (unsigned long long)num_slots);
+    while (live_bytes < target) {
+        slot_t *s = NULL;
+        for (long n = 0; n < num_slots; n++) {
+            slot_t *c = &slots[(cursor + n) % num_slots];
+            if (!c->ptr) {
+                s = c;
+                cursor = (cursor + n + 1) % num_slots;
+                break;
+            }
+        }
+        if (!s) return -1;
+        if (a->kind != ALLOC_MALLOC && a->footprint > FOOTPRINT_LIMIT * target) return -2;
+        s->large = (int)(xorshift64() % 100) < LARGE_PCT;
+        s->size = s->large ? LARGE_MIN + xorshift64() % (LARGE_MAX - LARGE_MIN + 1)
+                           : SMALL_MIN + xorshift64() % (SMALL_MAX - SMALL_MIN + 1);
+        s->ptr = allocator_alloc(a, s->size);
+        if (!s->ptr) return -1;
+        memset(s->ptr, 0xa5, s->size);
+        live_bytes += s->size;
+        if (live_bytes > peak_live) peak_live = live_bytes;
+    }
+    return 0;
+}
+
+// Shrink phase: the large objects were short-lived and all go; only some of
+// the small long-lived ones do, and those left pin the pages in between
+static void shrink(allocator_t *a, int small_survive_pct) {
+    for (long i = 0; i < num_slots; i++) {
+        slot_t *s = &slots[i];
+        if (!s->ptr) continue;
+        if (s->large || (int)(xorshift64() % 100) >= small_survive_pct)
+            release(a, s);
+    }
+}
+
+static void run(enum allocator_kind kind, size_t target, int rounds) {
+    allocator_t *a = kind == ALLOC_TLSF ? allocator_create_tlsf(3 * target, 0)
+                                        : allocator_create(kind, LARGE_MAX, 0);
+    if (!a) {
+        printf("%-7s create failed\n", allocator_names[kind]);
+        return;
     }
+    memset(slots, 0, num_slots * sizeof(slot_t));
+    live_bytes = peak_live = peak_held = 0;
+    const char *name = allocator_names[kind];
+    sample_t s;
 
-    // Step 2: Free random blocks
-    for (int i = 0; i < NUM_ALLOCS / 2; i++) {
-        int index = rand() % NUM_ALLOCS;
-        free(ptrs[index]);
-        ptrs[index] = NULL;
+    take_sample(a, &s);
+    print_sample(name, "start", 0, &s);
+    int r;
+    for (r = 1; r <= rounds; r++) {
+        int rc = grow(a, target);
+        if (rc != 0) {
+            if (rc == -2)
+                printf("%-7s holds over %dx the target in round %d, stopping\n", name, FOOTPRINT_LIMIT, r);
+            else
+                printf("%-7s allocation failed in round %d\n", name, r);
+            break;
+        }
+        take_sample(a, &s);
+        print_sample(name, "grown", r, &s);
+        shrink(a, SMALL_SURVIVE_PCT);
+        take_sample(a, &s);
+        print_sample(name, "shrunk", r, &s);
     }
 
-    // Step 3: Allocate again and measure success rate
-    int failed_allocs = 0;
-    for (int i = 0; i < NUM_ALLOCS / 2; i++) {
-        void *temp = malloc(ALLOC_SIZE);
-        if (!temp) failed_allocs++;
+    // Leave a thin remnant of small objects spread over the whole heap, then
+    // see what malloc_trim can give back around them
+    shrink(a, REMNANT_PCT);
+    sample_t before, after;
+    take_sample(a, &before);
+    if (r > rounds) r = rounds;
+    print_sample(name, "remnant", r, &before);
+#ifdef __GLIBC__
+    if (kind == ALLOC_MALLOC) {
+        malloc_trim(0);
+        take_sample(a, &after);
+        print_sample(name, "trimmed", r, &after);
+        long reclaimable = (long)before.held - (long)before.live;
+        if (before.rss >= 0 && after.rss >= 0 && reclaimable > 0)
+            printf("%-7s malloc_trim released %.1f MB RSS of %.1f MB held but not live (%.0f%%)\n",
+                   name, (before.rss - after.rss) / MB, reclaimable / MB,
+                   100.0 * (before.rss - after.rss) / reclaimable);
+    }
+#endif
+    printf("%-7s peak live %.1f MB, peak held %.1f MB (%.2fx)\n",
+           name, peak_live / MB, peak_held / MB, peak_live ? (double)peak_held / peak_live : 0.0);
+    fflush(stdout);
+
+    for (long i = 0; i < num_slots; i++)
+        if (slots[i].ptr) release(a, &slots[i]);
+    allocator_destroy(a);
+#ifdef __GLIBC__
+    malloc_trim(0);   // don't let this allocator's leftovers color the next one
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    int only = ALLOC_MALLOC;
+    if (argc > 1) {
+        only = strcmp(argv[1], "all") == 0 ? -1 : allocator_parse(argv[1]);
+        if (only < 0 && strcmp(argv[1], "all") != 0) {
+            fprintf(stderr, "Usage: %s [malloc|pool|slab|arena|tlsf|all] [target_mb=%d] [rounds=%d]\n",
+                    argv[0], DEFAULT_TARGET_MB, DEFAULT_ROUNDS);
+            return 1;
+        }
+    }
+    long target_mb = argc > 2 ? atol(argv[2]) : DEFAULT_TARGET_MB;
+    int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+    if (target_mb <= 0) target_mb = DEFAULT_TARGET_MB;
+    if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+    size_t target = (size_t)target_mb << 20;
+
+    // Room for the target made entirely of average-sized small objects, twice
+    // over. Mapped directly so the bookkeeping never shows up in mallinfo.
+    num_slots = (long)(2 * target / ((SMALL_MIN + SMALL_MAX) / 2));
+    size_t slots_bytes = num_slots * sizeof(slot_t);
+    slots = mmap(NULL, slots_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (slots == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("Heap fragmentation: %ld MB live per grow phase, %d rounds, %d%% large (%d-%d B) short-lived, "
+           "small (%d-%d B) %d%% survive each shrink\n",
+           target_mb, rounds, LARGE_PCT, LARGE_MIN, LARGE_MAX, SMALL_MIN, SMALL_MAX, SMALL_SURVIVE_PCT);
+    printf("held: malloc arena + mmap from mallinfo, or the suite allocator's footprint; frag = 1 - live/held\n");
+    printf("%-7s %-8s %5s %8s %8s %7s %8s %8s %8s %8s\n", "alloc", "phase", "round",
+           "live_MB", "held_MB", "frag", "free_MB", "rss_MB", "heap_MB", "anon_MB");
+
+    for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+        if (only >= 0 && k != only) continue;
+        run((enum allocator_kind)k, target, rounds);
     }
 
-    printf("Failed allocations due to fragmentation: %d\n", failed_allocs);
+    munmap(slots, slots_bytes);
     return 0;
 }
@@ -0,0 +1,317 @@
+// Built-in sampling heap profiler, cheap enough to leave on in production.
+//
+// Allocations are sampled as a Poisson process over bytes: each thread counts
+// down a byte budget drawn from an exponential distribution with mean
+// `interval`, and the allocation that crosses zero is sampled. A sampled
+// allocation records its backtrace and is weighted by
+// size / (1 - exp(-size / interval)), the inverse of its chance of being
+// sampled, so summed weights estimate true bytes whatever the size mix.
+// Sampled objects still live at exit are reported as leaks, grouped by stack.
+//
+// The unsampled fast path is a subtraction on alloc and one atomic load on
+// free (plus a probe of the live-sample table while anything is sampled).
+// The table is open addressing with backward-shift deletion, so probe chains
+// stay short however long the process runs; a sequence count lets frees probe
+// it without the lock.
+// Call heap_profiler_on_alloc()/heap_profiler_on_free() next to the
+// allocator calls to be tracked. Header-only, one profiler per process; link
+// with -lm, and with -rdynamic for function names in the report.
+#ifndef MEMORY_HEAP_PROFILER_H
+#define MEMORY_HEAP_PROFILER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#ifdef __GLIBC__
+  #include <execinfo.h>
+#endif
+
+#define HEAP_PROF_MAX_DEPTH   16
+#define HEAP_PROF_SKIP        1              // heap_profiler_sample itself
+#define HEAP_PROF_TABLE_SHIFT 16
+#define HEAP_PROF_TABLE       (1 << HEAP_PROF_TABLE_SHIFT)
+#define HEAP_PROF_MAX_LIVE    (HEAP_PROF_TABLE / 2)   // keeps probe chains short
+#define HEAP_PROF_STACKS      4096
+
+// One sampled, still-live object; ptr == NULL marks an empty slot
+typedef struct {
+    void *ptr;
+    size_t size;
+    double weight;                   // estimated bytes this sample stands for
+    int stack;
+} heap_prof_entry_t;
+
+typedef struct {
+    uint64_t hash;
+    int depth;
+    void *frames[HEAP_PROF_MAX_DEPTH];
+} heap_prof_stack_t;
+
+typedef struct {
+    size_t interval;                 // mean bytes between samples; 0 = off
+    pthread_mutex_t lock;            // sample and remove paths only
+    unsigned long seq;               // odd while a removal is moving entries
+    long live;                       // sampled objects in the table
+    unsigned long samples;           // sampled since init/reset
+    unsigned long dropped;           // samples not recorded: table full
+    double sampled_bytes;            // estimated bytes allocated since init/reset
+    int num_stacks;
+    heap_prof_entry_t table[HEAP_PROF_TABLE];
+    heap_prof_stack_t stacks[HEAP_PROF_STACKS];   // [0] collects stacks that did not fit
+} heap_profiler_t;
+
+typedef struct {
+    long countdown;                  // bytes left before the next sample
+    unsigned long long rng;
+    int armed;
+} heap_prof_thread_t;
+
+static heap_profiler_t heap_prof = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static __thread heap_prof_thread_t heap_prof_thread;
+
+static inline unsigned long long heap_prof_xorshift64(unsigned long long *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static inline long heap_prof_next_countdown(heap_prof_thread_t *t) {
+    double u = ((heap_prof_xorshift64(&t->rng) >> 11) + 0.5) / 9007199254740992.0;
+    return (long)(-log(u) * (double)heap_prof.interval) + 1;
+}
+
+static inline size_t heap_prof_slot(const void *p) {
+    return (size_t)(((uintptr_t)p >> 4) * 0x9e3779b97f4a7c15ULL >> (64 - HEAP_PROF_TABLE_SHIFT));
+}
+
+// Index of the deduplicated stack; 0 once the stack table is full. Lock held.
+static int heap_prof_intern_stack(void **frames, int depth) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < depth; i++)
+        h = (h ^ (uint64_t)(uintptr_t)frames[i]) * 0x100000001b3ULL;
+    size_t idx = 1 + h % (HEAP_PROF_STACKS - 1);
+    for (int n = 1; n < HEAP_PROF_STACKS; n++) {
+        heap_prof_stack_t *s = &heap_prof.stacks[idx];
+        if (s->depth == 0) {
+            s->hash = h;
+            s->depth = depth;
+            memcpy(s->frames, frames, depth * sizeof(void *));
+            heap_prof.num_stacks++;
+            return (int)idx;
+        }
+        if (s->hash == h && s->depth == depth && memcmp(s->frames, frames, depth * sizeof(void *)) == 0)
+            return (int)idx;
+        if (heap_prof.num_stacks >= HEAP_PROF_STACKS - 1) break;
+        idx = idx + 1 < HEAP_PROF_STACKS ? idx + 1 : 1;
+    }
+    return 0;
+}
+
+static __attribute__((noinline)) void heap_profiler_sample(void *p, size_t size) {
+    heap_prof_thread_t *t = &heap_prof_thread;
+    if (!t->armed) {
+        // First allocation on this thread: draw a budget instead of sampling
+        // every thread's first allocation
+        t->armed = 1;
+        if (!t->rng) t->rng = 0x9e3779b97f4a7c15ULL ^ (unsigned long long)(uintptr_t)t;
+        t->countdown += heap_prof_next_countdown(t);
+        if (t->countdown > 0) return;
+    }
+    while (t->countdown <= 0) t->countdown += heap_prof_next_countdown(t);
+
+    void *frames[HEAP_PROF_MAX_DEPTH + HEAP_PROF_SKIP];
+    int depth = 0;
+#ifdef __GLIBC__
+    depth = backtrace(frames, HEAP_PROF_MAX_DEPTH + HEAP_PROF_SKIP) - HEAP_PROF_SKIP;
+    if (depth < 0) depth = 0;
+#else
+    frames[HEAP_PROF_SKIP] = __builtin_return_address(0);
+    depth = 1;
+#endif
+    double ratio = (double)size / (double)heap_prof.interval;
+    double weight = ratio > 1e-9 ? (double)size / -expm1(-ratio) : (double)heap_prof.interval;
+
+    pthread_mutex_lock(&heap_prof.lock);
+    heap_prof.samples++;
+    heap_prof.sampled_bytes += weight;
+    if (heap_prof.live >= HEAP_PROF_MAX_LIVE) {
+        heap_prof.dropped++;
+        pthread_mutex_unlock(&heap_prof.lock);
+        return;
+    }
+    int stack = heap_prof_intern_stack(frames + HEAP_PROF_SKIP, depth);
+    // Inserting never moves other entries, so unlocked lookups stay valid;
+    // the key is published last
+    for (size_t i = heap_prof_slot(p); ; i = (i + 1) & (HEAP_PROF_TABLE - 1)) {
+        heap_prof_entry_t *e = &heap_prof.table[i];
+        if (e->ptr == NULL) {
+            e->size = size;
+            e->weight = weight;
+            e->stack = stack;
+            __atomic_store_n(&e->ptr, p, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    __atomic_store_n(&heap_prof.live, heap_prof.live + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&heap_prof.lock);
+}
+
+static inline void heap_profiler_on_alloc(void *p, size_t size) {
+    if (!heap_prof.interval || !p) return;
+    heap_prof_thread_t *t = &heap_prof_thread;
+    t->countdown -= (long)size;
+    if (__builtin_expect(t->countdown <= 0, 0))
+        heap_profiler_sample(p, size);
+}
+
+static inline long heap_prof_find(const void *p) {
+    for (size_t i = heap_prof_slot(p); ; i = (i + 1) & (HEAP_PROF_TABLE - 1)) {
+        void *key = __atomic_load_n(&heap_prof.table[i].ptr, __ATOMIC_ACQUIRE);
+        if (key == p) return (long)i;
+        if (key == NULL) return -1;
+    }
+}
+
+// Lock held. Empties slot i and pulls later entries of the chain back into
+// the gap, so no tombstones build up.
+static void heap_prof_remove(size_t i) {
+    __atomic_store_n(&heap_prof.seq, heap_prof.seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&heap_prof.table[i].ptr, NULL, __ATOMIC_RELEASE);
+    for (size_t j = i; ; ) {
+        j = (j + 1) & (HEAP_PROF_TABLE - 1);
+        void *key = heap_prof.table[j].ptr;
+        if (key == NULL) break;
+        size_t home = heap_prof_slot(key);
+        // Entries whose home lies cyclically in (i, j] are still reachable
+        if (i <= j ? (home > i && home <= j) : (home > i || home <= j)) continue;
+        heap_prof.table[i].size = heap_prof.table[j].size;
+        heap_prof.table[i].weight = heap_prof.table[j].weight;
+        heap_prof.table[i].stack = heap_prof.table[j].stack;
+        __atomic_store_n(&heap_prof.table[i].ptr, key, __ATOMIC_RELEASE);
+        __atomic_store_n(&heap_prof.table[j].ptr, NULL, __ATOMIC_RELEASE);
+        i = j;
+    }
+    __atomic_store_n(&heap_prof.live, heap_prof.live - 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&heap_prof.seq, heap_prof.seq + 1, __ATOMIC_RELEASE);
+}
+
+// Call before handing p back to the allocator. p was published before it
+// could reach the freeing thread, so an unlocked miss is final unless a
+// removal moved entries meanwhile; the sequence count catches that and the
+// lookup is repeated under the lock.
+static inline void heap_profiler_on_free(void *p) {
+    if (!p || __atomic_load_n(&heap_prof.live, __ATOMIC_ACQUIRE) == 0) return;
+    unsigned long seq = __atomic_load_n(&heap_prof.seq, __ATOMIC_ACQUIRE);
+    if (!(seq & 1) && heap_prof_find(p) < 0) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&heap_prof.seq, __ATOMIC_RELAXED) == seq) return;
+    }
+    pthread_mutex_lock(&heap_prof.lock);
+    long i = heap_prof_find(p);
+    if (i >= 0) heap_prof_remove((size_t)i);
+    pthread_mutex_unlock(&heap_prof.lock);
+}
+
+// Estimated bytes held by sampled objects still live
+static inline double heap_profiler_live_bytes(void) {
+    double total = 0;
+    pthread_mutex_lock(&heap_prof.lock);
+    for (int i = 0; i < HEAP_PROF_TABLE; i++) {
+        if (heap_prof.table[i].ptr) total += heap_prof.table[i].weight;
+    }
+    pthread_mutex_unlock(&heap_prof.lock);
+    return total;
+}
+
+typedef struct {
+    int stack;
+    long objects;
+    double bytes;
+} heap_prof_site_t;
+
+static int heap_prof_site_cmp(const void *a, const void *b) {
+    double x = ((const heap_prof_site_t *)a)->bytes, y = ((const heap_prof_site_t *)b)->bytes;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Live sampled objects grouped by allocation stack, largest estimate first
+static void heap_profiler_report(FILE *out, int top) {
+    static heap_prof_site_t sites[HEAP_PROF_STACKS];
+    memset(sites, 0, sizeof(sites));
+    pthread_mutex_lock(&heap_prof.lock);
+    double total = 0;
+    long objects = 0;
+    for (int i = 0; i < HEAP_PROF_TABLE; i++) {
+        heap_prof_entry_t *e = &heap_prof.table[i];
+        if (!e->ptr) continue;
+        sites[e->stack].stack = e->stack;
+        sites[e->stack].objects++;
+        sites[e->stack].bytes += e->weight;
+        total += e->weight;
+        objects++;
+    }
+    qsort(sites, HEAP_PROF_STACKS, sizeof(sites[0]), heap_prof_site_cmp);
+    fprintf(out, "Heap profile: %ld sampled objects live, about %.1f KB (interval %zu B, %lu samples, %lu dropped)\n",
+            objects, total / 1024.0, heap_prof.interval, heap_prof.samples, heap_prof.dropped);
+    for (int i = 0; i < top && i < HEAP_PROF_STACKS && sites[i].objects; i++) {
+        heap_prof_stack_t *s = &heap_prof.stacks[sites[i].stack];
+        fprintf(out, "  #%d  about %.1f KB in %ld sampled objects (%.1f%%)\n", i + 1,
+                sites[i].bytes / 1024.0, sites[i].objects, total > 0 ? 100.0 * sites[i].bytes / total : 0.0);
+        if (sites[i].stack == 0) {
+            fprintf(out, "      (stack table full)\n");
+            continue;
+        }
+#ifdef __GLIBC__
+        char **names = backtrace_symbols(s->frames, s->depth);
+        for (int f = 0; f < s->depth; f++)
+            fprintf(out, "      %s\n", names ? names[f] : "?");
+        free(names);
+#else
+        for (int f = 0; f < s->depth; f++)
+            fprintf(out, "      %p\n", s->frames[f]);
+#endif
+    }
+    pthread_mutex_unlock(&heap_prof.lock);
+    fflush(out);
+}
+
+static void heap_profiler_report_at_exit(void) {
+    if (heap_prof.interval) heap_profiler_report(stderr, 10);
+}
+
+// Forget every sample and stack; the interval stays. Not safe while other
+// threads are allocating.
+static inline void heap_profiler_reset(void) {
+    pthread_mutex_lock(&heap_prof.lock);
+    memset(heap_prof.table, 0, sizeof(heap_prof.table));
+    memset(heap_prof.stacks, 0, sizeof(heap_prof.stacks));
+    heap_prof.num_stacks = 0;
+    heap_prof.samples = heap_prof.dropped = 0;
+    heap_prof.sampled_bytes = 0;
+    __atomic_store_n(&heap_prof.live, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&heap_prof.lock);
+}
+
+// interval: mean bytes between samples, 0 turns sampling off. Threads pick
+// up a new interval with their next budget. With report_at_exit set, live
+// samples are printed to stderr as leaks when the process exits.
+static inline void heap_profiler_init(size_t interval, int report_at_exit) {
+    static int registered;
+#ifdef __GLIBC__
+    void *warm[1];
+    backtrace(warm, 1);   // the first call loads libgcc_s and allocates
+#endif
+    heap_prof.interval = interval;
+    if (report_at_exit && !registered) {
+        registered = 1;
+        atexit(heap_profiler_report_at_exit);
+    }
+}
+
+#endif
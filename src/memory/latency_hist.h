@@ -0,0 +1,43 @@
+// Log-linear latency histogram shared by the memory benchmarks: exact below
+// 64 ns, then 16 sub-buckets per power of two, so any value up to 2^63 lands
+// in a bucket no more than 1/16 wide. Callers own the unsigned long
+// [HIST_BUCKETS] arrays and merge them by adding bucket by bucket.
+// Header-only, like allocators.h.
+#ifndef MEMORY_LATENCY_HIST_H
+#define MEMORY_LATENCY_HIST_H
+
+#define HIST_LINEAR  64
+#define HIST_SUB     16
+#define HIST_BUCKETS (HIST_LINEAR + 58 * HIST_SUB)
+
+static inline int hist_bucket(unsigned long long v) {
+    if (v < HIST_LINEAR) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int idx = HIST_LINEAR + (msb - 6) * HIST_SUB + (int)((v >> (msb - 4)) & (HIST_SUB - 1));
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+// Lower bound of a bucket
+static inline unsigned long long hist_value(int idx) {
+    if (idx < HIST_LINEAR) return idx;
+    int msb = (idx - HIST_LINEAR) / HIST_SUB + 6;
+    unsigned long long sub = (idx - HIST_LINEAR) % HIST_SUB;
+    return (1ULL << msb) | (sub << (msb - 4));
+}
+
+static inline unsigned long long percentile(const unsigned long *hist, unsigned long total, double p) {
+    unsigned long target = (unsigned long)(total * p), seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > target) return hist_value(i);
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+static inline unsigned long long hist_max(const unsigned long *hist) {
+    for (int i = HIST_BUCKETS - 1; i > 0; i--)
+        if (hist[i]) return hist_value(i);
+    return 0;
+}
+
+#endif
@@ -1,33 +1,67 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "allocators.h"
+
 #define NUM_ALLOCS 10000
-#define ALLOC_SIZE 2048 // 1KB
+#define ALLOC_SIZE 2048 // 2KB
 
-int main() {
-    void *ptrs[NUM_ALLOCS];
+static void run(enum allocator_kind kind) {
+    static void *ptrs[NUM_ALLOCS];
     clock_t start, end;
-    
-    // Measure allocation time
-    start = clock();
-    for (int i = 0; i < NUM_ALLOCS; i++) {
-        ptrs[i] = malloc(ALLOC_SIZE);
-        if (!ptrs[i]) {
-            printf("Memory allocation failed at %d\n", i);
-            break;
+    allocator_t *a = allocator_create(kind, ALLOC_SIZE, 0);
+    if (!a) {
+        perror("allocator_create");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[%s]\n", allocator_names[kind]);
+
+    // Two rounds: the second shows how well freed blocks are reused
+    for (int round = 0; round < 2; round++) {
+        int n = 0;
+
+        // Measure allocation time
+        start = clock();
+        for (; n < NUM_ALLOCS; n++) {
+            ptrs[n] = allocator_alloc(a, ALLOC_SIZE);
+            if (!ptrs[n]) {
+                printf("Memory allocation failed at %d\n", n);
+                break;
+            }
+        }
+        end = clock();
+        printf("Round %d Allocation Time: %lf seconds\n", round + 1, (double)(end - start) / CLOCKS_PER_SEC);
+
+        // Measure deallocation time
+        start = clock();
+        for (int i = 0; i < n; i++) {
+            allocator_free(a, ptrs[i]);
+        }
+        allocator_reset(a);
+        end = clock();
+        printf("Round %d Deallocation Time: %lf seconds\n", round + 1, (double)(end - start) / CLOCKS_PER_SEC);
+    }
+
+    allocator_destroy(a);
+}
+
+int main(int argc, char *argv[]) {
+    int only = ALLOC_MALLOC;
+    if (argc > 1) {
+        only = strcmp(argv[1], "all") == 0 ? -1 : allocator_parse(argv[1]);
+        if (only < 0 && strcmp(argv[1], "all") != 0) {
+            fprintf(stderr, "Usage: %s [malloc|pool|slab|arena|tlsf|all]\n", argv[0]);
+            return 1;
         }
     }
-    end = clock();
-    printf("Allocation Time: %lf seconds\n", (double)(end - start) / CLOCKS_PER_SEC);
 
-    // Measure deallocation time
-    start = clock();
-    for (int i = 0; i < NUM_ALLOCS; i++) {
-        free(ptrs[i]);
+    for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+        if (only >= 0 && k != only) continue;
+        run((enum allocator_kind)k);
     }
-    end = clock();
-    printf("Deallocation Time: %lf seconds\n", (double)(end - start) / CLOCKS_PER_SEC);
 
     return 0;
 }
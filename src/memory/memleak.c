@@ -1,26 +1,351 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
-#define NUM_LEAKS 1000
-#define BLOCK_SIZE 1024  // 1 KB per leak
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
 
-int main() {
-    printf("Starting memory leak test...\n");
+#include "allocators.h"
+#include "latency_hist.h"
+#include "heap_profiler.h"
 
-    // Leak memory by not freeing it
+#define CACHE_LINE_SIZE   64
+#define DEFAULT_OPS       2000000    // alloc + free operations per thread
+#define DEFAULT_LIVE      65536      // objects each thread holds at once
+#define MAX_THREADS       256
+#define OBJ_MIN           16
+#define OBJ_MAX           1024
+#define SIZE_TABLE        65536      // pre-drawn sizes, shared read-only
+#define LAT_SAMPLE_EVERY  8          // time one op in eight to keep clock reads off the fast path
+#define LEAK_INTERVAL     (512 * 1024)
+#define NUM_LEAKS         10000
+#define BLOCK_SIZE        1024       // 1 KB per small leak
+#define NUM_LARGE_LEAKS   64
+#define LARGE_BLOCK_SIZE  (64 * 1024)
+
+// Mean bytes between samples; 0 is the baseline with the profiler off.
+// 512 KB is the usual production default, 4 KB is a debugging setting.
+static const size_t intervals[] = { 0, 2 * 1024 * 1024, 512 * 1024, 64 * 1024, 4 * 1024 };
+#define NUM_INTERVALS (int)(sizeof(intervals) / sizeof(intervals[0]))
+
+typedef struct {
+    int id;
+    int cpu;
+    long ops;
+    long live;
+    unsigned long long rng;
+    unsigned long allocs, frees;
+    size_t live_bytes;  // true bytes held when the run finished
+    long long finish_ns;
+    unsigned long alloc_hist[HIST_BUCKETS];
+    unsigned long free_hist[HIST_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_t;
+
+static size_t sizes[SIZE_TABLE];
+static enum allocator_kind alloc_kind;
+static size_t tlsf_region;
+static pthread_barrier_t start_barrier, measure_barrier;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static inline unsigned long long xorshift64(unsigned long long *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// The profiler hooks sit next to the allocator calls, as they would in an
+// allocator wrapper in production, so their cost lands in the timed region
+static inline void *tracked_alloc(worker_t *w, allocator_t *a, size_t size) {
+    void *p;
+    if ((w->allocs++ & (LAT_SAMPLE_EVERY - 1)) == 0) {
+        long long t0 = now_ns();
+        p = allocator_alloc(a, size);
+        heap_profiler_on_alloc(p, size);
+        w->alloc_hist[hist_bucket((unsigned long long)(now_ns() - t0))]++;
+    } else {
+        p = allocator_alloc(a, size);
+        heap_profiler_on_alloc(p, size);
+    }
+    if (!p) {
+        fprintf(stderr, "%s(%zu) failed in worker %d\n", allocator_names[alloc_kind], size, w->id);
+        exit(EXIT_FAILURE);
+    }
+    *(volatile char *)p = 1;   // touch it, as a real caller would
+    return p;
+}
+
+static inline void tracked_free(worker_t *w, allocator_t *a, void *p) {
+    if ((w->frees++ & (LAT_SAMPLE_EVERY - 1)) == 0) {
+        long long t0 = now_ns();
+        heap_profiler_on_free(p);
+        allocator_free(a, p);
+        w->free_hist[hist_bucket((unsigned long long)(now_ns() - t0))]++;
+    } else {
+        heap_profiler_on_free(p);
+        allocator_free(a, p);
+    }
+}
+
+// Random replacement in a window of `live` blocks: a steady-state heap with
+// varied lifetimes, the shape a long-running service has
+static void* worker_function(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    if (pin_self(w->cpu) != 0)
+        fprintf(stderr, "warning: could not pin worker %d to CPU %d\n", w->id, w->cpu);
+
+    allocator_t *a = alloc_kind == ALLOC_TLSF ? allocator_create_tlsf(tlsf_region, 0)
+                                              : allocator_create(alloc_kind, OBJ_MAX, 0);
+    void **slots = malloc(w->live * sizeof(void *));
+    size_t *slot_size = malloc(w->live * sizeof(size_t));
+    if (!a || !slots || !slot_size) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    unsigned long idx = (unsigned long)w->id * 7919;
+    for (long i = 0; i < w->live; i++) {
+        slot_size[i] = sizes[idx++ & (SIZE_TABLE - 1)];
+        slots[i] = allocator_alloc(a, slot_size[i]);
+        heap_profiler_on_alloc(slots[i], slot_size[i]);
+        w->live_bytes += slot_size[i];
+    }
+    pthread_barrier_wait(&start_barrier);
+    for (long done = 0; done < w->ops; done += 2) {
+        long s = (long)(xorshift64(&w->rng) % (unsigned long long)w->live);
+        tracked_free(w, a, slots[s]);
+        w->live_bytes -= slot_size[s];
+        slot_size[s] = sizes[idx++ & (SIZE_TABLE - 1)];
+        slots[s] = tracked_alloc(w, a, slot_size[s]);
+        w->live_bytes += slot_size[s];
+    }
+    w->finish_ns = now_ns();
+
+    // Main compares the profiler's live estimate with the truth here
+    pthread_barrier_wait(&measure_barrier);
+    pthread_barrier_wait(&measure_barrier);
+    for (long i = 0; i < w->live; i++) {
+        heap_profiler_on_free(slots[i]);
+        allocator_free(a, slots[i]);
+    }
+    free(slot_size);
+    free(slots);
+    allocator_destroy(a);
+    return NULL;
+}
+
+static void format_interval(char *buf, size_t len, size_t interval) {
+    if (interval == 0) snprintf(buf, len, "off");
+    else if (interval >= 1024 * 1024) snprintf(buf, len, "%zuM", interval >> 20);
+    else if (interval >= 1024) snprintf(buf, len, "%zuK", interval >> 10);
+    else snprintf(buf, len, "%zu", interval);
+}
+
+// Returns ns per op, or 0 if nothing completed
+static double run_config(size_t interval, double baseline_ns, int nthreads, int ncpus, long ops, long live) {
+    heap_profiler_reset();
+    heap_profiler_init(interval, 0);
+
+    worker_t *workers;
+    if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, nthreads * sizeof(worker_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    memset(workers, 0, nthreads * sizeof(worker_t));
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+    pthread_barrier_init(&measure_barrier, NULL, nthreads + 1);
+    for (int i = 0; i < nthreads; i++) {
+        worker_t *w = &workers[i];
+        w->id = i;
+        w->cpu = i % ncpus;
+        w->ops = ops;
+        w->live = live;
+        w->rng = 0x9e3779b97f4a7c15ULL * (i + 1);
+        if (pthread_create(&tids[i], NULL, worker_function, w) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    long long start = now_ns(), end = start;
+    pthread_barrier_wait(&measure_barrier);
+    double estimate = heap_profiler_live_bytes();
+    size_t truth = 0;
+    for (int i = 0; i < nthreads; i++) {
+        truth += workers[i].live_bytes;
+        if (workers[i].finish_ns > end) end = workers[i].finish_ns;
+    }
+    unsigned long samples = heap_prof.samples, dropped = heap_prof.dropped;
+    pthread_barrier_wait(&measure_barrier);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    pthread_barrier_destroy(&start_barrier);
+    pthread_barrier_destroy(&measure_barrier);
+
+    static unsigned long alloc_merged[HIST_BUCKETS], free_merged[HIST_BUCKETS];
+    memset(alloc_merged, 0, sizeof(alloc_merged));
+    memset(free_merged, 0, sizeof(free_merged));
+    unsigned long total_ops = 0, alloc_samples = 0, free_samples = 0;
+    for (int i = 0; i < nthreads; i++) {
+        total_ops += workers[i].allocs + workers[i].frees;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            alloc_merged[b] += workers[i].alloc_hist[b];
+            free_merged[b] += workers[i].free_hist[b];
+            alloc_samples += workers[i].alloc_hist[b];
+            free_samples += workers[i].free_hist[b];
+        }
+    }
+
+    char name[16];
+    format_interval(name, sizeof(name), interval);
+    double elapsed = (double)(end - start), ns_per_op = 0;
+    if (elapsed <= 0 || alloc_samples == 0 || free_samples == 0) {
+        printf("%-7s %8s no operations completed\n", allocator_names[alloc_kind], name);
+    } else {
+        // Per thread, so the figure is comparable across thread counts
+        ns_per_op = elapsed * nthreads / total_ops;
+        char overhead[16] = "-", est[16] = "-", err[16] = "-";
+        if (interval && baseline_ns > 0)
+            snprintf(overhead, sizeof(overhead), "%+.1f%%", 100.0 * (ns_per_op - baseline_ns) / baseline_ns);
+        if (interval) {
+            snprintf(est, sizeof(est), "%.1f", estimate / 1048576.0);
+            snprintf(err, sizeof(err), "%+.1f%%", truth ? 100.0 * (estimate - truth) / truth : 0.0);
+        }
+        printf("%-7s %8s %8.2f %7.1f %9s %6llu %7llu %8llu %9llu %6llu %9llu %8lu %7lu %7s %7.1f %7s\n",
+               allocator_names[alloc_kind], name, total_ops * 1e3 / elapsed, ns_per_op, overhead,
+               percentile(alloc_merged, alloc_samples, 0.50),
+               percentile(alloc_merged, alloc_samples, 0.99),
+               percentile(alloc_merged, alloc_samples, 0.9999),
+               hist_max(alloc_merged),
+               percentile(free_merged, free_samples, 0.99),
+               hist_max(free_merged),
+               samples, dropped, est, truth / 1048576.0, err);
+    }
+    fflush(stdout);
+
+    free(tids);
+    free(workers);
+    return ns_per_op;
+}
+
+// Deliberate leaks from two distinct call sites, for the report at exit.
+// Not static, so -rdynamic can name them.
+__attribute__((noinline)) void leak_small_blocks(void) {
     for (int i = 0; i < NUM_LEAKS; i++) {
         void *leak = malloc(BLOCK_SIZE);
         if (leak == NULL) {
             fprintf(stderr, "Allocation failed at %d\n", i);
-            return 1;
+            exit(EXIT_FAILURE);
         }
+        ((char *)leak)[0] = 'a';   // simulate usage
+        heap_profiler_on_alloc(leak, BLOCK_SIZE);
+        // No free() = memory leak!
+    }
+}
 
-        // Simulate usage
-        ((char *)leak)[0] = 'a';
+__attribute__((noinline)) void leak_large_blocks(void) {
+    for (int i = 0; i < NUM_LARGE_LEAKS; i++) {
+        void *leak = malloc(LARGE_BLOCK_SIZE);
+        if (leak == NULL) {
+            fprintf(stderr, "Allocation failed at %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+        memset(leak, 'a', LARGE_BLOCK_SIZE);
+        heap_profiler_on_alloc(leak, LARGE_BLOCK_SIZE);
+    }
+}
 
-        // No free() = memory leak!
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [malloc|pool|slab|tlsf|all] [threads=1] [ops_per_thread=%d] [live=%d]\n",
+            prog, DEFAULT_OPS, DEFAULT_LIVE);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+        usage(argv[0]);
+
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    int only_alloc = ALLOC_MALLOC;
+    if (argc > 1) {
+        only_alloc = strcmp(argv[1], "all") == 0 ? -1 : allocator_parse(argv[1]);
+        // An arena never frees, so there is nothing for a leak profiler to follow
+        if ((only_alloc < 0 && strcmp(argv[1], "all") != 0) || only_alloc == ALLOC_ARENA) usage(argv[0]);
+    }
+    int nthreads = argc > 2 ? atoi(argv[2]) : 1;
+    if (nthreads <= 0) nthreads = ncpus;
+    if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+    long ops = argc > 3 ? atol(argv[3]) : DEFAULT_OPS;
+    long live = argc > 4 ? atol(argv[4]) : DEFAULT_LIVE;
+    if (ops < 2) ops = DEFAULT_OPS;
+    if (live < 1) live = DEFAULT_LIVE;
+
+    unsigned long long rng = 0x2545f4914f6cdd1dULL;
+    for (int i = 0; i < SIZE_TABLE; i++)
+        sizes[i] = OBJ_MIN + xorshift64(&rng) % (OBJ_MAX - OBJ_MIN + 1);
+    tlsf_region = (size_t)(2 * live * ((OBJ_MIN + OBJ_MAX) / 2 + TLSF_HEADER + ALLOC_ALIGN)) + (1 << 20);
+
+    printf("Heap profiler overhead: %d threads, %ld ops per thread, %ld live blocks of %d-%d bytes, %d CPUs\n",
+           nthreads, ops, live, OBJ_MIN, OBJ_MAX, ncpus);
+    printf("interval: mean bytes between samples; ns/op per thread; latency in ns, sampled on one op in %d\n",
+           LAT_SAMPLE_EVERY);
+    printf("est_MB: profiler's estimate of live bytes at the end of the run, against the true live_MB\n");
+    printf("%-7s %8s %8s %7s %9s %6s %7s %8s %9s %6s %9s %8s %7s %7s %7s %7s\n",
+           "alloc", "interval", "Mops/s", "ns/op", "overhead", "a_p50", "a_p99", "a_p99.99", "a_max",
+           "f_p99", "f_max", "samples", "dropped", "est_MB", "live_MB", "err");
+
+    for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+        if ((only_alloc >= 0 && k != only_alloc) || k == ALLOC_ARENA) continue;
+        alloc_kind = (enum allocator_kind)k;
+        double baseline = 0;
+        for (int i = 0; i < NUM_INTERVALS; i++) {
+            double ns = run_config(intervals[i], baseline, nthreads, ncpus, ops, live);
+            if (intervals[i] == 0) baseline = ns;
+        }
     }
 
-    printf("Finished leaking memory. Exiting now.\n");
+    // The original leak test, now with the profiler watching: it should
+    // attribute about this much to the two leaking call sites at exit
+    heap_profiler_reset();
+    heap_profiler_init(LEAK_INTERVAL, 1);
+    printf("Leaking %d x %d B and %d x %d B (%.1f MB) with a %d KB sampling interval; report on stderr\n",
+           NUM_LEAKS, BLOCK_SIZE, NUM_LARGE_LEAKS, LARGE_BLOCK_SIZE,
+           (NUM_LEAKS * (double)BLOCK_SIZE + NUM_LARGE_LEAKS * (double)LARGE_BLOCK_SIZE) / 1048576.0,
+           LEAK_INTERVAL / 1024);
+    fflush(stdout);
+    leak_small_blocks();
+    leak_large_blocks();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,364 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#include "latency_hist.h"
+
+#define CACHE_LINE_SIZE   64
+#define DEFAULT_MB        64         // mapped and touched per thread
+#define MAX_THREADS       256
+#define HUGE_PAGE_SIZE    (2UL * 1024 * 1024)
+#define FILE_CHUNK        (1024 * 1024)
+
+// What each thread faults in, one base page at a time:
+//   anon      first write to fresh anonymous memory: allocate and zero a page
+//   file      first read of a shared mapping of a file already in the page
+//             cache: no I/O, just mapping the cached page
+//   cow       first write to private memory shared with a forked child:
+//             allocate and copy a page
+//   populate  mmap(MAP_POPULATE) does the faulting up front; the mmap call is
+//             part of the timed work, the touches after it should not fault
+//   thp       anonymous memory with madvise(MADV_HUGEPAGE): one fault per
+//             2 MB if transparent huge pages are available
+//   hugetlb   MAP_HUGETLB from the reserved pool (vm.nr_hugepages)
+enum fault_case { CASE_ANON, CASE_FILE, CASE_COW, CASE_POPULATE, CASE_THP, CASE_HUGETLB, NUM_CASES };
+static const char *case_names[NUM_CASES] = { "anon", "file", "cow", "populate", "thp", "hugetlb" };
+
+typedef struct {
+    int id;
+    int cpu;
+    enum fault_case fcase;
+    char *map;          // what to munmap
+    size_t map_len;
+    char *region;       // what to touch: map, aligned for thp
+    size_t len;
+    int failed;
+    long long work_ns;
+    long long finish_ns;
+    unsigned long pages;
+    unsigned long checksum;
+    unsigned long hist[HIST_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_t;
+
+static long page_size;
+static int file_fd = -1;
+static size_t file_len;
+static pthread_barrier_t start_barrier;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static long fault_count(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
+// One file holding every thread's slice, written through so all of it is in
+// the page cache before any thread maps it. Unlinked at once.
+static int prepare_file(size_t len) {
+    if (file_fd >= 0 && file_len >= len) return 0;
+    if (file_fd < 0) {
+        char path[] = "/tmp/page_fault.XXXXXX";
+        file_fd = mkstemp(path);
+        if (file_fd < 0) return -1;
+        unlink(path);
+    }
+    static char chunk[FILE_CHUNK];
+    memset(chunk, 0x5a, sizeof(chunk));
+    for (size_t off = file_len; off < len; off += FILE_CHUNK) {
+        size_t n = len - off < FILE_CHUNK ? len - off : FILE_CHUNK;
+        if (pwrite(file_fd, chunk, n, (off_t)off) != (ssize_t)n) return -1;
+    }
+    file_len = len;
+    return 0;
+}
+
+// Maps (but, except for cow, does not touch) the worker's region. Returns a
+// reason on failure, NULL on success.
+static const char *setup_region(worker_t *w, size_t len) {
+    int prot = PROT_READ | PROT_WRITE, flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    w->len = len;
+    switch (w->fcase) {
+    case CASE_ANON:
+    case CASE_COW:
+        w->map_len = len;
+        w->map = mmap(NULL, len, prot, flags, -1, 0);
+        break;
+    case CASE_FILE:
+        w->map_len = len;
+        w->map = mmap(NULL, len, PROT_READ, MAP_SHARED, file_fd, (off_t)(w->id * len));
+        break;
+    case CASE_POPULATE:
+#ifndef MAP_POPULATE
+        return "MAP_POPULATE not supported";
+#else
+        return NULL;   // the worker maps it, inside the timed region
+#endif
+    case CASE_THP:
+#ifndef MADV_HUGEPAGE
+        return "MADV_HUGEPAGE not supported";
+#else
+        // Over-allocate so the touched range starts on a huge page boundary
+        w->map_len = len + HUGE_PAGE_SIZE;
+        w->map = mmap(NULL, w->map_len, prot, flags, -1, 0);
+        break;
+#endif
+    case CASE_HUGETLB:
+#ifndef MAP_HUGETLB
+        return "MAP_HUGETLB not supported";
+#else
+        w->len = (len + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        w->map_len = w->len;
+        w->map = mmap(NULL, w->map_len, prot, flags | MAP_HUGETLB, -1, 0);
+        if (w->map == MAP_FAILED) {
+            w->map = NULL;
+            return "no huge pages reserved (vm.nr_hugepages)";
+        }
+        break;
+#endif
+    default:
+        return "unknown case";
+    }
+    if (w->map == MAP_FAILED) {
+        w->map = NULL;
+        return strerror(errno);
+    }
+    w->region = w->map;
+#ifdef MADV_HUGEPAGE
+    if (w->fcase == CASE_THP) {
+        w->region = (char *)(((uintptr_t)w->map + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (madvise(w->region, len, MADV_HUGEPAGE) != 0) return "madvise(MADV_HUGEPAGE) refused";
+    }
+#endif
+    if (w->fcase == CASE_COW)
+        memset(w->region, 1, len);   // private pages the child will share after fork
+    return NULL;
+}
+
+static void* worker_function(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    if (pin_self(w->cpu) != 0)
+        fprintf(stderr, "warning: could not pin worker %d to CPU %d\n", w->id, w->cpu);
+    pthread_barrier_wait(&start_barrier);
+
+    long long start = now_ns();
+#ifdef MAP_POPULATE
+    if (w->fcase == CASE_POPULATE) {
+        w->map_len = w->len;
+        w->map = mmap(NULL, w->len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (w->map == MAP_FAILED) {
+            w->map = NULL;
+            w->failed = 1;
+            w->finish_ns = now_ns();
+            return NULL;
+        }
+        w->region = w->map;
+    }
+#endif
+    // One clock pair per page: cheap next to a fault, and it shows which
+    // touches faulted once huge pages make most of them free
+    volatile char *p = w->region;
+    unsigned long sum = 0;
+    for (size_t off = 0; off < w->len; off += page_size) {
+        long long t0 = now_ns();
+        if (w->fcase == CASE_FILE) sum += p[off];
+        else p[off] = 2;
+        w->hist[hist_bucket((unsigned long long)(now_ns() - t0))]++;
+        w->pages++;
+    }
+    w->finish_ns = now_ns();
+    w->work_ns = w->finish_ns - start;
+    w->checksum = sum;
+    return NULL;
+}
+
+static void run_config(enum fault_case fcase, int nthreads, int ncpus, size_t len) {
+    worker_t *workers;
+    if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, nthreads * sizeof(worker_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    memset(workers, 0, nthreads * sizeof(worker_t));
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *skip = NULL;
+    if (fcase == CASE_FILE && prepare_file(nthreads * len) != 0)
+        skip = "could not create the backing file";
+    for (int i = 0; i < nthreads && !skip; i++) {
+        workers[i].id = i;
+        workers[i].cpu = i % ncpus;
+        workers[i].fcase = fcase;
+        skip = setup_region(&workers[i], len);
+    }
+
+    // The child only holds references to the parent's pages until the
+    // parent has written all of them
+    pid_t child = -1;
+    int hold[2] = { -1, -1 };
+    if (!skip && fcase == CASE_COW) {
+        if (pipe(hold) != 0) {
+            skip = "pipe failed";
+        } else if ((child = fork()) == 0) {
+            char c;
+            close(hold[1]);
+            while (read(hold[0], &c, 1) < 0 && errno == EINTR)
+                ;
+            _exit(0);
+        } else if (child < 0) {
+            skip = "fork failed";
+        }
+        if (hold[0] >= 0) close(hold[0]);
+    }
+
+    if (skip) {
+        printf("%-9s %7d skipped: %s\n", case_names[fcase], nthreads, skip);
+    } else {
+        pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+        for (int i = 0; i < nthreads; i++) {
+            if (pthread_create(&tids[i], NULL, worker_function, &workers[i]) != 0) {
+                perror("pthread_create");
+                exit(EXIT_FAILURE);
+            }
+        }
+        long faults_before = fault_count();
+        pthread_barrier_wait(&start_barrier);
+        long long start = now_ns(), end = start;
+        for (int i = 0; i < nthreads; i++) {
+            pthread_join(tids[i], NULL);
+            if (workers[i].finish_ns > end) end = workers[i].finish_ns;
+        }
+        long faults = fault_count() - faults_before;
+        pthread_barrier_destroy(&start_barrier);
+
+        static unsigned long merged[HIST_BUCKETS];
+        memset(merged, 0, sizeof(merged));
+        unsigned long pages = 0;
+        double ns_per_page = 0;
+        int failed = 0;
+        for (int i = 0; i < nthreads; i++) {
+            failed |= workers[i].failed;
+            pages += workers[i].pages;
+            if (workers[i].pages) ns_per_page += (double)workers[i].work_ns / workers[i].pages;
+            for (int b = 0; b < HIST_BUCKETS; b++) merged[b] += workers[i].hist[b];
+        }
+        ns_per_page /= nthreads;
+        double elapsed = (double)(end - start);
+        if (failed || pages == 0 || elapsed <= 0) {
+            printf("%-9s %7d failed: %s\n", case_names[fcase], nthreads,
+                   failed ? "mmap(MAP_POPULATE) failed" : "no pages touched");
+        } else {
+            printf("%-9s %7d %9.1f %7llu %7llu %8llu %9llu %9ld %9.3f %10.0f %9.2f\n",
+                   case_names[fcase], nthreads, ns_per_page,
+                   percentile(merged, pages, 0.50),
+                   percentile(merged, pages, 0.99),
+                   percentile(merged, pages, 0.9999),
+                   hist_max(merged), faults, (double)faults / pages,
+                   faults * 1e9 / elapsed, pages * (double)page_size * 1e9 / elapsed / 1048576.0);
+        }
+    }
+    fflush(stdout);
+
+    if (child > 0) {
+        close(hold[1]);
+        waitpid(child, NULL, 0);
+    } else if (hold[1] >= 0) {
+        close(hold[1]);
+    }
+    for (int i = 0; i < nthreads; i++)
+        if (workers[i].map) munmap(workers[i].map, workers[i].map_len);
+    free(tids);
+    free(workers);
+}
+
+static void print_thp_mode(void) {
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    char line[128];
+    if (f && fgets(line, sizeof(line), f))
+        printf("Transparent huge pages: %s", line);
+    if (f) fclose(f);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [max_threads=1] [mb_per_thread=%d] [anon|file|cow|populate|thp|hugetlb|all]\n",
+            prog, DEFAULT_MB);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+        usage(argv[0]);
+
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    page_size = sysconf(_SC_PAGESIZE);
+    int max_threads = 1;
+    if (argc > 1) {
+        max_threads = atoi(argv[1]);
+        if (max_threads <= 0) max_threads = ncpus;
+        if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    }
+    long mb = argc > 2 ? atol(argv[2]) : DEFAULT_MB;
+    if (mb <= 0) mb = DEFAULT_MB;
+    int only = -1;
+    if (argc > 3 && strcmp(argv[3], "all") != 0) {
+        only = -2;
+        for (int i = 0; i < NUM_CASES; i++)
+            if (strcmp(argv[3], case_names[i]) == 0) only = i;
+        if (only == -2) usage(argv[0]);
+    }
+    size_t len = (size_t)mb << 20;
+
+    printf("Page fault cost: %ld MB per thread touched one %ld-byte page at a time, %d CPUs\n",
+           mb, page_size, ncpus);
+    if (only < 0 || only == CASE_THP) print_thp_mode();
+    printf("ns/page: thread's time over its pages (populate includes the mmap call); "
+           "latency in ns per touch; flt/page: faults per base page\n");
+    printf("%-9s %7s %9s %7s %7s %8s %9s %9s %9s %10s %9s\n", "case", "threads", "ns/page",
+           "p50", "p99", "p99.99", "max", "faults", "flt/page", "faults/s", "MB/s");
+
+    for (int c = 0; c < NUM_CASES; c++) {
+        if (only >= 0 && c != only) continue;
+        // Powers of two up to max_threads, always ending on max_threads
+        for (int t = 1; ; t *= 2) {
+            if (t > max_threads) t = max_threads;
+            run_config((enum fault_case)c, t, ncpus, len);
+            if (t == max_threads) break;
+        }
+    }
+    if (file_fd >= 0) close(file_fd);
+    return 0;
+}
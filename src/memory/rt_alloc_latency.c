@@ -0,0 +1,313 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#include "allocators.h"
+#include "latency_hist.h"
+
+#define NSEC_PER_SEC      1000000000LL
+#define DEFAULT_OPS       200000
+#define DEFAULT_MAX_SIZE  4096
+#define DEFAULT_LIVE      2048
+#define OPS_PER_CYCLE     32         // RT work per wakeup before sleeping again
+#define CYCLE_SLEEP_NS    100000L    // leaves room for the interference to run
+#define MEM_LOAD_BYTES    (32UL << 20)
+#define CHURN_MAX_SIZE    (64 * 1024)
+#define CHURN_SLOTS       1024
+#define MAX_LOAD_THREADS  256
+#define POOL_LIMIT        ((size_t)1 << 30)
+
+enum profile { PROF_NONE, PROF_CPU, PROF_MEM, PROF_ALLOC, NUM_PROFILES };
+static const char *profile_names[NUM_PROFILES] = { "none", "cpu", "mem", "alloc" };
+
+int sched_policy = SCHED_FIFO;
+
+static volatile int load_stop;
+static enum profile load_profile;
+static unsigned long alloc_hist[HIST_BUCKETS], free_hist[HIST_BUCKETS];
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+int parse_sched_policy(const char *arg) {
+    if (strcmp(arg, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(arg, "rr") == 0) return SCHED_RR;
+    fprintf(stderr, "Unknown policy: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static inline unsigned long long xorshift64(unsigned long long *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Log-uniform in [16, max]: as many 16-32 B requests as 2-4 KB ones
+static inline size_t random_size(unsigned long long *rng, size_t max) {
+    int top = 63 - __builtin_clzll(max);
+    int e = 4 + (int)(xorshift64(rng) % (unsigned long long)(top - 3));
+    size_t lo = (size_t)1 << e;
+    size_t s = lo + xorshift64(rng) % lo;
+    return s > max ? max : s;
+}
+
+static long minor_faults(void) {
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &ru);
+#else
+    getrusage(RUSAGE_SELF, &ru);
+#endif
+    return ru.ru_minflt;
+}
+
+// Interference: one SCHED_OTHER thread per CPU. "alloc" churns the system
+// malloc with sizes up to 64 KB, so heap growth, trimming and arena locks
+// are all in play while the measured thread allocates.
+static void* load_thread_func(void *arg) {
+    int cpu = (int)(intptr_t)arg;
+    pin_self(cpu);
+    volatile unsigned long counter = 0;
+    unsigned long long rng = 0x9e3779b97f4a7c15ULL * (cpu + 1);
+    char *buf = NULL;
+    void **slots = NULL;
+    if (load_profile == PROF_MEM) {
+        buf = malloc(MEM_LOAD_BYTES);
+        if (!buf) return NULL;
+        memset(buf, 0, MEM_LOAD_BYTES);
+    } else if (load_profile == PROF_ALLOC) {
+        slots = calloc(CHURN_SLOTS, sizeof(void *));
+        if (!slots) return NULL;
+    }
+    while (!load_stop) {
+        switch (load_profile) {
+        case PROF_CPU:
+            counter++;
+            break;
+        case PROF_MEM:
+            for (size_t i = 0; i < MEM_LOAD_BYTES && !load_stop; i += 64)
+                buf[i]++;
+            break;
+        case PROF_ALLOC: {
+            int s = (int)(xorshift64(&rng) % CHURN_SLOTS);
+            free(slots[s]);
+            size_t sz = 1 + xorshift64(&rng) % CHURN_MAX_SIZE;
+            slots[s] = malloc(sz);
+            if (slots[s]) memset(slots[s], 1, sz < 256 ? sz : 256);
+            break;
+        }
+        default:
+            return NULL;
+        }
+    }
+    if (slots) {
+        for (int i = 0; i < CHURN_SLOTS; i++) free(slots[i]);
+        free(slots);
+    }
+    free(buf);
+    return NULL;
+}
+
+// Random sizes and random lifetimes: each step picks a slot and frees what
+// is there or allocates into it, so about half the slots are live. Every
+// call is timed.
+static long run_workload(allocator_t *a, long ops, long live, size_t max_size) {
+    void **slots = calloc(live, sizeof(void *));
+    if (!slots) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    unsigned long long rng = 0x2545f4914f6cdd1dULL;
+    long failures = 0;
+    struct timespec gap = { 0, CYCLE_SLEEP_NS };
+
+    for (long done = 0; done < ops; ) {
+        for (int i = 0; i < OPS_PER_CYCLE && done < ops; i++, done++) {
+            long s = (long)(xorshift64(&rng) % (unsigned long long)live);
+            if (slots[s]) {
+                long long t0 = now_ns();
+                allocator_free(a, slots[s]);
+                long long t1 = now_ns();
+                free_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+                slots[s] = NULL;
+            } else {
+                size_t size = random_size(&rng, max_size);
+                long long t0 = now_ns();
+                void *p = allocator_alloc(a, size);
+                long long t1 = now_ns();
+                alloc_hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+                if (!p) {
+                    failures++;
+                    continue;
+                }
+                memset(p, 0, size < 64 ? size : 64);
+                slots[s] = p;
+            }
+        }
+        nanosleep(&gap, NULL);
+    }
+
+    for (long i = 0; i < live; i++)
+        allocator_free(a, slots[i]);
+    free(slots);
+    return failures;
+}
+
+static void run_case(enum allocator_kind kind, enum profile p, long ops, long live, size_t max_size) {
+    // Every pool object is max_size bytes, and mlockall pins all of them
+    size_t pool_bytes = (size_t)live * alloc_round_up(max_size, ALLOC_ALIGN);
+    if (kind == ALLOC_POOL && pool_bytes > POOL_LIMIT) {
+        printf("%-7s %-6s skipped: %ld slots of %zu B would need %.0f MB\n",
+               allocator_names[kind], profile_names[p], live, max_size, pool_bytes / 1048576.0);
+        return;
+    }
+    // Worst case every slot holds a max-size block; double it for fragmentation
+    allocator_t *a = kind == ALLOC_TLSF
+        ? allocator_create_tlsf(2 * live * (max_size + TLSF_HEADER) + (1 << 20), 0)
+        : allocator_create(kind, max_size, 0);
+    if (!a) {
+        printf("%-7s %-6s create failed: %s\n", allocator_names[kind], profile_names[p], strerror(errno));
+        return;
+    }
+
+    load_profile = p;
+    load_stop = 0;
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus > MAX_LOAD_THREADS) ncpus = MAX_LOAD_THREADS;
+    pthread_t loaders[MAX_LOAD_THREADS];
+    int nload = p == PROF_NONE ? 0 : ncpus;
+    // Explicitly SCHED_OTHER so the load never inherits main's RT policy
+    pthread_attr_t load_attr;
+    struct sched_param other = { .sched_priority = 0 };
+    pthread_attr_init(&load_attr);
+    pthread_attr_setinheritsched(&load_attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&load_attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&load_attr, &other);
+    for (int i = 0; i < nload; i++) {
+        if (pthread_create(&loaders[i], &load_attr, load_thread_func, (void *)(intptr_t)i) != 0) {
+            perror("pthread_create load");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_attr_destroy(&load_attr);
+
+    memset(alloc_hist, 0, sizeof(alloc_hist));
+    memset(free_hist, 0, sizeof(free_hist));
+    long faults = minor_faults();
+    long failures = run_workload(a, ops, live, max_size);
+    faults = minor_faults() - faults;
+
+    load_stop = 1;
+    for (int i = 0; i < nload; i++)
+        pthread_join(loaders[i], NULL);
+    allocator_destroy(a);
+
+    unsigned long na = 0, nf = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        na += alloc_hist[i];
+        nf += free_hist[i];
+    }
+    if (na == 0 || nf == 0) {
+        printf("%-7s %-6s no samples\n", allocator_names[kind], profile_names[p]);
+        return;
+    }
+    printf("%-7s %-6s %6llu %7llu %9llu %9llu %8lu %6llu %7llu %9llu %8llu %7ld %6ld\n",
+           allocator_names[kind], profile_names[p],
+           percentile(alloc_hist, na, 0.50), percentile(alloc_hist, na, 0.99),
+           percentile(alloc_hist, na, 0.9999), hist_max(alloc_hist), na,
+           percentile(free_hist, nf, 0.50), percentile(free_hist, nf, 0.99),
+           percentile(free_hist, nf, 0.9999), hist_max(free_hist), faults, failures);
+    fflush(stdout);
+}
+
+static int match(const char *arg, const char **names, int n) {
+    if (!arg || strcmp(arg, "all") == 0) return -1;
+    for (int i = 0; i < n; i++)
+        if (strcmp(arg, names[i]) == 0) return i;
+    fprintf(stderr, "Unknown option: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [fifo|rr] [malloc|pool|slab|arena|tlsf|rt|all] [none|cpu|mem|alloc|all] "
+                "[ops=%d] [max_size=%d] [live=%d]\n", argv[0], DEFAULT_OPS, DEFAULT_MAX_SIZE, DEFAULT_LIVE);
+        fprintf(stderr, "  rt (default) runs malloc and tlsf\n");
+        return EXIT_FAILURE;
+    }
+    if (argc > 1) sched_policy = parse_sched_policy(argv[1]);
+    int only_alloc = -2;   // malloc and tlsf
+    if (argc > 2 && strcmp(argv[2], "rt") != 0)
+        only_alloc = match(argv[2], allocator_names, NUM_ALLOCATOR_KINDS);
+    int only_prof = match(argc > 3 ? argv[3] : NULL, profile_names, NUM_PROFILES);
+    long ops = argc > 4 ? atol(argv[4]) : DEFAULT_OPS;
+    long max_size = argc > 5 ? atol(argv[5]) : DEFAULT_MAX_SIZE;
+    long live = argc > 6 ? atol(argv[6]) : DEFAULT_LIVE;
+    if (ops <= 0) ops = DEFAULT_OPS;
+    if (max_size < 32) max_size = DEFAULT_MAX_SIZE;
+    if (live <= 0) live = DEFAULT_LIVE;
+
+    // The measured thread runs RT on CPU0 with everything locked in memory,
+    // so what is left in the tails is the allocator itself
+    pin_self(0);
+    struct sched_param sp = { .sched_priority = sched_get_priority_max(sched_policy) - 1 };
+    int rc = pthread_setschedparam(pthread_self(), sched_policy, &sp);
+    if (rc != 0)
+        fprintf(stderr, "warning: RT scheduling unavailable (%s), measuring at normal priority\n",
+                strerror(rc));
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall (continuing)");
+
+    // Cost of the timestamps around each call, already included in every sample
+    long long overhead = -1;
+    for (int i = 0; i < 1000; i++) {
+        long long t0 = now_ns(), t1 = now_ns();
+        if (overhead < 0 || t1 - t0 < overhead) overhead = t1 - t0;
+    }
+
+    printf("RT allocator latency: %ld ops, sizes 16..%ld B log-uniform, %ld slots, %d ops per %ld us cycle\n",
+           ops, max_size, live, OPS_PER_CYCLE, CYCLE_SLEEP_NS / 1000);
+    printf("Per-call latency in ns (timer overhead %lld ns included); faults = minor faults in the RT thread\n",
+           overhead);
+    printf("%-7s %-6s %6s %7s %9s %9s %8s %6s %7s %9s %8s %7s %6s\n", "alloc", "load",
+           "a_p50", "a_p99", "a_p99.99", "a_max", "allocs", "f_p50", "f_p99", "f_p99.99", "f_max",
+           "faults", "failed");
+
+    for (int k = 0; k < NUM_ALLOCATOR_KINDS; k++) {
+        if (only_alloc == -2 && k != ALLOC_MALLOC && k != ALLOC_TLSF) continue;
+        if (only_alloc >= 0 && k != only_alloc) continue;
+        for (int p = 0; p < NUM_PROFILES; p++) {
+            if (only_prof >= 0 && p != only_prof) continue;
+            run_case((enum allocator_kind)k, (enum profile)p, ops, live, (size_t)max_size);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,392 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#else
+  #include <sys/syscall.h>
+  #include <sys/eventfd.h>
+  #include <linux/futex.h>
+#endif
+
+#define ITERATIONS_DEFAULT 100000
+#define WARMUP_ITERATIONS  1000
+
+enum primitive { PRIM_PIPE, PRIM_FUTEX, PRIM_SEM, PRIM_CONDVAR, PRIM_YIELD, PRIM_EVENTFD, NUM_PRIMS };
+enum mode { MODE_THREAD, MODE_PROCESS, NUM_MODES };
+enum placement { PLACE_SAME, PLACE_CROSS, PLACE_NONE, NUM_PLACES };
+
+static const char *prim_names[NUM_PRIMS]  = { "pipe", "futex", "sem", "condvar", "yield", "eventfd" };
+static const char *mode_names[NUM_MODES]  = { "thread", "process" };
+static const char *place_names[NUM_PLACES] = { "same", "cross", "none" };
+
+// Two one-directional channels (0: ping -> pong, 1: pong -> ping) for every
+// primitive. Lives in a MAP_SHARED mapping so the same code serves threads and
+// forked processes.
+typedef struct {
+    pthread_mutex_t mutex[2];
+    pthread_cond_t cond[2];
+    volatile int flag[2];
+    sem_t sem[2];
+    int futex_word[2];
+    int pipe_fd[2][2];
+    int event_fd[2];
+} channels_t;
+
+static channels_t *ch;
+static enum primitive prim;
+static int iterations = ITERATIONS_DEFAULT;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int prim_supported(enum primitive p) {
+#ifdef __linux__
+    (void)p;
+    return 1;
+#else
+    return p != PRIM_FUTEX && p != PRIM_EVENTFD;
+#endif
+}
+
+#ifdef __linux__
+static long futex(int *uaddr, int op, int val) {
+    // Non-private ops so the word also works across fork()
+    return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+#endif
+
+static int channels_init(void) {
+    memset(ch, 0, sizeof(*ch));
+    for (int i = 0; i < 2; i++) {
+        switch (prim) {
+        case PRIM_PIPE:
+            if (pipe(ch->pipe_fd[i]) != 0) return -1;
+            break;
+        case PRIM_SEM:
+            if (sem_init(&ch->sem[i], 1, 0) != 0) return -1;
+            break;
+        case PRIM_CONDVAR: {
+            pthread_mutexattr_t ma;
+            pthread_condattr_t ca;
+            pthread_mutexattr_init(&ma);
+            pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+            pthread_condattr_init(&ca);
+            pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+            pthread_mutex_init(&ch->mutex[i], &ma);
+            pthread_cond_init(&ch->cond[i], &ca);
+            pthread_mutexattr_destroy(&ma);
+            pthread_condattr_destroy(&ca);
+            break;
+        }
+#ifdef __linux__
+        case PRIM_EVENTFD:
+            ch->event_fd[i] = eventfd(0, 0);
+            if (ch->event_fd[i] < 0) return -1;
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+static void channels_destroy(void) {
+    for (int i = 0; i < 2; i++) {
+        switch (prim) {
+        case PRIM_PIPE:
+            close(ch->pipe_fd[i][0]);
+            close(ch->pipe_fd[i][1]);
+            break;
+        case PRIM_SEM:
+            sem_destroy(&ch->sem[i]);
+            break;
+        case PRIM_CONDVAR:
+            pthread_cond_destroy(&ch->cond[i]);
+            pthread_mutex_destroy(&ch->mutex[i]);
+            break;
+        case PRIM_EVENTFD:
+            close(ch->event_fd[i]);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void chan_signal(int c) {
+    switch (prim) {
+    case PRIM_PIPE: {
+        char b = 0;
+        if (write(ch->pipe_fd[c][1], &b, 1) != 1) perror("write");
+        break;
+    }
+#ifdef __linux__
+    case PRIM_FUTEX:
+        __atomic_store_n(&ch->futex_word[c], 1, __ATOMIC_RELEASE);
+        futex(&ch->futex_word[c], FUTEX_WAKE, 1);
+        break;
+    case PRIM_EVENTFD: {
+        uint64_t v = 1;
+        if (write(ch->event_fd[c], &v, sizeof(v)) != sizeof(v)) perror("write eventfd");
+        break;
+    }
+#endif
+    case PRIM_SEM:
+        sem_post(&ch->sem[c]);
+        break;
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&ch->mutex[c]);
+        ch->flag[c] = 1;
+        pthread_cond_signal(&ch->cond[c]);
+        pthread_mutex_unlock(&ch->mutex[c]);
+        break;
+    case PRIM_YIELD:
+        __atomic_store_n(&ch->flag[c], 1, __ATOMIC_RELEASE);
+        break;
+    default:
+        break;
+    }
+}
+
+static void chan_wait(int c) {
+    switch (prim) {
+    case PRIM_PIPE: {
+        char b;
+        if (read(ch->pipe_fd[c][0], &b, 1) != 1) perror("read");
+        break;
+    }
+#ifdef __linux__
+    case PRIM_FUTEX:
+        while (__atomic_load_n(&ch->futex_word[c], __ATOMIC_ACQUIRE) == 0)
+            futex(&ch->futex_word[c], FUTEX_WAIT, 0);
+        __atomic_store_n(&ch->futex_word[c], 0, __ATOMIC_RELAXED);
+        break;
+    case PRIM_EVENTFD: {
+        uint64_t v;
+        if (read(ch->event_fd[c], &v, sizeof(v)) != sizeof(v)) perror("read eventfd");
+        break;
+    }
+#endif
+    case PRIM_SEM:
+        while (sem_wait(&ch->sem[c]) != 0 && errno == EINTR)
+            ;
+        break;
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&ch->mutex[c]);
+        while (!ch->flag[c])
+            pthread_cond_wait(&ch->cond[c], &ch->mutex[c]);
+        ch->flag[c] = 0;
+        pthread_mutex_unlock(&ch->mutex[c]);
+        break;
+    case PRIM_YIELD:
+        while (!__atomic_load_n(&ch->flag[c], __ATOMIC_ACQUIRE))
+            sched_yield();
+        ch->flag[c] = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+// Pins the calling thread (or single-threaded process); cpu < 0 leaves it unpinned
+static void pin_self(int cpu) {
+    if (cpu < 0) return;
+#ifdef __QNX__
+    if (ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1)
+        perror("ThreadCtl(RUNMASK)");
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+        perror("sched_setaffinity");
+#endif
+}
+
+static void pong_loop(int cpu) {
+    pin_self(cpu);
+    for (int i = 0; i < WARMUP_ITERATIONS + iterations; i++) {
+        chan_wait(0);
+        chan_signal(1);
+    }
+}
+
+static void* pong_thread(void *arg) {
+    pong_loop((int)(intptr_t)arg);
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Signal + wait on one channel from a single thread: the primitive's own cost
+// with no blocking and no context switch.
+static double primitive_overhead_ns(void) {
+    if (prim == PRIM_YIELD) {
+        long long t0 = now_ns();
+        for (int i = 0; i < iterations; i++) sched_yield();
+        return (double)(now_ns() - t0) / iterations;
+    }
+    long long t0 = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        chan_signal(0);
+        chan_wait(0);
+    }
+    return (double)(now_ns() - t0) / iterations;
+}
+
+static void run_case(enum mode mode, enum placement place, int cpu_a, int cpu_b, long long *samples) {
+    if (channels_init() != 0) {
+        fprintf(stderr, "%s: channel setup failed: %s\n", prim_names[prim], strerror(errno));
+        return;
+    }
+    double overhead = primitive_overhead_ns();
+
+    int ping_cpu = place == PLACE_NONE ? -1 : cpu_a;
+    int pong_cpu = place == PLACE_NONE ? -1 : (place == PLACE_SAME ? cpu_a : cpu_b);
+
+    pthread_t thr;
+    pid_t pid = -1;
+    if (mode == MODE_THREAD) {
+        if (pthread_create(&thr, NULL, pong_thread, (void *)(intptr_t)pong_cpu) != 0) {
+            perror("pthread_create");
+            channels_destroy();
+            return;
+        }
+    } else {
+        pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            channels_destroy();
+            return;
+        }
+        if (pid == 0) {
+            pong_loop(pong_cpu);
+            _exit(0);
+        }
+    }
+
+    // Save and restore the parent's affinity so later cases start unpinned
+#ifdef __linux__
+    cpu_set_t saved;
+    sched_getaffinity(0, sizeof(saved), &saved);
+#endif
+    pin_self(ping_cpu);
+
+    for (int i = 0; i < WARMUP_ITERATIONS; i++) {
+        chan_signal(0);
+        chan_wait(1);
+    }
+    long long total_start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        long long t0 = now_ns();
+        chan_signal(0);
+        chan_wait(1);
+        samples[i] = (now_ns() - t0) / 2;   // one round trip = two switches
+    }
+    long long total = now_ns() - total_start;
+
+    if (mode == MODE_THREAD)
+        pthread_join(thr, NULL);
+    else
+        waitpid(pid, NULL, 0);
+#ifdef __linux__
+    sched_setaffinity(0, sizeof(saved), &saved);
+#elif defined(__QNX__)
+    ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)~0u);
+#endif
+    channels_destroy();
+
+    qsort(samples, iterations, sizeof(long long), cmp_ll);
+    double avg = (double)total / iterations / 2.0;
+    printf("%-8s %-8s %-6s %9.0f %8lld %8lld %8lld %8lld %9lld %9.0f %9.0f\n",
+           prim_names[prim], mode_names[mode], place_names[place],
+           avg, samples[0], samples[iterations / 2],
+           samples[(long)(iterations * 0.99)], samples[(long)(iterations * 0.999)],
+           samples[iterations - 1], overhead, avg - overhead);
+}
+
+static int parse_choice(const char *arg, const char **names, int count, const char *what) {
+    if (strcmp(arg, "all") == 0) return -1;
+    for (int i = 0; i < count; i++)
+        if (strcmp(arg, names[i]) == 0) return i;
+    fprintf(stderr, "Unknown %s: %s\n", what, arg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    int only_prim = -1, only_mode = -1, only_place = -1;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr,
+                "Usage: %s [pipe|futex|sem|condvar|yield|eventfd|all] [thread|process|all] "
+                "[same|cross|none|all] [iterations=%d]\n", argv[0], ITERATIONS_DEFAULT);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1) only_prim = parse_choice(argv[1], prim_names, NUM_PRIMS, "primitive");
+    if (argc > 2) only_mode = parse_choice(argv[2], mode_names, NUM_MODES, "mode");
+    if (argc > 3) only_place = parse_choice(argv[3], place_names, NUM_PLACES, "placement");
+    if (argc > 4) {
+        iterations = atoi(argv[4]);
+        if (iterations <= 0) iterations = ITERATIONS_DEFAULT;
+    }
+
+    ch = mmap(NULL, sizeof(channels_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    long long *samples = malloc(iterations * sizeof(long long));
+    if (ch == MAP_FAILED || !samples) {
+        perror("allocation");
+        return EXIT_FAILURE;
+    }
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int cpu_a = 0, cpu_b = ncpu > 1 ? 1 : -1;
+
+    printf("Context switch cost per one-way switch (ns), %d round trips per case\n", iterations);
+    printf("prim_ns: signal+wait on one thread without blocking; sched_ns: avg - prim_ns\n");
+    printf("%-8s %-8s %-6s %9s %8s %8s %8s %8s %9s %9s %9s\n",
+           "prim", "mode", "place", "avg", "min", "p50", "p99", "p99.9", "max", "prim_ns", "sched_ns");
+
+    for (int p = 0; p < NUM_PRIMS; p++) {
+        if (only_prim >= 0 && p != only_prim) continue;
+        if (!prim_supported(p)) {
+            printf("%-8s not supported on this OS\n", prim_names[p]);
+            continue;
+        }
+        prim = p;
+        for (int m = 0; m < NUM_MODES; m++) {
+            if (only_mode >= 0 && m != only_mode) continue;
+            for (int pl = 0; pl < NUM_PLACES; pl++) {
+                if (only_place >= 0 && pl != only_place) continue;
+                if (pl == PLACE_CROSS && cpu_b < 0) {
+                    printf("%-8s %-8s %-6s needs at least 2 CPUs, skipped\n",
+                           prim_names[p], mode_names[m], place_names[pl]);
+                    continue;
+                }
+                run_case(m, pl, cpu_a, cpu_b, samples);
+                fflush(stdout);
+            }
+        }
+    }
+
+    free(samples);
+    munmap(ch, sizeof(channels_t));
+    return 0;
+}
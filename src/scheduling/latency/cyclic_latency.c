@@ -0,0 +1,618 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+  #include <sys/trace.h>
+#else
+  #include <sys/timerfd.h>
+#endif
+
+#define NSEC_PER_SEC       1000000000LL
+#define DEFAULT_PERIOD_US  1000
+#define DEFAULT_PRIORITY   80
+#define DEFAULT_ITERATIONS 10000
+#define MAX_CPUS           256
+#define HIST_BUCKETS       1000   // 1 us per bucket, anything above goes to overflow
+#define DEFAULT_WINDOW_S   60
+#define WINDOW_GRACE_NS    50000000LL  // slack for workers to publish a finished window
+
+enum wake_mode { WAKE_NANOSLEEP, WAKE_TIMERFD };
+
+// Latency accounting for one measurement thread (or the aggregate of all of them)
+typedef struct {
+    uint64_t hist[HIST_BUCKETS];
+    uint64_t overflow;
+    uint64_t samples;
+    uint64_t missed;       // timerfd expirations that were never serviced
+    uint64_t spikes;       // samples above the spike threshold
+    long long min_ns;
+    long long max_ns;
+    long double sum_ns;
+} latency_stats_t;
+
+typedef struct {
+    int cpu;
+    pthread_t thread;
+    latency_stats_t stats;
+
+    // Soak mode: the worker fills `window` and hands each finished one over
+    // to the reporting thread through `done_window`.
+    latency_stats_t window;
+    long window_idx;
+    pthread_mutex_t window_lock;
+    latency_stats_t done_window;
+    long done_idx;
+} cpu_worker_t;
+
+static int sched_policy = SCHED_FIFO;
+static int rt_priority = DEFAULT_PRIORITY;
+static long long period_ns = DEFAULT_PERIOD_US * 1000LL;
+static long iterations = DEFAULT_ITERATIONS;
+static enum wake_mode wake_mode = WAKE_NANOSLEEP;
+
+static pthread_barrier_t start_barrier;
+static struct timespec start_ts;   // common time base for every worker's first period
+
+// Soak mode runs until end_ns (or SIGINT/SIGTERM) instead of a fixed count
+static long long soak_ns = 0;
+static long long end_ns = 0;
+static long long window_ns = 0;
+static volatile sig_atomic_t stop = 0;
+
+// Spike capture: every sample above spike_ns is marked in the kernel trace,
+// and the first one freezes a trace snapshot where the kernel supports it.
+static long long spike_ns = 0;
+static int trace_marker_fd = -1;
+static int trace_snapshot_fd = -1;
+static volatile int snapshot_taken = 0;
+
+static inline long long ts_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec ns_ts(long long ns) {
+    struct timespec t = { .tv_sec = ns / NSEC_PER_SEC, .tv_nsec = ns % NSEC_PER_SEC };
+    return t;
+}
+
+static void stats_init(latency_stats_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->min_ns = -1;
+}
+
+static void stats_record(latency_stats_t *s, long long lat_ns) {
+    if (lat_ns < 0) lat_ns = 0;
+    long long bucket = lat_ns / 1000;
+    if (bucket < HIST_BUCKETS)
+        s->hist[bucket]++;
+    else
+        s->overflow++;
+    if (s->min_ns < 0 || lat_ns < s->min_ns) s->min_ns = lat_ns;
+    if (lat_ns > s->max_ns) s->max_ns = lat_ns;
+    s->sum_ns += lat_ns;
+    s->samples++;
+    if (spike_ns > 0 && lat_ns > spike_ns)
+        s->spikes++;
+}
+
+static void stats_merge(latency_stats_t *dst, const latency_stats_t *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        dst->hist[i] += src->hist[i];
+    dst->overflow += src->overflow;
+    dst->missed += src->missed;
+    dst->spikes += src->spikes;
+    if (src->samples > 0) {
+        if (dst->min_ns < 0 || src->min_ns < dst->min_ns) dst->min_ns = src->min_ns;
+        if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    }
+    dst->sum_ns += src->sum_ns;
+    dst->samples += src->samples;
+}
+
+// Upper bound (in us) of the bucket holding the given percentile; samples in
+// the overflow bucket are reported as the observed maximum.
+static long long stats_percentile_us(const latency_stats_t *s, double pct) {
+    if (s->samples == 0) return 0;
+    uint64_t rank = (uint64_t)(pct / 100.0 * (double)s->samples);
+    if (rank >= s->samples) rank = s->samples - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += s->hist[i];
+        if (seen > rank) return i + 1;
+    }
+    return (s->max_ns + 999) / 1000;
+}
+
+static void stats_print(const char *label, const latency_stats_t *s) {
+    double avg_us = s->samples ? (double)(s->sum_ns / s->samples) / 1000.0 : 0.0;
+    printf("%-6s %10llu %8.1f %8.1f %8lld %8lld %8lld %8lld %10.1f %8llu %8llu\n",
+           label, (unsigned long long)s->samples,
+           s->min_ns < 0 ? 0.0 : s->min_ns / 1000.0, avg_us,
+           stats_percentile_us(s, 50.0), stats_percentile_us(s, 99.0),
+           stats_percentile_us(s, 99.9), stats_percentile_us(s, 99.99),
+           s->max_ns / 1000.0,
+           (unsigned long long)s->overflow, (unsigned long long)s->missed);
+}
+
+static int pin_self_to_cpu(int cpu) {
+#ifdef __QNX__
+    if (ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1)
+        return errno;
+    return 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static void open_tracing(void) {
+#ifdef __linux__
+    static const char *roots[] = { "/sys/kernel/tracing", "/sys/kernel/debug/tracing" };
+    char path[64];
+    for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]) && trace_marker_fd < 0; i++) {
+        snprintf(path, sizeof(path), "%s/trace_marker", roots[i]);
+        trace_marker_fd = open(path, O_WRONLY);
+        if (trace_marker_fd >= 0) {
+            snprintf(path, sizeof(path), "%s/snapshot", roots[i]);
+            trace_snapshot_fd = open(path, O_WRONLY);
+        }
+    }
+    if (trace_marker_fd < 0)
+        fprintf(stderr, "Spike capture: no writable trace_marker, spikes are only counted\n");
+    else if (trace_snapshot_fd < 0)
+        fprintf(stderr, "Spike capture: tracing snapshot unavailable, writing markers only\n");
+#endif
+}
+
+static void capture_spike(int cpu, long long lat_ns, long long deadline_ns) {
+    char msg[128];
+    int len = snprintf(msg, sizeof(msg), "cyclic_latency: spike %lld us on cpu %d, deadline %lld\n",
+                       lat_ns / 1000, cpu, deadline_ns);
+#ifdef __QNX__
+    // Shows up in the kernel event trace when tracelogger is running
+    TraceEvent(_NTO_TRACE_INSERTUSRSTREVENT, 1000, msg);
+    (void)len;
+#else
+    if (trace_marker_fd >= 0 && write(trace_marker_fd, msg, len) < 0) {
+        // Nothing useful to do from an RT thread; the spike is still counted
+    }
+    if (trace_snapshot_fd >= 0 && !__atomic_exchange_n(&snapshot_taken, 1, __ATOMIC_ACQ_REL)) {
+        if (write(trace_snapshot_fd, "1", 1) < 0)
+            snapshot_taken = 0;
+    }
+#endif
+}
+
+static void publish_window(cpu_worker_t *w) {
+    pthread_mutex_lock(&w->window_lock);
+    w->done_window = w->window;
+    w->done_idx = w->window_idx;
+    pthread_mutex_unlock(&w->window_lock);
+}
+
+// deadline_ns is the wake-up time the sample belongs to; it decides the window
+static void record_sample(cpu_worker_t *w, long long lat_ns, long long deadline_ns) {
+    stats_record(&w->stats, lat_ns);
+    if (spike_ns > 0 && lat_ns > spike_ns)
+        capture_spike(w->cpu, lat_ns, deadline_ns);
+    if (window_ns > 0) {
+        long idx = (long)((deadline_ns - ts_ns(&start_ts)) / window_ns);
+        if (idx != w->window_idx) {
+            if (w->window.samples > 0)
+                publish_window(w);
+            stats_init(&w->window);
+            w->window_idx = idx;
+        }
+        stats_record(&w->window, lat_ns);
+    }
+}
+
+static inline int keep_running(long i, long long next) {
+    if (end_ns > 0)
+        return !stop && next < end_ns;
+    return i < iterations;
+}
+
+static void run_nanosleep(cpu_worker_t *w) {
+    struct timespec now;
+    long long next = ts_ns(&start_ts);
+
+    for (long i = 0; keep_running(i, next + period_ns); i++) {
+        next += period_ns;
+        struct timespec deadline = ns_ts(next);
+        int rc;
+        while ((rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)) == EINTR)
+            ;
+        if (rc != 0) {
+            fprintf(stderr, "clock_nanosleep: %s\n", strerror(rc));
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        record_sample(w, ts_ns(&now) - next, next);
+    }
+}
+
+#ifndef __QNX__
+static void run_timerfd(cpu_worker_t *w) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (fd < 0) {
+        perror("timerfd_create");
+        return;
+    }
+
+    long long next = ts_ns(&start_ts) + period_ns;
+    struct itimerspec its = {
+        .it_value = ns_ts(next),
+        .it_interval = ns_ts(period_ns)
+    };
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        perror("timerfd_settime");
+        close(fd);
+        return;
+    }
+
+    struct timespec now;
+    for (long i = 0; keep_running(i, next); ) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            if (errno == EINTR) continue;
+            perror("read timerfd");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        // Latency is measured against the most recent expiry; earlier ones
+        // that were coalesced into this read count as missed periods.
+        next += (long long)(expirations - 1) * period_ns;
+        record_sample(w, ts_ns(&now) - next, next);
+        w->stats.missed += expirations - 1;
+        w->window.missed += expirations - 1;
+        next += period_ns;
+        i += (long)expirations;
+    }
+    close(fd);
+}
+#endif
+
+void* cpu_worker(void* arg) {
+    cpu_worker_t *w = (cpu_worker_t *)arg;
+
+    int rc = pin_self_to_cpu(w->cpu);
+    if (rc != 0)
+        fprintf(stderr, "CPU %d: affinity failed: %s\n", w->cpu, strerror(rc));
+
+    struct sched_param sp = { .sched_priority = rt_priority };
+    rc = pthread_setschedparam(pthread_self(), sched_policy, &sp);
+    if (rc != 0)
+        fprintf(stderr, "CPU %d: pthread_setschedparam: %s\n", w->cpu, strerror(rc));
+
+    // Every worker is pinned and prioritized before anyone starts measuring
+    pthread_barrier_wait(&start_barrier);
+
+#ifndef __QNX__
+    if (wake_mode == WAKE_TIMERFD)
+        run_timerfd(w);
+    else
+#endif
+        run_nanosleep(w);
+
+    // Hand over the last, partial soak window
+    if (window_ns > 0 && w->window.samples > 0)
+        publish_window(w);
+    return NULL;
+}
+
+int parse_sched_policy(const char *str) {
+    if (strcmp(str, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(str, "rr") == 0) return SCHED_RR;
+    fprintf(stderr, "Unsupported or unknown policy: %s\n", str);
+    exit(EXIT_FAILURE);
+}
+
+// Parses "all" or a list such as "0,2-5" into cpus[]; returns the count.
+static int parse_cpu_list(const char *str, int *cpus) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int n = 0;
+
+    if (strcmp(str, "all") == 0) {
+        for (int c = 0; c < online && n < MAX_CPUS; c++)
+            cpus[n++] = c;
+        return n;
+    }
+
+    char *copy = strdup(str);
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(copy, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        int lo, hi;
+        if (sscanf(tok, "%d-%d", &lo, &hi) != 2) {
+            if (sscanf(tok, "%d", &lo) != 1) {
+                fprintf(stderr, "Bad CPU list entry: %s\n", tok);
+                exit(EXIT_FAILURE);
+            }
+            hi = lo;
+        }
+        for (int c = lo; c <= hi && n < MAX_CPUS; c++) {
+            if (c < 0 || c >= online) {
+                fprintf(stderr, "CPU %d is not online (0-%ld)\n", c, online - 1);
+                exit(EXIT_FAILURE);
+            }
+            cpus[n++] = c;
+        }
+    }
+    free(copy);
+    return n;
+}
+
+// cyclictest-style histogram: one row per microsecond, one column per CPU
+static void write_histogram(const char *path, cpu_worker_t *workers, int n) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("fopen histogram");
+        return;
+    }
+    fprintf(fp, "# latency_us");
+    for (int i = 0; i < n; i++)
+        fprintf(fp, " cpu%d", workers[i].cpu);
+    fprintf(fp, "\n");
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        fprintf(fp, "%d", b);
+        for (int i = 0; i < n; i++)
+            fprintf(fp, " %llu", (unsigned long long)workers[i].stats.hist[b]);
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "# overflow");
+    for (int i = 0; i < n; i++)
+        fprintf(fp, " %llu", (unsigned long long)workers[i].stats.overflow);
+    fprintf(fp, "\n");
+    fclose(fp);
+}
+
+// "90s", "30m", "12h", "3d" -> nanoseconds; 0 if the string has no unit
+static long long parse_duration_ns(const char *str) {
+    char *end;
+    double v = strtod(str, &end);
+    if (end == str || v <= 0) return 0;
+    switch (*end) {
+    case 's': return (long long)(v * NSEC_PER_SEC);
+    case 'm': return (long long)(v * 60 * NSEC_PER_SEC);
+    case 'h': return (long long)(v * 3600 * NSEC_PER_SEC);
+    case 'd': return (long long)(v * 86400 * NSEC_PER_SEC);
+    default:  return 0;
+    }
+}
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+// Merges every worker's published window `idx` and prints one line for it
+static void print_window(cpu_worker_t *workers, int n, long idx) {
+    latency_stats_t win;
+    stats_init(&win);
+    int reported = 0, worst_cpu = -1;
+    long long worst_ns = -1;
+    for (int i = 0; i < n; i++) {
+        pthread_mutex_lock(&workers[i].window_lock);
+        if (workers[i].done_idx == idx) {
+            stats_merge(&win, &workers[i].done_window);
+            if (workers[i].done_window.max_ns > worst_ns) {
+                worst_ns = workers[i].done_window.max_ns;
+                worst_cpu = workers[i].cpu;
+            }
+            reported++;
+        }
+        pthread_mutex_unlock(&workers[i].window_lock);
+    }
+
+    struct timespec wall;
+    char stamp[32];
+    clock_gettime(CLOCK_REALTIME, &wall);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&wall.tv_sec));
+    double avg_us = win.samples ? (double)(win.sum_ns / win.samples) / 1000.0 : 0.0;
+    printf("%-19s %6ld %10llu %8.1f %8lld %8lld %8lld %8lld %10.1f %7llu %7llu %6llu %5d",
+           stamp, idx, (unsigned long long)win.samples, avg_us,
+           stats_percentile_us(&win, 50.0), stats_percentile_us(&win, 99.0),
+           stats_percentile_us(&win, 99.9), stats_percentile_us(&win, 99.99),
+           win.max_ns / 1000.0, (unsigned long long)win.overflow,
+           (unsigned long long)win.missed, (unsigned long long)win.spikes, worst_cpu);
+    if (reported < n)
+        printf("  (%d/%d CPUs reported)", reported, n);
+    printf("\n");
+    fflush(stdout);
+}
+
+// Soak reporting loop: one line per window until the run ends or is stopped
+static void soak_report(cpu_worker_t *workers, int n) {
+    printf("%-19s %6s %10s %8s %8s %8s %8s %8s %10s %7s %7s %6s %5s\n",
+           "window_end", "window", "samples", "avg_us", "p50_us", "p99_us",
+           "p99.9_us", "p99.99us", "max_us", "ovrflow", "missed", "spikes", "worst");
+    long long start = ts_ns(&start_ts);
+    long idx = 0;
+    while (!stop) {
+        long long report_at = start + (idx + 1) * window_ns;
+        if (report_at >= end_ns) break;
+        struct timespec ts = ns_ts(report_at + 2 * period_ns + WINDOW_GRACE_NS);
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+            continue;   // interrupted: stop was set, or a spurious wakeup
+        print_window(workers, n, idx);
+        if (snapshot_taken == 1) {
+            printf("# tracing snapshot frozen at first spike, see tracing/snapshot\n");
+            snapshot_taken = 2;
+        }
+        idx++;
+    }
+    for (int i = 0; i < n; i++)
+        pthread_join(workers[i].thread, NULL);
+    print_window(workers, n, idx);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s [fifo|rr] [cpus=all] [period_us=%d] [priority=%d] "
+                "[iterations=%d|soak duration e.g. 30m,12h,3d] [nanosleep|timerfd] "
+                "[histogram_file|-] [spike_us=0] [window_s=%d]\n",
+                argv[0], DEFAULT_PERIOD_US, DEFAULT_PRIORITY, DEFAULT_ITERATIONS, DEFAULT_WINDOW_S);
+        exit(EXIT_FAILURE);
+    }
+
+    sched_policy = parse_sched_policy(argv[1]);
+
+    int cpus[MAX_CPUS];
+    int num_cpus = parse_cpu_list(argc > 2 ? argv[2] : "all", cpus);
+    if (num_cpus == 0) {
+        fprintf(stderr, "No CPUs selected\n");
+        exit(EXIT_FAILURE);
+    }
+    if (argc > 3) {
+        long us = atol(argv[3]);
+        if (us > 0) period_ns = us * 1000LL;
+    }
+    if (argc > 4) {
+        int prio = atoi(argv[4]);
+        if (prio >= sched_get_priority_min(sched_policy) &&
+            prio <= sched_get_priority_max(sched_policy))
+            rt_priority = prio;
+        else
+            fprintf(stderr, "Priority %d out of range, using %d\n", prio, rt_priority);
+    }
+    if (argc > 5) {
+        // A value with a time unit switches to soak mode
+        soak_ns = parse_duration_ns(argv[5]);
+        long it = atol(argv[5]);
+        if (soak_ns > 0) iterations = LONG_MAX;
+        else if (it > 0) iterations = it;
+    }
+    if (argc > 6) {
+        if (strcmp(argv[6], "timerfd") == 0) {
+#ifdef __QNX__
+            fprintf(stderr, "timerfd is not available on QNX, using clock_nanosleep\n");
+#else
+            wake_mode = WAKE_TIMERFD;
+#endif
+        } else if (strcmp(argv[6], "nanosleep") != 0) {
+            fprintf(stderr, "Unknown wake mode: %s\n", argv[6]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    const char *hist_path = argc > 7 && strcmp(argv[7], "-") != 0 ? argv[7] : NULL;
+    if (argc > 8) {
+        long us = atol(argv[8]);
+        if (us > 0) spike_ns = us * 1000LL;
+    }
+    if (soak_ns > 0) {
+        long window_s = argc > 9 ? atol(argv[9]) : DEFAULT_WINDOW_S;
+        window_ns = (window_s > 0 ? window_s : DEFAULT_WINDOW_S) * NSEC_PER_SEC;
+    }
+    if (spike_ns > 0)
+        open_tracing();
+
+    // Workers inherit a mask with SIGINT/SIGTERM blocked, so only main sees
+    // them and a soak run can be cut short without losing its summary.
+    sigset_t stop_sigs, old_sigs;
+    sigemptyset(&stop_sigs);
+    sigaddset(&stop_sigs, SIGINT);
+    sigaddset(&stop_sigs, SIGTERM);
+    if (soak_ns > 0) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handle_stop;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        pthread_sigmask(SIG_BLOCK, &stop_sigs, &old_sigs);
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall");
+
+    cpu_worker_t *workers = calloc(num_cpus, sizeof(cpu_worker_t));
+    if (!workers) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // Workers plus main, so main can publish the start time before release
+    pthread_barrier_init(&start_barrier, NULL, num_cpus + 1);
+
+    for (int i = 0; i < num_cpus; i++) {
+        workers[i].cpu = cpus[i];
+        stats_init(&workers[i].stats);
+        stats_init(&workers[i].window);
+        pthread_mutex_init(&workers[i].window_lock, NULL);
+        workers[i].done_idx = -1;
+        int ret = pthread_create(&workers[i].thread, NULL, cpu_worker, &workers[i]);
+        if (ret != 0) {
+            fprintf(stderr, "pthread_create cpu %d failed: %s\n", cpus[i], strerror(ret));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+    start_ts = ns_ts(ts_ns(&start_ts) + period_ns);
+    if (soak_ns > 0)
+        end_ns = ts_ns(&start_ts) + soak_ns;
+    pthread_barrier_wait(&start_barrier);
+
+    if (soak_ns > 0) {
+        pthread_sigmask(SIG_SETMASK, &old_sigs, NULL);
+        printf("Soak run: %d CPU(s), period %lld us, %lld s windows, up to %lld s%s\n",
+               num_cpus, period_ns / 1000, window_ns / NSEC_PER_SEC, soak_ns / NSEC_PER_SEC,
+               spike_ns > 0 ? ", spike capture on" : "");
+        soak_report(workers, num_cpus);
+        printf("\n");
+    } else {
+        for (int i = 0; i < num_cpus; i++)
+            pthread_join(workers[i].thread, NULL);
+    }
+
+    latency_stats_t total;
+    stats_init(&total);
+
+    printf("Cyclic wake-up latency: %d CPU(s), period %lld us, priority %d, %s, ",
+           num_cpus, period_ns / 1000, rt_priority,
+           wake_mode == WAKE_TIMERFD ? "timerfd" : "clock_nanosleep");
+    if (soak_ns > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        printf("soak %.1f s\n", (ts_ns(&now) - ts_ns(&start_ts)) / 1e9);
+    }
+    else
+        printf("%ld iterations\n", iterations);
+    printf("%-6s %10s %8s %8s %8s %8s %8s %8s %10s %8s %8s\n",
+           "CPU", "samples", "min_us", "avg_us", "p50_us", "p99_us",
+           "p99.9_us", "p99.99us", "max_us", "overflow", "missed");
+    for (int i = 0; i < num_cpus; i++) {
+        char label[16];
+        snprintf(label, sizeof(label), "%d", workers[i].cpu);
+        stats_print(label, &workers[i].stats);
+        stats_merge(&total, &workers[i].stats);
+    }
+    stats_print("all", &total);
+    if (spike_ns > 0)
+        printf("Spikes above %lld us: %llu\n", spike_ns / 1000, (unsigned long long)total.spikes);
+
+    if (hist_path)
+        write_histogram(hist_path, workers, num_cpus);
+
+    pthread_barrier_destroy(&start_barrier);
+    for (int i = 0; i < num_cpus; i++)
+        pthread_mutex_destroy(&workers[i].window_lock);
+    free(workers);
+    return 0;
+}
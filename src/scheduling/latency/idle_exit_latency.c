@@ -0,0 +1,312 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define NSEC_PER_SEC       1000000000LL
+#define DEFAULT_PERIODS_US "10,50,100,500,1000,5000,10000,50000,100000"
+#define TIME_PER_PERIOD_NS 2000000000LL   // sampling budget per sleep period
+#define MIN_SAMPLES        20
+#define MAX_SAMPLES        5000
+#define MAX_IDLE_STATES    16
+
+enum condition { COND_DEFAULT, COND_DMA0, COND_SPIN, NUM_CONDITIONS };
+static const char *cond_names[NUM_CONDITIONS] = { "default", "dma0", "spin" };
+
+// cpuidle state of the measured CPU, from /sys/devices/system/cpu/cpuN/cpuidle
+typedef struct {
+    char name[16];
+    long exit_latency_us;
+    unsigned long long usage;
+} idle_state_t;
+
+static int measure_cpu = 1;
+static int num_idle_states;
+static idle_state_t idle_states[MAX_IDLE_STATES];
+static volatile int stop_spinner;
+static int spinner_pinned;
+static sem_t spinner_ready;   // posted once the spinner knows where it runs
+
+static inline long long ts_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec ns_ts(long long ns) {
+    struct timespec t = { .tv_sec = ns / NSEC_PER_SEC, .tv_nsec = ns % NSEC_PER_SEC };
+    return t;
+}
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_ns(&ts);
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static int read_sysfs_line(const char *path, char *buf, size_t len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char *ok = fgets(buf, (int)len, f);
+    fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static void discover_idle_states(void) {
+    char path[128], buf[64];
+    for (num_idle_states = 0; num_idle_states < MAX_IDLE_STATES; num_idle_states++) {
+        idle_state_t *s = &idle_states[num_idle_states];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/name",
+                 measure_cpu, num_idle_states);
+        if (read_sysfs_line(path, s->name, sizeof(s->name)) != 0) break;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/latency",
+                 measure_cpu, num_idle_states);
+        s->exit_latency_us = read_sysfs_line(path, buf, sizeof(buf)) == 0 ? atol(buf) : -1;
+    }
+}
+
+static void snapshot_idle_usage(unsigned long long *usage) {
+    char path[128], buf[64];
+    for (int i = 0; i < num_idle_states; i++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/usage",
+                 measure_cpu, i);
+        usage[i] = read_sysfs_line(path, buf, sizeof(buf)) == 0 ? strtoull(buf, NULL, 10) : 0;
+    }
+}
+
+// Holding /dev/cpu_dma_latency open with 0 written asks PM QoS to keep every
+// CPU out of any idle state with a non-zero exit latency. Released on close.
+static int hold_dma_latency_zero(void) {
+#ifdef __linux__
+    int fd = open("/dev/cpu_dma_latency", O_WRONLY);
+    if (fd < 0) return -1;
+    int32_t zero = 0;
+    if (write(fd, &zero, sizeof(zero)) != sizeof(zero)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+// SMT sibling of the measured CPU; it shares the core, so spinning there
+// keeps the core from entering its deeper (core-wide) idle states
+static int find_sibling(int cpu) {
+    char path[128], buf[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_sysfs_line(path, buf, sizeof(buf)) != 0) return -1;
+    for (char *p = buf; *p; ) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p) break;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi; c++)
+            if (c != cpu) return (int)c;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return -1;
+}
+
+// Unpinned, it would share the measured CPU and measure nothing useful, so
+// main skips the condition instead
+static void* spinner_function(void *arg) {
+    int cpu = (int)(intptr_t)arg;
+    spinner_pinned = pin_self(cpu) == 0;
+    sem_post(&spinner_ready);
+    if (!spinner_pinned) return NULL;
+    volatile unsigned long counter = 0;
+    while (!stop_spinner)
+        counter++;
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Each sample sleeps a full period measured from "now", so the CPU really
+// is idle for that long before the timer fires
+static void measure_period(const char *cond, long period_us, long long *samples) {
+    long long period_ns = period_us * 1000LL;
+    long n = (long)(TIME_PER_PERIOD_NS / period_ns);
+    if (n < MIN_SAMPLES) n = MIN_SAMPLES;
+    if (n > MAX_SAMPLES) n = MAX_SAMPLES;
+
+    unsigned long long before[MAX_IDLE_STATES], after[MAX_IDLE_STATES];
+    snapshot_idle_usage(before);
+
+    double sum = 0;
+    for (long i = 0; i < n; i++) {
+        long long target = now_ns() + period_ns;
+        struct timespec ts = ns_ts(target);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+        samples[i] = now_ns() - target;
+        sum += samples[i];
+    }
+
+    snapshot_idle_usage(after);
+    qsort(samples, n, sizeof(long long), cmp_ll);
+    printf("%-8s %9ld %7ld %8.1f %8.1f %8.1f %8.1f  ", cond, period_us, n,
+           sum / n / 1e3, samples[n / 2] / 1e3, samples[(long)(n * 0.99)] / 1e3,
+           samples[n - 1] / 1e3);
+
+    // Share of idle entries per state over this period's samples
+    unsigned long long total = 0;
+    for (int i = 0; i < num_idle_states; i++) total += after[i] - before[i];
+    if (total == 0) {
+        printf("%s", num_idle_states ? "no idle entries" : "-");
+    } else {
+        for (int i = 0; i < num_idle_states; i++) {
+            unsigned long long d = after[i] - before[i];
+            if (d) printf("%s:%.0f%% ", idle_states[i].name, 100.0 * d / total);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [cpu=1] [period_us_list=%s] [default|dma0|spin|all] [spin_cpu=sibling]\n",
+            prog, DEFAULT_PERIODS_US);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    measure_cpu = ncpus > 1 ? 1 : 0;   // keep clear of CPU0's housekeeping where possible
+    if (argc > 1) {
+        measure_cpu = atoi(argv[1]);
+        if (measure_cpu < 0 || measure_cpu >= ncpus) usage(argv[0]);
+    }
+    const char *periods = argc > 2 ? argv[2] : DEFAULT_PERIODS_US;
+    int only = -1;
+    if (argc > 3 && strcmp(argv[3], "all") != 0) {
+        for (int i = 0; i < NUM_CONDITIONS; i++)
+            if (strcmp(argv[3], cond_names[i]) == 0) only = i;
+        if (only < 0) usage(argv[0]);
+    }
+    int spin_cpu = argc > 4 ? atoi(argv[4]) : find_sibling(measure_cpu);
+
+    if (pin_self(measure_cpu) != 0) {
+        perror("pin measurement thread");
+        return EXIT_FAILURE;
+    }
+    // RT priority keeps the scheduler's own wakeup decisions out of the numbers
+    struct sched_param sp = { .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+        fprintf(stderr, "warning: SCHED_FIFO unavailable, measuring at normal priority\n");
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall (continuing)");
+
+    long long *samples = malloc(MAX_SAMPLES * sizeof(long long));
+    if (!samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    discover_idle_states();
+    printf("Idle exit latency on CPU %d (wake latency after sleeping a full period)\n", measure_cpu);
+    if (num_idle_states == 0) {
+        printf("cpuidle: no states exposed in sysfs\n");
+    } else {
+        printf("cpuidle states:");
+        for (int i = 0; i < num_idle_states; i++)
+            printf(" %s(%ld us)", idle_states[i].name, idle_states[i].exit_latency_us);
+        printf("\n");
+    }
+    printf("%-8s %9s %7s %8s %8s %8s %8s  %s\n", "cond", "period_us", "samples",
+           "mean_us", "p50_us", "p99_us", "max_us", "idle state mix");
+
+    for (int c = 0; c < NUM_CONDITIONS; c++) {
+        if (only >= 0 && c != only) continue;
+
+        int dma_fd = -1;
+        pthread_t spinner;
+        if (c == COND_DMA0) {
+            dma_fd = hold_dma_latency_zero();
+            if (dma_fd < 0) {
+                printf("%-8s skipped: /dev/cpu_dma_latency: %s\n", cond_names[c], strerror(errno));
+                continue;
+            }
+        } else if (c == COND_SPIN) {
+            if (spin_cpu < 0 || spin_cpu == measure_cpu || spin_cpu >= ncpus) {
+                printf("%-8s skipped: no SMT sibling of CPU %d (give spin_cpu explicitly)\n",
+                       cond_names[c], measure_cpu);
+                continue;
+            }
+            // Explicitly SCHED_OTHER so the spinner never inherits main's RT
+            // policy and starves the sibling's kernel threads
+            pthread_attr_t spin_attr;
+            struct sched_param other = { .sched_priority = 0 };
+            pthread_attr_init(&spin_attr);
+            pthread_attr_setinheritsched(&spin_attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&spin_attr, SCHED_OTHER);
+            pthread_attr_setschedparam(&spin_attr, &other);
+            stop_spinner = 0;
+            sem_init(&spinner_ready, 0, 0);
+            int rc = pthread_create(&spinner, &spin_attr, spinner_function, (void *)(intptr_t)spin_cpu);
+            pthread_attr_destroy(&spin_attr);
+            if (rc != 0) {
+                fprintf(stderr, "pthread_create: %s\n", strerror(rc));
+                return EXIT_FAILURE;
+            }
+            // Blocking, so the spinner can run even while it still shares our CPU
+            while (sem_wait(&spinner_ready) != 0 && errno == EINTR)
+                ;
+            sem_destroy(&spinner_ready);
+            if (!spinner_pinned) {
+                pthread_join(spinner, NULL);
+                printf("%-8s skipped: could not pin the spinner to CPU %d\n", cond_names[c], spin_cpu);
+                continue;
+            }
+        }
+
+        for (const char *p = periods; *p; ) {
+            long period_us = atol(p);
+            if (period_us > 0)
+                measure_period(cond_names[c], period_us, samples);
+            p = strchr(p, ',');
+            if (!p) break;
+            p++;
+        }
+
+        if (c == COND_DMA0) {
+            close(dma_fd);
+        } else if (c == COND_SPIN) {
+            stop_spinner = 1;
+            pthread_join(spinner, NULL);
+        }
+    }
+
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define NSEC_PER_SEC      1000000000LL
+#define MAX_TASKS         64
+#define DEFAULT_DURATION  10
+#define START_DELAY_NS    50000000LL   // common critical instant after setup
+
+// One periodic task from the task-set file. Deadline defaults to the period;
+// priority 0 means "assign rate-monotonically"; cpu -1 means unpinned.
+typedef struct {
+    char name[32];
+    long long period_ns;
+    long long wcet_ns;
+    long long deadline_ns;
+    int priority;
+    int cpu;
+
+    pthread_t tid;
+    long long *response_ns;
+    long max_jobs;
+    long jobs;
+    long misses;
+    long long cpu_ns;
+    long long rta_ns;       // analytical worst-case response, -1 if unbounded or n/a
+} task_t;
+
+static task_t tasks[MAX_TASKS];
+static int num_tasks;
+static long long start_ns;
+static long long end_ns;
+static pthread_barrier_t start_barrier;
+
+static inline long long ts_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_ns(&ts);
+}
+
+static inline long long thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts_ns(&ts);
+}
+
+// Consumes exactly `ns` of this thread's CPU time, however often it is preempted
+static void burn_cpu(long long ns) {
+    long long t0 = thread_cpu_ns();
+    while (thread_cpu_ns() - t0 < ns) {}
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+// Format, one task per line ('#' starts a comment):
+//   name period_us wcet_us priority cpu [deadline_us]
+static void load_task_set(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        task_t t;
+        memset(&t, 0, sizeof(t));
+        double period_us, wcet_us, deadline_us = 0;
+        int n = sscanf(line, "%31s %lf %lf %d %d %lf", t.name, &period_us, &wcet_us,
+                       &t.priority, &t.cpu, &deadline_us);
+        if (n <= 0) continue;
+        if (n < 5 || period_us <= 0 || wcet_us <= 0 || t.priority < 0) {
+            fprintf(stderr, "%s:%d: expected 'name period_us wcet_us priority cpu [deadline_us]'\n",
+                    path, lineno);
+            exit(EXIT_FAILURE);
+        }
+        if (num_tasks == MAX_TASKS) {
+            fprintf(stderr, "%s: more than %d tasks\n", path, MAX_TASKS);
+            exit(EXIT_FAILURE);
+        }
+        t.period_ns = (long long)(period_us * 1000);
+        t.wcet_ns = (long long)(wcet_us * 1000);
+        t.deadline_ns = deadline_us > 0 ? (long long)(deadline_us * 1000) : t.period_ns;
+        tasks[num_tasks++] = t;
+    }
+    fclose(f);
+    if (num_tasks == 0) {
+        fprintf(stderr, "%s: no tasks\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Shorter period -> higher priority, counting down from prio_max. Only
+// tasks that asked for it (priority 0) are assigned.
+static void assign_rate_monotonic(int prio_max) {
+    for (int i = 0; i < num_tasks; i++) {
+        if (tasks[i].priority != 0) continue;
+        int shorter = 0;
+        for (int j = 0; j < num_tasks; j++)
+            if (tasks[j].period_ns < tasks[i].period_ns) shorter++;
+        tasks[i].priority = prio_max - 1 - shorter;
+        if (tasks[i].priority < 1) tasks[i].priority = 1;
+    }
+}
+
+// Classic response-time analysis for fixed priorities on one CPU:
+// R = C_i + sum over higher-or-equal priority tasks j of ceil(R / T_j) * C_j.
+// Only meaningful for pinned tasks; interference comes from tasks on the same CPU.
+static void response_time_analysis(void) {
+    for (int i = 0; i < num_tasks; i++) {
+        task_t *t = &tasks[i];
+        t->rta_ns = -1;
+        if (t->cpu < 0) continue;
+        long long r = t->wcet_ns, prev = 0;
+        while (r != prev && r <= t->deadline_ns * 16) {
+            prev = r;
+            r = t->wcet_ns;
+            for (int j = 0; j < num_tasks; j++) {
+                task_t *o = &tasks[j];
+                if (j == i || o->cpu != t->cpu || o->priority < t->priority) continue;
+                r += ((prev + o->period_ns - 1) / o->period_ns) * o->wcet_ns;
+            }
+        }
+        if (r == prev)
+            t->rta_ns = r;
+    }
+}
+
+static void* task_function(void *arg) {
+    task_t *t = (task_t *)arg;
+    if (t->cpu >= 0 && pin_self(t->cpu) != 0)
+        fprintf(stderr, "warning: could not pin %s to CPU %d\n", t->name, t->cpu);
+    pthread_barrier_wait(&start_barrier);
+
+    long long cpu_start = thread_cpu_ns();
+    // Jobs are released on a fixed grid; an overrunning job delays the
+    // next one but never drops it, so backlog shows up as response time.
+    for (long k = 0; k < t->max_jobs; k++) {
+        long long release = start_ns + k * t->period_ns;
+        if (release >= end_ns) break;
+        if (now_ns() < release) {
+            struct timespec ts = { .tv_sec = release / NSEC_PER_SEC, .tv_nsec = release % NSEC_PER_SEC };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+                ;
+        }
+        burn_cpu(t->wcet_ns);
+        long long response = now_ns() - release;
+        t->response_ns[t->jobs++] = response;
+        if (response > t->deadline_ns)
+            t->misses++;
+    }
+    t->cpu_ns = thread_cpu_ns() - cpu_start;
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int parse_policy(const char *str) {
+    if (strcmp(str, "fifo") == 0)
+        return SCHED_FIFO;
+    if (strcmp(str, "rr") == 0)
+        return SCHED_RR;
+    fprintf(stderr, "Unknown or unsupported policy: %s\n", str);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <task_set_file> [duration_s=%d] [fifo|rr]\n",
+                argv[0], DEFAULT_DURATION);
+        fprintf(stderr, "  task line: name period_us wcet_us priority(0=rate-monotonic) cpu(-1=any) [deadline_us]\n");
+        exit(EXIT_FAILURE);
+    }
+    int duration = argc > 2 ? atoi(argv[2]) : DEFAULT_DURATION;
+    if (duration <= 0) duration = DEFAULT_DURATION;
+    int policy = argc > 3 ? parse_policy(argv[3]) : SCHED_FIFO;
+
+    load_task_set(argv[1]);
+    int prio_max = sched_get_priority_max(policy);
+    assign_rate_monotonic(prio_max);
+    response_time_analysis();
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall (continuing)");
+
+    // The main thread must outrank every task so it can start and stop them
+    struct sched_param main_sp = { .sched_priority = prio_max };
+    int rt = pthread_setschedparam(pthread_self(), policy, &main_sp) == 0;
+    if (!rt)
+        fprintf(stderr, "warning: RT scheduling unavailable, tasks run under the default policy\n");
+
+    pthread_barrier_init(&start_barrier, NULL, num_tasks + 1);
+    for (int i = 0; i < num_tasks; i++) {
+        task_t *t = &tasks[i];
+        t->max_jobs = (long)(duration * NSEC_PER_SEC / t->period_ns) + 2;
+        t->response_ns = malloc(t->max_jobs * sizeof(long long));
+        if (!t->response_ns) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (rt) {
+            struct sched_param sp = { .sched_priority = t->priority };
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, policy);
+            pthread_attr_setschedparam(&attr, &sp);
+        }
+        int ret = pthread_create(&t->tid, &attr, task_function, t);
+        pthread_attr_destroy(&attr);
+        if (ret != 0) {
+            fprintf(stderr, "pthread_create %s failed: %s\n", t->name, strerror(ret));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Synchronous release of every task: the critical instant of RM analysis
+    start_ns = now_ns() + START_DELAY_NS;
+    end_ns = start_ns + duration * NSEC_PER_SEC;
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < num_tasks; i++)
+        pthread_join(tasks[i].tid, NULL);
+    long long elapsed = now_ns() - start_ns;
+
+    printf("Task set %s: %d tasks, %d s, %s%s\n", argv[1], num_tasks, duration,
+           policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR", rt ? "" : " (not applied)");
+    printf("%-12s %9s %9s %9s %4s %4s %7s %6s %7s %9s %9s %9s %9s %9s %7s %7s\n",
+           "task", "T_us", "C_us", "D_us", "prio", "cpu", "jobs", "miss", "miss%",
+           "R_min", "R_p50", "R_p99", "R_max", "R_rta", "U_nom", "U_meas");
+
+    double u_total = 0;
+    long total_misses = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        task_t *t = &tasks[i];
+        long n = t->jobs;
+        double u_nom = (double)t->wcet_ns / t->period_ns;
+        u_total += u_nom;
+        total_misses += t->misses;
+        char cpu_str[8], rta_str[16];
+        snprintf(cpu_str, sizeof(cpu_str), t->cpu < 0 ? "any" : "%d", t->cpu);
+        if (t->rta_ns >= 0)
+            snprintf(rta_str, sizeof(rta_str), "%.1f", t->rta_ns / 1e3);
+        else
+            snprintf(rta_str, sizeof(rta_str), "%s", t->cpu < 0 ? "n/a" : "unbound");
+        if (n == 0) {
+            printf("%-12s no jobs completed\n", t->name);
+            continue;
+        }
+        qsort(t->response_ns, n, sizeof(long long), cmp_ll);
+        printf("%-12s %9.1f %9.1f %9.1f %4d %4s %7ld %6ld %6.2f%% %9.1f %9.1f %9.1f %9.1f %9s %7.3f %7.3f\n",
+               t->name, t->period_ns / 1e3, t->wcet_ns / 1e3, t->deadline_ns / 1e3,
+               t->priority, cpu_str, n, t->misses, 100.0 * t->misses / n,
+               t->response_ns[0] / 1e3, t->response_ns[n / 2] / 1e3,
+               t->response_ns[(long)(n * 0.99)] / 1e3, t->response_ns[n - 1] / 1e3,
+               rta_str, u_nom, (double)t->cpu_ns / elapsed);
+    }
+
+    // Liu & Layland sufficient bound for n tasks sharing one CPU
+    int ncpus_used = 0;
+    int seen[MAX_TASKS];
+    for (int i = 0; i < num_tasks; i++) {
+        int dup = 0;
+        for (int j = 0; j < ncpus_used; j++)
+            if (seen[j] == tasks[i].cpu) dup = 1;
+        if (!dup) seen[ncpus_used++] = tasks[i].cpu;
+    }
+    printf("\nTotal utilization %.3f, %ld deadline misses\n", u_total, total_misses);
+    for (int c = 0; c < ncpus_used; c++) {
+        if (seen[c] < 0) continue;
+        double u = 0;
+        int n = 0;
+        for (int i = 0; i < num_tasks; i++) {
+            if (tasks[i].cpu != seen[c]) continue;
+            u += (double)tasks[i].wcet_ns / tasks[i].period_ns;
+            n++;
+        }
+        double bound = n * (pow(2.0, 1.0 / n) - 1.0);
+        printf("CPU %d: %d tasks, U=%.3f, Liu&Layland bound %.3f (%s)\n", seen[c], n, u, bound,
+               u <= bound ? "schedulable by bound" : u <= 1.0 ? "needs exact RTA" : "overloaded");
+    }
+
+    for (int i = 0; i < num_tasks; i++)
+        free(tasks[i].response_ns);
+    pthread_barrier_destroy(&start_barrier);
+    return total_misses ? 1 : 0;
+}
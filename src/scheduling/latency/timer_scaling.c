@@ -0,0 +1,387 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#else
+  #include <sys/timerfd.h>
+  #include <sys/epoll.h>
+#endif
+
+#define NSEC_PER_SEC        1000000000LL
+#define DEFAULT_COUNTS      "1,10,100,1000,10000,100000"
+#define DEFAULT_DURATION_MS 2000
+#define DEFAULT_PERIOD_MS   10
+#define MAX_EXPIRY_RATE     200000LL     // cap on aggregate expirations/s; period stretches above it
+#define MAX_SAMPLES         (1 << 21)    // latency samples kept per run
+#define EPOLL_BATCH         1024
+#define TIMER_PULSE_CODE    (_PULSE_CODE_MINAVAIL + 1)
+
+enum timer_kind { KIND_TIMERFD, KIND_POSIX, NUM_KINDS };
+enum pattern { PAT_ALIGNED, PAT_RANDOM, NUM_PATTERNS };
+
+static const char *kind_names[NUM_KINDS] = { "timerfd", "posix" };
+static const char *pattern_names[NUM_PATTERNS] = { "aligned", "random" };
+
+typedef struct {
+    int n;
+    int created;              // timers successfully created so far
+    long long period_ns;
+    long long *next_expiry;   // absolute expected expiry of each timer
+    long long *samples;
+    long num_samples;
+    unsigned long long expirations;
+    unsigned long long overruns;
+#ifdef __QNX__
+    int chid, coid;
+#else
+    int epfd;
+    int *fds;
+#endif
+    timer_t *timers;
+} timer_set_t;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static inline struct timespec ns_ts(long long ns) {
+    struct timespec t = { .tv_sec = ns / NSEC_PER_SEC, .tv_nsec = ns % NSEC_PER_SEC };
+    return t;
+}
+
+static inline long long rusage_cpu_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NSEC_PER_SEC +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+static void record(timer_set_t *ts, int idx, unsigned long long count, long long now) {
+    // `count` expirations were folded into one notification; latency is
+    // measured against the most recent one and the rest count as overruns
+    long long expected = ts->next_expiry[idx] + (long long)(count - 1) * ts->period_ns;
+    ts->next_expiry[idx] = expected + ts->period_ns;
+    ts->expirations += count;
+    ts->overruns += count - 1;
+    if (ts->num_samples < MAX_SAMPLES)
+        ts->samples[ts->num_samples++] = now - expected;
+}
+
+static int create_timers(timer_set_t *ts, enum timer_kind kind) {
+#ifdef __QNX__
+    (void)kind;
+    ts->chid = ChannelCreate(0);
+    ts->coid = ConnectAttach(0, 0, ts->chid, _NTO_SIDE_CHANNEL, 0);
+    if (ts->chid == -1 || ts->coid == -1) return -1;
+    for (int i = 0; i < ts->n; i++) {
+        struct sigevent ev;
+        SIGEV_PULSE_INIT(&ev, ts->coid, SIGEV_PULSE_PRIO_INHERIT, TIMER_PULSE_CODE, i);
+        if (timer_create(CLOCK_MONOTONIC, &ev, &ts->timers[i]) != 0) return -1;
+        ts->created++;
+    }
+#else
+    if (kind == KIND_TIMERFD) {
+        ts->epfd = epoll_create1(0);
+        if (ts->epfd < 0) return -1;
+        for (int i = 0; i < ts->n; i++) {
+            ts->fds[i] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+            if (ts->fds[i] < 0) return -1;
+            ts->created++;
+            struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+            if (epoll_ctl(ts->epfd, EPOLL_CTL_ADD, ts->fds[i], &ev) != 0) return -1;
+        }
+    } else {
+        for (int i = 0; i < ts->n; i++) {
+            struct sigevent ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.sigev_notify = SIGEV_SIGNAL;
+            ev.sigev_signo = SIGRTMIN;
+            ev.sigev_value.sival_int = i;
+            if (timer_create(CLOCK_MONOTONIC, &ev, &ts->timers[i]) != 0) return -1;
+            ts->created++;
+        }
+    }
+#endif
+    return 0;
+}
+
+static int arm_timer(timer_set_t *ts, enum timer_kind kind, int i, long long first, long long period) {
+    struct itimerspec its = { .it_value = ns_ts(first), .it_interval = ns_ts(period) };
+#ifndef __QNX__
+    if (kind == KIND_TIMERFD)
+        return timerfd_settime(ts->fds[i], TFD_TIMER_ABSTIME, &its, NULL);
+#else
+    (void)kind;
+#endif
+    return timer_settime(ts->timers[i], TIMER_ABSTIME, &its, NULL);
+}
+
+static int disarm_timer(timer_set_t *ts, enum timer_kind kind, int i) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+#ifndef __QNX__
+    if (kind == KIND_TIMERFD)
+        return timerfd_settime(ts->fds[i], 0, &its, NULL);
+#else
+    (void)kind;
+#endif
+    return timer_settime(ts->timers[i], 0, &its, NULL);
+}
+
+static void destroy_timers(timer_set_t *ts, enum timer_kind kind) {
+#ifdef __QNX__
+    (void)kind;
+    for (int i = 0; i < ts->created; i++)
+        timer_delete(ts->timers[i]);
+    ConnectDetach(ts->coid);
+    ChannelDestroy(ts->chid);
+#else
+    if (kind == KIND_TIMERFD) {
+        for (int i = 0; i < ts->created; i++)
+            close(ts->fds[i]);
+        if (ts->epfd >= 0)
+            close(ts->epfd);
+    } else {
+        for (int i = 0; i < ts->created; i++)
+            timer_delete(ts->timers[i]);
+        // Drop any expiry signals still queued from before the disarm
+        struct timespec zero = { 0, 0 };
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGRTMIN);
+        while (sigtimedwait(&set, NULL, &zero) > 0)
+            ;
+    }
+#endif
+}
+
+// Waits up to `timeout_ns` for expirations and records all that arrived
+static void service_timers(timer_set_t *ts, enum timer_kind kind, long long timeout_ns) {
+#ifdef __QNX__
+    (void)kind;
+    struct _pulse pulse;
+    uint64_t timeout = (uint64_t)timeout_ns;
+    TimerTimeout(CLOCK_MONOTONIC, _NTO_TIMEOUT_RECEIVE, NULL, &timeout, NULL);
+    if (MsgReceivePulse(ts->chid, &pulse, sizeof(pulse), NULL) == 0 &&
+        pulse.code == TIMER_PULSE_CODE) {
+        record(ts, pulse.value.sival_int, 1, now_ns());
+    }
+#else
+    if (kind == KIND_TIMERFD) {
+        struct epoll_event events[EPOLL_BATCH];
+        int n = epoll_wait(ts->epfd, events, EPOLL_BATCH, (int)(timeout_ns / 1000000) + 1);
+        long long now = now_ns();
+        for (int e = 0; e < n; e++) {
+            int idx = (int)events[e].data.u32;
+            uint64_t count;
+            if (read(ts->fds[idx], &count, sizeof(count)) == sizeof(count))
+                record(ts, idx, count, now);
+        }
+    } else {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGRTMIN);
+        siginfo_t info;
+        struct timespec to = ns_ts(timeout_ns);
+        if (sigtimedwait(&set, &info, &to) == SIGRTMIN) {
+            long long now = now_ns();
+            record(ts, info.si_value.sival_int, 1ULL + (unsigned)info.si_overrun, now);
+        }
+    }
+#endif
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_case(enum timer_kind kind, enum pattern pat, int n, long long period_ns,
+                     long long duration_ns, long long *samples) {
+    timer_set_t ts;
+    memset(&ts, 0, sizeof(ts));
+    ts.n = n;
+    // Stretch the period so the aggregate rate stays serviceable at large N
+    ts.period_ns = period_ns;
+    if ((long long)n * NSEC_PER_SEC / ts.period_ns > MAX_EXPIRY_RATE)
+        ts.period_ns = (long long)n * NSEC_PER_SEC / MAX_EXPIRY_RATE;
+    ts.samples = samples;
+    ts.next_expiry = malloc(n * sizeof(long long));
+    ts.timers = malloc(n * sizeof(timer_t));
+#ifndef __QNX__
+    ts.fds = malloc(n * sizeof(int));
+    ts.epfd = -1;
+    if (!ts.fds) ts.timers = NULL;
+#endif
+    if (!ts.next_expiry || !ts.timers) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    long long t0 = now_ns();
+    if (create_timers(&ts, kind) != 0) {
+        printf("%-8s %-8s %7d create failed after %d timers: %s\n",
+               kind_names[kind], pattern_names[pat], n, ts.created, strerror(errno));
+        destroy_timers(&ts, kind);
+        goto out;
+    }
+    long long create_ns = now_ns() - t0;
+
+    // Aligned: every timer fires at the same instants. Random: phases spread over one period.
+    long long base = now_ns() + 20000000LL + (long long)n * 2000;   // leave time to arm them all
+    for (int i = 0; i < n; i++) {
+        long long phase = pat == PAT_RANDOM ? (long long)((double)rand() / RAND_MAX * (ts.period_ns - 1)) : 0;
+        ts.next_expiry[i] = base + phase;
+    }
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        if (arm_timer(&ts, kind, i, ts.next_expiry[i], ts.period_ns) != 0) {
+            perror("arm timer");
+            exit(EXIT_FAILURE);
+        }
+    }
+    long long arm_ns = now_ns() - t0;
+
+    long long run_start = now_ns();
+    long long cpu_start = rusage_cpu_ns();
+    while (now_ns() - run_start < duration_ns)
+        service_timers(&ts, kind, 10000000LL);
+    long long wall = now_ns() - run_start;
+    long long cpu = rusage_cpu_ns() - cpu_start;
+
+    t0 = now_ns();
+    for (int i = 0; i < n; i++)
+        disarm_timer(&ts, kind, i);
+    long long cancel_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    destroy_timers(&ts, kind);
+    long long delete_ns = now_ns() - t0;
+
+    long ns = ts.num_samples;
+    if (ns > 0) qsort(samples, ns, sizeof(long long), cmp_ll);
+    printf("%-8s %-8s %7d %7.1f %8.0f %8.0f %8.0f %8.0f %10llu %9.0f %8.1f %8.1f %9.1f %9.1f %8llu %6.1f\n",
+           kind_names[kind], pattern_names[pat], n, ts.period_ns / 1e6,
+           (double)create_ns / n, (double)arm_ns / n, (double)cancel_ns / n, (double)delete_ns / n,
+           ts.expirations, ts.expirations * 1e9 / wall,
+           ns ? samples[ns / 2] / 1e3 : 0.0, ns ? samples[(long)(ns * 0.99)] / 1e3 : 0.0,
+           ns ? samples[(long)(ns * 0.999)] / 1e3 : 0.0, ns ? samples[ns - 1] / 1e3 : 0.0,
+           ts.overruns, 100.0 * cpu / wall);
+    fflush(stdout);
+
+out:
+    free(ts.next_expiry);
+    free(ts.timers);
+#ifndef __QNX__
+    free(ts.fds);
+#endif
+}
+
+static int parse_choice(const char *arg, const char **names, int count, const char *what) {
+    if (strcmp(arg, "all") == 0) return -1;
+    for (int i = 0; i < count; i++)
+        if (strcmp(arg, names[i]) == 0) return i;
+    fprintf(stderr, "Unknown %s: %s\n", what, arg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [timerfd|posix|all] [counts=%s] [aligned|random|all] "
+                "[duration_ms=%d] [period_ms=%d]\n",
+                argv[0], DEFAULT_COUNTS, DEFAULT_DURATION_MS, DEFAULT_PERIOD_MS);
+        return EXIT_FAILURE;
+    }
+    int only_kind = argc > 1 ? parse_choice(argv[1], kind_names, NUM_KINDS, "timer kind") : -1;
+    const char *counts = argc > 2 ? argv[2] : DEFAULT_COUNTS;
+    int only_pat = argc > 3 ? parse_choice(argv[3], pattern_names, NUM_PATTERNS, "pattern") : -1;
+    long long duration_ns = DEFAULT_DURATION_MS * 1000000LL;
+    long long period_ns = DEFAULT_PERIOD_MS * 1000000LL;
+    if (argc > 4 && atol(argv[4]) > 0) duration_ns = atol(argv[4]) * 1000000LL;
+    if (argc > 5 && atol(argv[5]) > 0) period_ns = atol(argv[5]) * 1000000LL;
+
+    int max_n = 0;
+    for (const char *p = counts; *p; ) {
+        int n = atoi(p);
+        if (n > max_n) max_n = n;
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+
+    // Each timerfd is a file descriptor; raise the limit to fit the largest N
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t)max_n + 64) {
+        rl.rlim_cur = (rlim_t)max_n + 64;
+        if (rl.rlim_max < rl.rlim_cur) rl.rlim_max = rl.rlim_cur;
+        if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+            perror("setrlimit(RLIMIT_NOFILE)");
+    }
+#ifdef RLIMIT_SIGPENDING
+    // Linux charges every POSIX timer's preallocated signal against RLIMIT_SIGPENDING
+    if (getrlimit(RLIMIT_SIGPENDING, &rl) == 0 && rl.rlim_cur < (rlim_t)max_n + 64) {
+        rl.rlim_cur = (rlim_t)max_n + 64;
+        if (rl.rlim_max < rl.rlim_cur) rl.rlim_max = rl.rlim_cur;
+        if (setrlimit(RLIMIT_SIGPENDING, &rl) != 0)
+            perror("setrlimit(RLIMIT_SIGPENDING)");
+    }
+#endif
+
+#ifndef __QNX__
+    // POSIX timer expirations are collected synchronously with sigtimedwait
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGRTMIN);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+#endif
+
+    long long *samples = malloc(MAX_SAMPLES * sizeof(long long));
+    if (!samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    srand(12345);
+
+    printf("Timer scaling: %lld ms per run, requested period %lld ms (stretched to keep <= %lld expirations/s)\n",
+           duration_ns / 1000000, period_ns / 1000000, MAX_EXPIRY_RATE);
+    printf("create/arm/cancel/delete are ns per timer; latencies in us; cpu%% is this process's user+sys time\n");
+    printf("%-8s %-8s %7s %7s %8s %8s %8s %8s %10s %9s %8s %8s %9s %9s %8s %6s\n",
+           "kind", "pattern", "timers", "per_ms", "create", "arm", "cancel", "delete",
+           "expiries", "exp/s", "p50", "p99", "p99.9", "max", "overrun", "cpu%");
+
+    for (int k = 0; k < NUM_KINDS; k++) {
+        if (only_kind >= 0 && k != only_kind) continue;
+#ifdef __QNX__
+        if (k == KIND_TIMERFD) {
+            printf("%-8s not available on QNX; use posix (pulse-delivered timers)\n", kind_names[k]);
+            continue;
+        }
+#endif
+        for (int pt = 0; pt < NUM_PATTERNS; pt++) {
+            if (only_pat >= 0 && pt != only_pat) continue;
+            for (const char *p = counts; *p; ) {
+                int n = atoi(p);
+                if (n > 0)
+                    run_case(k, pt, n, period_ns, duration_ns, samples);
+                p = strchr(p, ',');
+                if (!p) break;
+                p++;
+            }
+        }
+    }
+
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define HOLD_NS      (5LL  * 1000000LL)   /* CPU time the low thread needs inside the lock */
+#define MID_HOLD_NS  (1LL  * 1000000LL)   /* CPU time the chain's middle thread needs */
+#define HOG_NS       (20LL * 1000000LL)   /* CPU time of the medium-priority hog */
+#define DEFAULT_REPS 50
+
+enum scenario { SC_CLASSIC, SC_CHAIN, SC_NESTED, NUM_SCENARIOS };
+
+static const char *scenario_names[NUM_SCENARIOS] = { "classic", "chain", "nested" };
+static const char *scenario_desc[NUM_SCENARIOS] = {
+    "H waits on M1 held by L; hog preempts L",
+    "H waits on M1 held by B; B waits on M2 held by L",
+    "L holds M1+M2, drops M1 first; H waits on M2"
+};
+
+static const int protocols[] = { PTHREAD_PRIO_NONE, PTHREAD_PRIO_INHERIT, PTHREAD_PRIO_PROTECT };
+static const char *protocol_names[] = { "NONE", "INHERIT", "PROTECT" };
+#define NUM_PROTOCOLS 3
+
+// State for one repetition of one scenario
+typedef struct {
+    enum scenario scenario;
+    pthread_mutex_t m1, m2;
+    sem_t go_low, go_mid, go_high, go_hog;
+    sem_t ready;
+    volatile uint64_t release_ns;   // when H was made runnable
+    uint64_t high_wait_ns;
+} run_ctx_t;
+
+static int sched_policy = SCHED_FIFO;
+static int prio_main, prio_high, prio_hog, prio_mid, prio_low;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Spins until this thread has consumed `ns` of CPU, so being preempted
+// extends the hold time the way real work would.
+static void burn_cpu(uint64_t ns) {
+    uint64_t t0 = thread_cpu_ns();
+    while (thread_cpu_ns() - t0 < ns) {}
+}
+
+// Inversion only shows up when everything competes for one CPU
+static void pin_to_cpu0(void) {
+#ifdef __QNX__
+    ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)1);
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+}
+
+void* low_task(void *arg) {
+    run_ctx_t *c = arg;
+    pin_to_cpu0();
+    sem_wait(&c->go_low);
+
+    switch (c->scenario) {
+    case SC_CLASSIC:
+        pthread_mutex_lock(&c->m1);
+        sem_post(&c->ready);
+        burn_cpu(HOLD_NS);
+        pthread_mutex_unlock(&c->m1);
+        break;
+    case SC_CHAIN:
+        pthread_mutex_lock(&c->m2);
+        sem_post(&c->ready);
+        burn_cpu(HOLD_NS);
+        pthread_mutex_unlock(&c->m2);
+        break;
+    case SC_NESTED:
+        // Releasing M1 must not drop the boost inherited through M2
+        pthread_mutex_lock(&c->m1);
+        pthread_mutex_lock(&c->m2);
+        sem_post(&c->ready);
+        burn_cpu(HOLD_NS / 2);
+        pthread_mutex_unlock(&c->m1);
+        burn_cpu(HOLD_NS / 2);
+        pthread_mutex_unlock(&c->m2);
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+// Middle link of the chain: owns M1 and blocks on M2
+void* mid_task(void *arg) {
+    run_ctx_t *c = arg;
+    pin_to_cpu0();
+    sem_wait(&c->go_mid);
+
+    pthread_mutex_lock(&c->m1);
+    sem_post(&c->ready);
+    pthread_mutex_lock(&c->m2);
+    burn_cpu(MID_HOLD_NS);
+    pthread_mutex_unlock(&c->m2);
+    pthread_mutex_unlock(&c->m1);
+    return NULL;
+}
+
+void* high_task(void *arg) {
+    run_ctx_t *c = arg;
+    pthread_mutex_t *m = c->scenario == SC_NESTED ? &c->m2 : &c->m1;
+    pin_to_cpu0();
+    sem_wait(&c->go_high);
+
+    // Measured from release, not from the lock call: under PRIO_PROTECT the
+    // ceiling delays H's start instead of blocking it inside pthread_mutex_lock
+    pthread_mutex_lock(m);
+    uint64_t t1 = now_ns();
+    pthread_mutex_unlock(m);
+
+    c->high_wait_ns = t1 - c->release_ns;
+    return NULL;
+}
+
+void* hog_task(void *arg) {
+    run_ctx_t *c = arg;
+    pin_to_cpu0();
+    sem_wait(&c->go_hog);
+    burn_cpu(HOG_NS);
+    return NULL;
+}
+
+int parse_sched_policy(const char *arg) {
+    if (strcmp(arg, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(arg, "rr") == 0) return SCHED_RR;
+    fprintf(stderr, "Unknown policy: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+static int init_mutex(pthread_mutex_t *m, int protocol) {
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    int rc = pthread_mutexattr_setprotocol(&ma, protocol);
+    if (rc == 0 && protocol == PTHREAD_PRIO_PROTECT)
+        rc = pthread_mutexattr_setprioceiling(&ma, prio_high);
+    if (rc == 0)
+        rc = pthread_mutex_init(m, &ma);
+    pthread_mutexattr_destroy(&ma);
+    return rc;
+}
+
+static int create_rt_thread(pthread_t *t, int prio, void *(*fn)(void *), void *arg) {
+    pthread_attr_t attr;
+    struct sched_param sp = { .sched_priority = prio };
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, sched_policy);
+    pthread_attr_setschedparam(&attr, &sp);
+    int rc = pthread_create(t, &attr, fn, arg);
+    pthread_attr_destroy(&attr);
+    return rc;
+}
+
+// Runs one repetition; returns 0 and fills *wait_ns on success
+static int run_once(enum scenario sc, int protocol, uint64_t *wait_ns) {
+    run_ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.scenario = sc;
+
+    int rc = init_mutex(&c.m1, protocol);
+    if (rc == 0) rc = init_mutex(&c.m2, protocol);
+    if (rc != 0) return rc;
+    sem_init(&c.go_low, 0, 0);
+    sem_init(&c.go_mid, 0, 0);
+    sem_init(&c.go_high, 0, 0);
+    sem_init(&c.go_hog, 0, 0);
+    sem_init(&c.ready, 0, 0);
+
+    pthread_t low, mid, high, hog;
+    int have_mid = sc == SC_CHAIN;
+    if ((rc = create_rt_thread(&low, prio_low, low_task, &c)) != 0 ||
+        (have_mid && (rc = create_rt_thread(&mid, prio_mid, mid_task, &c)) != 0) ||
+        (rc = create_rt_thread(&hog, prio_hog, hog_task, &c)) != 0 ||
+        (rc = create_rt_thread(&high, prio_high, high_task, &c)) != 0) {
+        fprintf(stderr, "pthread_create: %s (run as root for RT priorities)\n", strerror(rc));
+        exit(EXIT_FAILURE);
+    }
+
+    // main outranks every worker, so each post runs the worker only once main blocks.
+    // Under PRIO_PROTECT L runs at the ceiling and finishes before B can start, so
+    // the chain never forms; that is the protocol working, not a setup error.
+    sem_post(&c.go_low);
+    sem_wait(&c.ready);
+    if (have_mid) {
+        sem_post(&c.go_mid);
+        sem_wait(&c.ready);
+    }
+    c.release_ns = now_ns();
+    sem_post(&c.go_high);
+    sem_post(&c.go_hog);
+
+    pthread_join(high, NULL);
+    pthread_join(hog, NULL);
+    if (have_mid) pthread_join(mid, NULL);
+    pthread_join(low, NULL);
+
+    pthread_mutex_destroy(&c.m1);
+    pthread_mutex_destroy(&c.m2);
+    sem_destroy(&c.go_low);
+    sem_destroy(&c.go_mid);
+    sem_destroy(&c.go_high);
+    sem_destroy(&c.go_hog);
+    sem_destroy(&c.ready);
+
+    *wait_ns = c.high_wait_ns;
+    return 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int parse_index(const char *arg, const char **names, int count, const char *what) {
+    if (strcmp(arg, "all") == 0) return -1;
+    for (int i = 0; i < count; i++)
+        if (strcasecmp(arg, names[i]) == 0) return i;
+    fprintf(stderr, "Unknown %s: %s\n", what, arg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s [fifo|rr] [repetitions=%d] [classic|chain|nested|all] [none|inherit|protect|all]\n",
+                argv[0], DEFAULT_REPS);
+        return EXIT_FAILURE;
+    }
+
+    sched_policy = parse_sched_policy(argv[1]);
+    int reps = DEFAULT_REPS;
+    int only_sc = -1, only_proto = -1;
+    if (argc > 2) {
+        reps = atoi(argv[2]);
+        if (reps <= 0) reps = DEFAULT_REPS;
+    }
+    if (argc > 3) only_sc = parse_index(argv[3], scenario_names, NUM_SCENARIOS, "scenario");
+    if (argc > 4) only_proto = parse_index(argv[4], protocol_names, NUM_PROTOCOLS, "protocol");
+
+    prio_main = sched_get_priority_max(sched_policy);
+    prio_high = prio_main - 1;
+    prio_hog  = prio_main - 2;
+    prio_mid  = prio_main - 3;
+    prio_low  = prio_main - 4;
+
+    pin_to_cpu0();
+    struct sched_param sp = { .sched_priority = prio_main };
+    if (pthread_setschedparam(pthread_self(), sched_policy, &sp) != 0)
+        perror("setschedparam(main)");
+
+    uint64_t *samples = malloc(reps * sizeof(uint64_t));
+    if (!samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("Priority inversion matrix (%s, %d repetitions, CPU 0)\n",
+           sched_policy == SCHED_FIFO ? "FIFO" : "RR", reps);
+    printf("L/B hold %lld ms / %lld ms of CPU, hog burns %lld ms; times are H's release-to-lock time in us\n",
+           HOLD_NS / 1000000, MID_HOLD_NS / 1000000, HOG_NS / 1000000);
+    for (int s = 0; s < NUM_SCENARIOS; s++)
+        if (only_sc < 0 || only_sc == s)
+            printf("  %-8s %s\n", scenario_names[s], scenario_desc[s]);
+    printf("\n%-8s %-8s %9s %9s %9s %9s %9s %9s\n",
+           "scenario", "protocol", "min", "p50", "p90", "p99", "max", "avg");
+
+    for (int s = 0; s < NUM_SCENARIOS; s++) {
+        if (only_sc >= 0 && s != only_sc) continue;
+        for (int p = 0; p < NUM_PROTOCOLS; p++) {
+            if (only_proto >= 0 && p != only_proto) continue;
+
+            int n = 0, rc = 0;
+            for (int r = 0; r < reps; r++) {
+                if ((rc = run_once(s, protocols[p], &samples[n])) != 0) break;
+                n++;
+            }
+            if (n == 0) {
+                printf("%-8s %-8s unsupported: %s\n", scenario_names[s], protocol_names[p], strerror(rc));
+                continue;
+            }
+
+            qsort(samples, n, sizeof(uint64_t), cmp_u64);
+            uint64_t sum = 0;
+            for (int i = 0; i < n; i++) sum += samples[i];
+            printf("%-8s %-8s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                   scenario_names[s], protocol_names[p],
+                   samples[0] / 1e3, samples[n / 2] / 1e3, samples[(int)(n * 0.9)] / 1e3,
+                   samples[(int)(n * 0.99)] / 1e3, samples[n - 1] / 1e3, (double)sum / n / 1e3);
+            fflush(stdout);
+        }
+    }
+
+    free(samples);
+    return 0;
+}
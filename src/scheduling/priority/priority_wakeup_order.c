@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define DEFAULT_WAITERS  8
+#define DEFAULT_ROUNDS   200
+#define MAX_WAITERS      64
+#define ENQUEUE_GAP_NS   200000L   // controller sleeps so the released waiter can block
+
+enum primitive { PRIM_MUTEX, PRIM_MUTEX_PI, PRIM_SEM, PRIM_CONDVAR, NUM_PRIMS };
+enum arrival { ARRIVE_ASCENDING, ARRIVE_RANDOM, NUM_ARRIVALS };
+
+static const char *prim_names[NUM_PRIMS] = { "mutex", "mutex_pi", "sem", "condvar" };
+static const char *arrival_names[NUM_ARRIVALS] = { "ascending", "random" };
+
+int sched_policy = SCHED_FIFO;
+
+static enum primitive prim;
+static int num_waiters;
+static int waiter_prio[MAX_WAITERS];
+static sem_t go[MAX_WAITERS];
+static sem_t finished;
+static volatile int quit;
+
+static pthread_mutex_t mutex;
+static sem_t sem;
+static pthread_mutex_t cv_mutex;
+static pthread_cond_t cv;
+static int tokens;
+
+// Per round: who got the resource in which order, and when
+static int acquired_by[MAX_WAITERS];
+static long long acquired_ns[MAX_WAITERS];
+static long long released_ns[MAX_WAITERS + 1];   // [0] is the controller's release
+static int acquisitions;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int parse_sched_policy(const char *arg) {
+    if (strcmp(arg, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(arg, "rr") == 0) return SCHED_RR;
+    fprintf(stderr, "Unknown policy: %s\n", arg);
+    exit(EXIT_FAILURE);
+}
+
+// Everyone shares CPU0, so the only thing deciding who runs next is the
+// primitive's own wakeup choice
+static void pin_to_cpu0(void) {
+#ifdef __QNX__
+    ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)1);
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static void acquire(void) {
+    switch (prim) {
+    case PRIM_MUTEX:
+    case PRIM_MUTEX_PI:
+        pthread_mutex_lock(&mutex);
+        break;
+    case PRIM_SEM:
+        while (sem_wait(&sem) != 0 && errno == EINTR)
+            ;
+        break;
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&cv_mutex);
+        while (tokens == 0)
+            pthread_cond_wait(&cv, &cv_mutex);
+        tokens--;
+        pthread_mutex_unlock(&cv_mutex);
+        break;
+    default:
+        break;
+    }
+}
+
+// Hands the resource to the next waiter; released_ns[slot] is stamped
+// immediately before the handoff
+static void release(int slot) {
+    switch (prim) {
+    case PRIM_MUTEX:
+    case PRIM_MUTEX_PI:
+        released_ns[slot] = now_ns();
+        pthread_mutex_unlock(&mutex);
+        break;
+    case PRIM_SEM:
+        released_ns[slot] = now_ns();
+        sem_post(&sem);
+        break;
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&cv_mutex);
+        tokens++;
+        released_ns[slot] = now_ns();
+        pthread_cond_signal(&cv);
+        pthread_mutex_unlock(&cv_mutex);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* waiter_func(void *arg) {
+    int id = (int)(intptr_t)arg;
+    pin_to_cpu0();
+    for (;;) {
+        while (sem_wait(&go[id]) != 0 && errno == EINTR)
+            ;
+        if (quit) break;
+        acquire();
+        long long t = now_ns();
+        int slot = acquisitions++;
+        acquired_by[slot] = id;
+        acquired_ns[slot] = t;
+        release(slot + 1);
+        // Only the last handoff wakes the controller; posting after every one
+        // would put two extra switches on CPU0 inside each measured handoff
+        if (slot == num_waiters - 1)
+            sem_post(&finished);
+    }
+    return NULL;
+}
+
+static int init_primitive(enum primitive p) {
+    prim = p;
+    tokens = 0;
+    if (p == PRIM_MUTEX || p == PRIM_MUTEX_PI) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        int rc = 0;
+        if (p == PRIM_MUTEX_PI)
+            rc = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+        if (rc == 0)
+            rc = pthread_mutex_init(&mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        return rc;
+    }
+    if (p == PRIM_SEM)
+        return sem_init(&sem, 0, 0) == 0 ? 0 : errno;
+    pthread_mutex_init(&cv_mutex, NULL);
+    pthread_cond_init(&cv, NULL);
+    return 0;
+}
+
+static void destroy_primitive(void) {
+    if (prim == PRIM_MUTEX || prim == PRIM_MUTEX_PI) {
+        pthread_mutex_destroy(&mutex);
+    } else if (prim == PRIM_SEM) {
+        sem_destroy(&sem);
+    } else {
+        pthread_cond_destroy(&cv);
+        pthread_mutex_destroy(&cv_mutex);
+    }
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_case(enum primitive p, enum arrival arr, int rounds) {
+    int rc = init_primitive(p);
+    if (rc != 0) {
+        printf("%-9s %-9s unsupported: %s\n", prim_names[p], arrival_names[arr], strerror(rc));
+        return;
+    }
+
+    quit = 0;
+    sem_init(&finished, 0, 0);
+    pthread_t tids[MAX_WAITERS];
+    for (int i = 0; i < num_waiters; i++) {
+        sem_init(&go[i], 0, 0);
+        pthread_attr_t attr;
+        struct sched_param sp = { .sched_priority = waiter_prio[i] };
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, sched_policy);
+        pthread_attr_setschedparam(&attr, &sp);
+        if (pthread_create(&tids[i], &attr, waiter_func, (void *)(intptr_t)i) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+    long long *handoffs = malloc((size_t)rounds * num_waiters * sizeof(long long));
+    long long *first_wake = malloc(rounds * sizeof(long long));
+    if (!handoffs || !first_wake) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    long nhandoffs = 0, inversions = 0;
+    int bad_rounds = 0, wrong_first = 0;
+    unsigned int seed = 12345;
+    int order[MAX_WAITERS];
+
+    for (int r = 0; r < rounds; r++) {
+        // Controller holds the resource while the waiters queue up in the
+        // chosen arrival order; ascending puts the lowest priority first,
+        // the worst case for a FIFO wait queue
+        for (int i = 0; i < num_waiters; i++) order[i] = i;
+        if (arr == ARRIVE_RANDOM) {
+            for (int i = num_waiters - 1; i > 0; i--) {
+                int j = rand_r(&seed) % (i + 1);
+                int t = order[i]; order[i] = order[j]; order[j] = t;
+            }
+        }
+        if (p == PRIM_MUTEX || p == PRIM_MUTEX_PI)
+            pthread_mutex_lock(&mutex);
+        acquisitions = 0;
+        for (int i = 0; i < num_waiters; i++) {
+            sem_post(&go[order[i]]);
+            struct timespec gap = { 0, ENQUEUE_GAP_NS };
+            nanosleep(&gap, NULL);
+        }
+
+        release(0);
+        while (sem_wait(&finished) != 0 && errno == EINTR)
+            ;
+        // The last waiter's release leaves a token/lock behind; take it back
+        if (p == PRIM_SEM) sem_wait(&sem);
+        if (p == PRIM_CONDVAR) tokens = 0;
+
+        // Correct order is strictly descending priority, i.e. descending id
+        long round_inv = 0;
+        for (int i = 0; i < num_waiters; i++)
+            for (int j = i + 1; j < num_waiters; j++)
+                if (acquired_by[i] < acquired_by[j]) round_inv++;
+        inversions += round_inv;
+        if (round_inv) bad_rounds++;
+        if (acquired_by[0] != num_waiters - 1) wrong_first++;
+        first_wake[r] = acquired_ns[0] - released_ns[0];
+        for (int i = 0; i < num_waiters; i++)
+            handoffs[nhandoffs++] = acquired_ns[i] - released_ns[i];
+    }
+
+    quit = 1;
+    for (int i = 0; i < num_waiters; i++)
+        sem_post(&go[i]);
+    for (int i = 0; i < num_waiters; i++) {
+        pthread_join(tids[i], NULL);
+        sem_destroy(&go[i]);
+    }
+    sem_destroy(&finished);
+    destroy_primitive();
+
+    qsort(handoffs, nhandoffs, sizeof(long long), cmp_ll);
+    qsort(first_wake, rounds, sizeof(long long), cmp_ll);
+    printf("%-9s %-9s %6d %8d %10ld %9d %9.2f %9.2f %9.2f %9.2f\n",
+           prim_names[p], arrival_names[arr], rounds, bad_rounds, inversions, wrong_first,
+           first_wake[rounds / 2] / 1e3, handoffs[nhandoffs / 2] / 1e3,
+           handoffs[(long)(nhandoffs * 0.99)] / 1e3, handoffs[nhandoffs - 1] / 1e3);
+    fflush(stdout);
+    free(handoffs);
+    free(first_wake);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [fifo|rr] [waiters=%d] [rounds=%d] [mutex|mutex_pi|sem|condvar|all]\n",
+                argv[0], DEFAULT_WAITERS, DEFAULT_ROUNDS);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1) sched_policy = parse_sched_policy(argv[1]);
+    num_waiters = argc > 2 ? atoi(argv[2]) : DEFAULT_WAITERS;
+    if (num_waiters < 2 || num_waiters > MAX_WAITERS) num_waiters = DEFAULT_WAITERS;
+    int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+    if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+    int only = -1;
+    if (argc > 4 && strcmp(argv[4], "all") != 0) {
+        for (int i = 0; i < NUM_PRIMS; i++)
+            if (strcmp(argv[4], prim_names[i]) == 0) only = i;
+        if (only < 0) {
+            fprintf(stderr, "Unknown primitive: %s\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Controller above every waiter; waiter i gets the i-th lowest priority
+    int prio_max = sched_get_priority_max(sched_policy);
+    if (num_waiters > prio_max - sched_get_priority_min(sched_policy)) {
+        fprintf(stderr, "Not enough distinct priorities for %d waiters\n", num_waiters);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < num_waiters; i++)
+        waiter_prio[i] = prio_max - num_waiters + i;
+
+    pin_to_cpu0();
+    struct sched_param sp = { .sched_priority = prio_max };
+    int rc = pthread_setschedparam(pthread_self(), sched_policy, &sp);
+    if (rc != 0) {
+        printf("Priority wakeup order: skipped, RT scheduling unavailable (%s)\n", strerror(rc));
+        return 0;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall (continuing)");
+
+    printf("Priority-ordered wakeup: %d waiters at %s priorities %d..%d, %d rounds per case\n",
+           num_waiters, sched_policy == SCHED_FIFO ? "FIFO" : "RR",
+           waiter_prio[0], waiter_prio[num_waiters - 1], rounds);
+    printf("bad_rnds: rounds not in strict priority order; inversions: out-of-order pairs; latency in us\n");
+    printf("%-9s %-9s %6s %8s %10s %9s %9s %9s %9s %9s\n", "prim", "arrival", "rounds",
+           "bad_rnds", "inversions", "wrong_1st", "first_p50", "hand_p50", "hand_p99", "hand_max");
+
+    for (int p = 0; p < NUM_PRIMS; p++) {
+        if (only >= 0 && p != only) continue;
+        for (int a = 0; a < NUM_ARRIVALS; a++)
+            run_case((enum primitive)p, (enum arrival)a, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,661 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#define DEFAULT_RUN_TIME        10     // seconds per phase
+#define DEFAULT_PROCS_PER_GROUP 1
+#define MAX_GROUPS              16
+#define SAMPLE_MS               100
+#define CONVERGE_TOLERANCE      0.02   // absolute CPU fraction
+#define PROBE_PERIOD_NS         1000000L  // 1 ms
+#define PROBE_NICE              -10
+#define NSEC_PER_SEC            1000000000L
+
+// Default mix: three weighted groups plus one bandwidth-limited group. Its cap
+// (0.05 CPU) is below its weight share (100/800 = 0.125), so it binds and the
+// throttling phase actually sees throttling.
+static const char *default_specs[] = { "100", "200", "400", "100:5000/100000" };
+
+typedef struct {
+    char path[384];
+    int weight;
+    long quota_us;          // -1 = "max" (unlimited)
+    long period_us;
+    double expected;        // expected fraction of one CPU
+    pid_t *pids;
+    unsigned long long usage_start;
+    unsigned long long *usage;    // cumulative usage_usec at each sample
+} cgroup_t;
+
+#ifndef __linux__
+
+int main(void) {
+    printf("cgroup v2 is Linux-only; skipping.\n");
+    return 0;
+}
+
+#else
+
+static char home_path[256];       // the cgroup we were started in
+static char parent_path[320];
+static char ctl_path[336];
+static int moved_out;             // we sit in ctl_path rather than home_path
+static int home_cpu_enabled;      // we turned the cpu controller on in home_path
+static cgroup_t groups[MAX_GROUPS];
+static int num_groups = 0;
+static int num_procs;             // per group, for the signal handler
+static pid_t main_pid;
+static volatile pid_t probe_pid;
+
+// Plain open/write so the signal handler's cleanup can use it too
+static int write_file(const char *path, const char *value) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) return -1;
+    size_t len = strlen(value);
+    int ok = write(fd, value, len) == (ssize_t)len;
+    int err = errno;
+    if (close(fd) != 0 && ok) {
+        ok = 0;
+        err = errno;
+    }
+    errno = err;
+    return ok ? 0 : -1;
+}
+
+static int read_usage_usec(const cgroup_t *g, unsigned long long *usage) {
+    char path[448], key[64];
+    unsigned long long value;
+    snprintf(path, sizeof(path), "%s/cpu.stat", g->path);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int rc = -1;
+    while (fscanf(fp, "%63s %llu", key, &value) == 2) {
+        if (strcmp(key, "usage_usec") == 0) {
+            *usage = value;
+            rc = 0;
+            break;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+static void read_throttle_stats(const cgroup_t *g, unsigned long long *nr_throttled,
+                                unsigned long long *throttled_usec) {
+    char path[448], key[64];
+    unsigned long long value;
+    *nr_throttled = *throttled_usec = 0;
+    snprintf(path, sizeof(path), "%s/cpu.stat", g->path);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+    while (fscanf(fp, "%63s %llu", key, &value) == 2) {
+        if (strcmp(key, "nr_throttled") == 0) *nr_throttled = value;
+        else if (strcmp(key, "throttled_usec") == 0) *throttled_usec = value;
+    }
+    fclose(fp);
+}
+
+static int find_cgroup2_mount(char *out, size_t len) {
+    FILE *fp = fopen("/proc/self/mounts", "r");
+    if (!fp) return -1;
+    char dev[256], dir[256], type[64];
+    int rc = -1;
+    while (fscanf(fp, "%255s %255s %63s %*[^\n]", dev, dir, type) == 3) {
+        if (strcmp(type, "cgroup2") == 0) {
+            snprintf(out, len, "%s", dir);
+            rc = 0;
+            break;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+// The caller's own cgroup, from the "0::/path" line of /proc/self/cgroup
+static int find_own_cgroup(char *out, size_t len) {
+    FILE *fp = fopen("/proc/self/cgroup", "r");
+    if (!fp) return -1;
+    char line[512];
+    int rc = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            const char *own = strcmp(line + 3, "/") == 0 ? "" : line + 3;
+            rc = snprintf(out, len, "%s", own) < (int)len ? 0 : -1;
+            break;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+static int subtree_has_cpu(const char *cgroup) {
+    char path[448], name[64];
+    snprintf(path, sizeof(path), "%s/cgroup.subtree_control", cgroup);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    int found = 0;
+    while (!found && fscanf(fp, "%63s", name) == 1)
+        found = strcmp(name, "cpu") == 0;
+    fclose(fp);
+    return found;
+}
+
+static int set_cpu_max(const cgroup_t *g, long quota_us, long period_us) {
+    char path[448], value[64];
+    snprintf(path, sizeof(path), "%s/cpu.max", g->path);
+    if (quota_us < 0)
+        snprintf(value, sizeof(value), "max %ld", period_us);
+    else
+        snprintf(value, sizeof(value), "%ld %ld", quota_us, period_us);
+    return write_file(path, value);
+}
+
+static int move_pid(const cgroup_t *g, pid_t pid) {
+    char path[448], value[32];
+    snprintf(path, sizeof(path), "%s/cgroup.procs", g->path);
+    snprintf(value, sizeof(value), "%d", (int)pid);
+    return write_file(path, value);
+}
+
+// Also runs from the signal handler. Puts us back where we started, which
+// first needs the cpu controller we enabled there turned off again.
+static void cleanup_cgroups(void) {
+    char path[448], value[32];
+    for (int i = 0; i < num_groups; i++)
+        if (groups[i].path[0]) rmdir(groups[i].path);
+    if (moved_out) {
+        if (home_cpu_enabled) {
+            snprintf(path, sizeof(path), "%s/cgroup.subtree_control", parent_path);
+            write_file(path, "-cpu");
+            snprintf(path, sizeof(path), "%s/cgroup.subtree_control", home_path);
+            write_file(path, "-cpu");
+            home_cpu_enabled = 0;
+        }
+        snprintf(path, sizeof(path), "%s/cgroup.procs", home_path);
+        snprintf(value, sizeof(value), "%d", (int)getpid());
+        if (write_file(path, value) == 0) moved_out = 0;
+    }
+    if (ctl_path[0]) rmdir(ctl_path);
+    if (parent_path[0]) rmdir(parent_path);
+}
+
+// Creates microkernel_bench.<pid>/gN under the cgroup we were started in, with
+// the cpu controller enabled. cgroup v2 only hands controllers down from a
+// cgroup with no processes of its own, so we first move ourselves into a ctl
+// leaf next to the groups. Returns -1 (with a reason printed) when cgroup v2
+// is not usable.
+static int setup_cgroups(void) {
+    char mount[256], own[256], path[448], value[32];
+    if (find_cgroup2_mount(mount, sizeof(mount)) != 0 || find_own_cgroup(own, sizeof(own)) != 0) {
+        printf("No cgroup2 mount found; skipping.\n");
+        return -1;
+    }
+    if (snprintf(home_path, sizeof(home_path), "%s%s", mount, own) >= (int)sizeof(home_path)) {
+        printf("Cgroup path %s%s is too long; skipping.\n", mount, own);
+        return -1;
+    }
+
+    snprintf(parent_path, sizeof(parent_path), "%s/microkernel_bench.%d", home_path, (int)getpid());
+    if (mkdir(parent_path, 0755) != 0) {
+        printf("Cannot create %s (%s); skipping.\n", parent_path, strerror(errno));
+        parent_path[0] = '\0';
+        return -1;
+    }
+    snprintf(ctl_path, sizeof(ctl_path), "%s/ctl", parent_path);
+    if (mkdir(ctl_path, 0755) != 0) {
+        printf("Cannot create %s (%s); skipping.\n", ctl_path, strerror(errno));
+        ctl_path[0] = '\0';
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/cgroup.procs", ctl_path);
+    snprintf(value, sizeof(value), "%d", (int)getpid());
+    if (write_file(path, value) != 0) {
+        printf("Cannot move into %s (%s); skipping.\n", ctl_path, strerror(errno));
+        return -1;
+    }
+    moved_out = 1;
+
+    if (!subtree_has_cpu(home_path)) {
+        snprintf(path, sizeof(path), "%s/cgroup.subtree_control", home_path);
+        if (write_file(path, "+cpu") != 0) {
+            printf("Cannot enable cpu controller in %s (%s); run from a cgroup of its own with cpu "
+                   "delegated (e.g. systemd-run --user --scope -p Delegate=yes); skipping.\n",
+                   home_path, strerror(errno));
+            return -1;
+        }
+        home_cpu_enabled = 1;
+    }
+    snprintf(path, sizeof(path), "%s/cgroup.subtree_control", parent_path);
+    if (write_file(path, "+cpu") != 0) {
+        printf("Cannot enable cpu controller in %s (%s); skipping.\n", parent_path, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < num_groups; i++) {
+        char value[32];
+        snprintf(groups[i].path, sizeof(groups[i].path), "%s/g%d", parent_path, i);
+        if (mkdir(groups[i].path, 0755) != 0) {
+            printf("Cannot create %s (%s); skipping.\n", groups[i].path, strerror(errno));
+            groups[i].path[0] = '\0';
+            return -1;
+        }
+        if (snprintf(path, sizeof(path), "%s/cpu.weight", groups[i].path) >= (int)sizeof(path)) {
+            printf("Cgroup path %s is too long; skipping.\n", groups[i].path);
+            return -1;
+        }
+        snprintf(value, sizeof(value), "%d", groups[i].weight);
+        if (write_file(path, value) != 0 ||
+            set_cpu_max(&groups[i], groups[i].quota_us, groups[i].period_us) != 0) {
+            printf("Cannot configure %s (%s); skipping.\n", groups[i].path, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Parses "weight[:quota_us/period_us]"
+static void parse_group_spec(const char *spec, cgroup_t *g) {
+    g->quota_us = -1;
+    g->period_us = 100000;
+    int n = sscanf(spec, "%d:%ld/%ld", &g->weight, &g->quota_us, &g->period_us);
+    if (n < 1 || n == 2 || g->weight < 1 || g->weight > 10000 ||
+        (n == 3 && (g->quota_us <= 0 || g->period_us <= 0))) {
+        fprintf(stderr, "Bad group spec '%s' (expected weight[:quota_us/period_us])\n", spec);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Water-filling: share one CPU by weight, clamp groups at their cpu.max cap
+// and hand the excess to the remaining groups.
+static void compute_expected_shares(double capacity) {
+    int fixed[MAX_GROUPS] = { 0 };
+    double remaining = capacity;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        double total_weight = 0.0;
+        for (int i = 0; i < num_groups; i++)
+            if (!fixed[i]) total_weight += groups[i].weight;
+        if (total_weight == 0.0) break;
+        for (int i = 0; i < num_groups; i++) {
+            if (fixed[i]) continue;
+            groups[i].expected = remaining * groups[i].weight / total_weight;
+            if (groups[i].quota_us >= 0) {
+                double cap = (double)groups[i].quota_us / groups[i].period_us;
+                if (groups[i].expected > cap) {
+                    groups[i].expected = cap;
+                    fixed[i] = 1;
+                    remaining -= cap;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+static void worker_loop(void) {
+    volatile unsigned long counter = 0;
+    while (1) counter++;
+}
+
+// Forks a child that blocks on the gate pipe until it has been moved into its group
+static pid_t spawn_in_group(const cgroup_t *g, int gate_fd, void (*body)(void *), void *arg) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        char c;
+        if (read(gate_fd, &c, 1) != 1) _exit(EXIT_FAILURE);
+        body(arg);
+        _exit(EXIT_SUCCESS);
+    }
+    if (move_pid(g, pid) != 0) {
+        fprintf(stderr, "move pid %d to %s: %s\n", (int)pid, g->path, strerror(errno));
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+static void worker_body(void *arg) {
+    (void)arg;
+    worker_loop();
+}
+
+typedef struct {
+    long long *samples;
+    long max_samples;
+    volatile long *count;
+    int run_time;
+} probe_args_t;
+
+// "RT-ish" periodic task: a negatively niced SCHED_OTHER thread, since cgroup v2
+// does not allow SCHED_FIFO tasks in groups with the cpu controller enabled.
+static void probe_body(void *arg) {
+    probe_args_t *p = (probe_args_t *)arg;
+    if (setpriority(PRIO_PROCESS, 0, PROBE_NICE) != 0)
+        perror("setpriority (probe)");
+
+    struct timespec next, now;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    time_t end_sec = next.tv_sec + p->run_time;
+    long n = 0;
+    while (n < p->max_samples && next.tv_sec < end_sec) {
+        next.tv_nsec += PROBE_PERIOD_NS;
+        if (next.tv_nsec >= NSEC_PER_SEC) {
+            next.tv_nsec -= NSEC_PER_SEC;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long lat = (now.tv_sec - next.tv_sec) * NSEC_PER_SEC + (now.tv_nsec - next.tv_nsec);
+        p->samples[n++] = lat;
+        *p->count = n;
+        // Skip periods we slept through so lateness is not double counted
+        while ((now.tv_sec - next.tv_sec) * NSEC_PER_SEC + (now.tv_nsec - next.tv_nsec) > PROBE_PERIOD_NS) {
+            next.tv_nsec += PROBE_PERIOD_NS;
+            if (next.tv_nsec >= NSEC_PER_SEC) {
+                next.tv_nsec -= NSEC_PER_SEC;
+                next.tv_sec++;
+            }
+        }
+    }
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void stop_workers(int procs_per_group) {
+    for (int g = 0; g < num_groups; g++) {
+        if (!groups[g].pids) continue;
+        for (int p = 0; p < procs_per_group; p++) {
+            if (groups[g].pids[p] > 0) {
+                kill(groups[g].pids[p], SIGKILL);
+                waitpid(groups[g].pids[p], NULL, 0);
+                groups[g].pids[p] = 0;
+            }
+        }
+    }
+}
+
+// SIGINT/SIGTERM: kill the children and remove the groups before dying
+static void on_signal(int sig) {
+    if (getpid() != main_pid) _exit(EXIT_FAILURE);   // forked children inherit this
+    if (probe_pid > 0) {
+        kill(probe_pid, SIGKILL);
+        waitpid(probe_pid, NULL, 0);
+    }
+    stop_workers(num_procs);
+    cleanup_cgroups();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void start_workers(int procs_per_group, int gate_fd) {
+    for (int g = 0; g < num_groups; g++) {
+        for (int p = 0; p < procs_per_group; p++) {
+            groups[g].pids[p] = spawn_in_group(&groups[g], gate_fd, worker_body, NULL);
+            if (groups[g].pids[p] < 0) {
+                stop_workers(procs_per_group);
+                cleanup_cgroups();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+static void release_gate(int gate[2], int count) {
+    for (int i = 0; i < count; i++) {
+        if (write(gate[1], "g", 1) != 1)
+            perror("write gate");
+    }
+}
+
+// Phase 1: achieved vs expected CPU share and time to converge
+static void run_share_phase(int run_time, int procs_per_group) {
+    int max_samples = run_time * 1000 / SAMPLE_MS;
+    int gate[2];
+    if (pipe(gate) != 0) {
+        perror("pipe");
+        return;
+    }
+    start_workers(procs_per_group, gate[0]);
+
+    struct timespec start, next;
+    for (int g = 0; g < num_groups; g++)
+        read_usage_usec(&groups[g], &groups[g].usage_start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    release_gate(gate, num_groups * procs_per_group);
+
+    next = start;
+    for (int s = 0; s < max_samples; s++) {
+        next.tv_nsec += SAMPLE_MS * 1000000L;
+        if (next.tv_nsec >= NSEC_PER_SEC) {
+            next.tv_nsec -= NSEC_PER_SEC;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        for (int g = 0; g < num_groups; g++)
+            read_usage_usec(&groups[g], &groups[g].usage[s]);
+    }
+    stop_workers(procs_per_group);
+    close(gate[0]);
+    close(gate[1]);
+
+    printf("\nCPU share accuracy (%d s, %d worker(s) per group, CPU 0):\n", run_time, procs_per_group);
+    printf("%-6s %7s %14s %9s %9s %9s %12s\n",
+           "group", "weight", "cpu.max", "expected", "achieved", "abs_err", "converge_ms");
+    double max_err = 0.0;
+    for (int g = 0; g < num_groups; g++) {
+        cgroup_t *c = &groups[g];
+        double achieved = (double)(c->usage[max_samples - 1] - c->usage_start) /
+                          ((double)max_samples * SAMPLE_MS * 1000.0);
+        double err = achieved > c->expected ? achieved - c->expected : c->expected - achieved;
+        if (err > max_err) max_err = err;
+
+        // Earliest sample after which the cumulative share stays within tolerance
+        int converge = -1;
+        for (int s = max_samples - 1; s >= 0; s--) {
+            double cum = (double)(c->usage[s] - c->usage_start) / ((double)(s + 1) * SAMPLE_MS * 1000.0);
+            double d = cum > c->expected ? cum - c->expected : c->expected - cum;
+            if (d > CONVERGE_TOLERANCE) break;
+            converge = s;
+        }
+
+        char max_str[32];
+        if (c->quota_us < 0)
+            snprintf(max_str, sizeof(max_str), "max");
+        else
+            snprintf(max_str, sizeof(max_str), "%ld/%ld", c->quota_us, c->period_us);
+        char conv_str[32];
+        if (converge < 0)
+            snprintf(conv_str, sizeof(conv_str), "never");
+        else
+            snprintf(conv_str, sizeof(conv_str), "%d", (converge + 1) * SAMPLE_MS);
+        printf("g%-5d %7d %14s %9.3f %9.3f %9.3f %12s\n",
+               g, c->weight, max_str, c->expected, achieved, err, conv_str);
+    }
+    printf("Max absolute share error: %.3f CPU\n", max_err);
+}
+
+// Runs the probe inside group `target` next to the workers and prints its wake-up latency
+static void run_probe(int target, int run_time, int procs_per_group, const char *label) {
+    long max_samples = (long)run_time * (NSEC_PER_SEC / PROBE_PERIOD_NS);
+    size_t shm_size = max_samples * sizeof(long long) + sizeof(long);
+    void *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        return;
+    }
+    probe_args_t args = {
+        .samples = (long long *)shm,
+        .max_samples = max_samples,
+        .count = (volatile long *)((char *)shm + max_samples * sizeof(long long)),
+        .run_time = run_time
+    };
+
+    int gate[2];
+    if (pipe(gate) != 0) {
+        perror("pipe");
+        munmap(shm, shm_size);
+        return;
+    }
+    unsigned long long thr0, thr_usec0, thr1, thr_usec1;
+    read_throttle_stats(&groups[target], &thr0, &thr_usec0);
+
+    start_workers(procs_per_group, gate[0]);
+    pid_t probe = spawn_in_group(&groups[target], gate[0], probe_body, &args);
+    probe_pid = probe;
+    release_gate(gate, num_groups * procs_per_group + (probe > 0 ? 1 : 0));
+    if (probe > 0)
+        waitpid(probe, NULL, 0);
+    probe_pid = 0;
+    stop_workers(procs_per_group);
+    close(gate[0]);
+    close(gate[1]);
+    read_throttle_stats(&groups[target], &thr1, &thr_usec1);
+
+    long n = *args.count;
+    if (n > 0) {
+        qsort(args.samples, n, sizeof(long long), cmp_ll);
+        printf("%-22s %8ld %9.1f %9.1f %9.1f %10.1f %10llu %12.1f\n", label, n,
+               args.samples[n / 2] / 1000.0,
+               args.samples[(long)(n * 0.99)] / 1000.0,
+               args.samples[(long)(n * 0.999)] / 1000.0,
+               args.samples[n - 1] / 1000.0,
+               thr1 - thr0, (thr_usec1 - thr_usec0) / 1000.0);
+    } else {
+        printf("%-22s no samples\n", label);
+    }
+    munmap(shm, shm_size);
+}
+
+// Phase 2: probe latency in the first bandwidth-limited group, with and without its cpu.max
+static void run_throttle_phase(int run_time, int procs_per_group) {
+    int target = -1;
+    for (int g = 0; g < num_groups; g++) {
+        if (groups[g].quota_us >= 0) {
+            target = g;
+            break;
+        }
+    }
+    if (target < 0) {
+        printf("\nNo group has a cpu.max limit; skipping throttling latency phase.\n");
+        return;
+    }
+
+    printf("\nThrottling latency penalty (probe: nice %d, %ld us period, in g%d):\n",
+           PROBE_NICE, PROBE_PERIOD_NS / 1000, target);
+    // compute_expected_shares() clamps a group to its cap only when the cap binds
+    double cap = (double)groups[target].quota_us / groups[target].period_us;
+    if (groups[target].expected < cap)
+        printf("note: g%d's cap (%.3f CPU) is above its weight share (%.3f CPU), so it may never be throttled\n",
+               target, cap, groups[target].expected);
+    printf("%-22s %8s %9s %9s %9s %10s %10s %12s\n",
+           "configuration", "samples", "p50_us", "p99_us", "p99.9_us", "max_us",
+           "throttles", "throttled_ms");
+
+    char label[64];
+    snprintf(label, sizeof(label), "cpu.max %ld/%ld", groups[target].quota_us, groups[target].period_us);
+    run_probe(target, run_time, procs_per_group, label);
+
+    if (set_cpu_max(&groups[target], -1, groups[target].period_us) != 0) {
+        perror("cpu.max");
+        return;
+    }
+    run_probe(target, run_time, procs_per_group, "cpu.max unlimited");
+    set_cpu_max(&groups[target], groups[target].quota_us, groups[target].period_us);
+}
+
+int main(int argc, char *argv[]) {
+    int run_time = DEFAULT_RUN_TIME;
+    int procs_per_group = DEFAULT_PROCS_PER_GROUP;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [run_seconds=%d] [procs_per_group=%d] [weight[:quota_us/period_us] ...]\n",
+                argv[0], DEFAULT_RUN_TIME, DEFAULT_PROCS_PER_GROUP);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1) {
+        run_time = atoi(argv[1]);
+        if (run_time <= 0) run_time = DEFAULT_RUN_TIME;
+    }
+    if (argc > 2) {
+        procs_per_group = atoi(argv[2]);
+        if (procs_per_group <= 0) procs_per_group = DEFAULT_PROCS_PER_GROUP;
+    }
+    if (argc > 3) {
+        for (int i = 3; i < argc && num_groups < MAX_GROUPS; i++)
+            parse_group_spec(argv[i], &groups[num_groups++]);
+    } else {
+        for (size_t i = 0; i < sizeof(default_specs) / sizeof(default_specs[0]); i++)
+            parse_group_spec(default_specs[i], &groups[num_groups++]);
+    }
+
+    // All workers compete for one CPU so weights and caps actually bind
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(0, &cpuset);
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) != 0) {
+        perror("sched_setaffinity");
+        exit(EXIT_FAILURE);
+    }
+
+    main_pid = getpid();
+    num_procs = procs_per_group;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaddset(&sa.sa_mask, SIGINT);
+    sigaddset(&sa.sa_mask, SIGTERM);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (setup_cgroups() != 0) {
+        cleanup_cgroups();
+        return 0;
+    }
+
+    int max_samples = run_time * 1000 / SAMPLE_MS;
+    for (int g = 0; g < num_groups; g++) {
+        groups[g].pids = calloc(procs_per_group, sizeof(pid_t));
+        groups[g].usage = calloc(max_samples, sizeof(unsigned long long));
+        if (!groups[g].pids || !groups[g].usage) {
+            perror("calloc");
+            cleanup_cgroups();
+            exit(EXIT_FAILURE);
+        }
+    }
+    compute_expected_shares(1.0);
+
+    printf("cgroup v2 fairness benchmark: %d group(s) under %s\n", num_groups, parent_path);
+    run_share_phase(run_time, procs_per_group);
+    run_throttle_phase(run_time, procs_per_group);
+
+    cleanup_cgroups();
+    for (int g = 0; g < num_groups; g++) {
+        free(groups[g].pids);
+        free(groups[g].usage);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+
+#define DEFAULT_ITERATIONS 2000
+#define DEFAULT_RSS_LIST   "0,64,256"
+#define CHILD_EXIT_ARG     "--lifecycle-child-exit"
+
+extern char **environ;
+
+static char self_path[PATH_MAX];
+
+typedef struct {
+    const char *name;
+    int (*op)(void);
+} lifecycle_op_t;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int reap(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static int op_fork_exit(void) {
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) _exit(0);
+    return reap(pid);
+}
+
+static int op_fork_exec(void) {
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        execl(self_path, self_path, CHILD_EXIT_ARG, (char *)NULL);
+        _exit(127);
+    }
+    return reap(pid);
+}
+
+static int op_vfork_exec(void) {
+    pid_t pid = vfork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        execl(self_path, self_path, CHILD_EXIT_ARG, (char *)NULL);
+        _exit(127);
+    }
+    return reap(pid);
+}
+
+static int op_posix_spawn(void) {
+    pid_t pid;
+    char *argv[] = { self_path, CHILD_EXIT_ARG, NULL };
+    if (posix_spawn(&pid, self_path, NULL, NULL, argv, environ) != 0) return -1;
+    return reap(pid);
+}
+
+static void* empty_thread(void *arg) {
+    return arg;
+}
+
+static int op_pthread_create_join(void) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, empty_thread, NULL) != 0) return -1;
+    return pthread_join(t, NULL);
+}
+
+// Single persistent worker: a "task" is handing it a sequence number and
+// waiting until it reports back, i.e. what a thread pool does instead of
+// creating a thread per job.
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static long pool_submitted = 0, pool_completed = 0;
+static int pool_shutdown = 0;
+
+static void* pool_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pool_lock);
+    while (!pool_shutdown) {
+        while (pool_completed == pool_submitted && !pool_shutdown)
+            pthread_cond_wait(&pool_work, &pool_lock);
+        if (pool_completed < pool_submitted) {
+            pool_completed++;
+            pthread_cond_signal(&pool_done);
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+static int op_pool_dispatch(void) {
+    pthread_mutex_lock(&pool_lock);
+    long ticket = ++pool_submitted;
+    pthread_cond_signal(&pool_work);
+    while (pool_completed < ticket)
+        pthread_cond_wait(&pool_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+    return 0;
+}
+
+static const lifecycle_op_t ops[] = {
+    { "fork+exit",      op_fork_exit },
+    { "fork+exec",      op_fork_exec },
+    { "vfork+exec",     op_vfork_exec },
+    { "posix_spawn",    op_posix_spawn },
+    { "pthread_create", op_pthread_create_join },
+    { "pool_dispatch",  op_pool_dispatch },
+};
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_op(const lifecycle_op_t *op, int iterations, long long *samples, size_t rss_mb) {
+    int failures = 0, n = 0;
+    // A few untimed rounds to fault in code paths and the dynamic loader cache
+    for (int i = 0; i < 10; i++) op->op();
+
+    long long start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        long long t0 = now_ns();
+        if (op->op() != 0) {
+            failures++;
+            continue;
+        }
+        samples[n++] = now_ns() - t0;
+    }
+    long long total = now_ns() - start;
+
+    if (n == 0) {
+        printf("%-15s %7zu all %d iterations failed: %s\n", op->name, rss_mb, iterations, strerror(errno));
+        return;
+    }
+    qsort(samples, n, sizeof(long long), cmp_ll);
+    printf("%-15s %7zu %10.0f %9.1f %9.1f %9.1f %9.1f %10.1f %6d\n",
+           op->name, rss_mb, n * 1e9 / total,   // successful iterations only
+           samples[0] / 1e3, samples[n / 2] / 1e3, samples[(long)(n * 0.99)] / 1e3,
+           samples[(long)(n * 0.999)] / 1e3, samples[n - 1] / 1e3, failures);
+    fflush(stdout);
+}
+
+static void resolve_self(const char *argv0) {
+#ifdef __linux__
+    ssize_t len = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
+    if (len > 0) {
+        self_path[len] = '\0';
+        return;
+    }
+#endif
+    if (!realpath(argv0, self_path))
+        snprintf(self_path, sizeof(self_path), "%s", argv0);
+}
+
+int main(int argc, char *argv[]) {
+    // Exec'd children land here and leave immediately
+    if (argc > 1 && strcmp(argv[1], CHILD_EXIT_ARG) == 0)
+        return 0;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [iterations=%d] [parent_rss_mb_list=%s]\n",
+                argv[0], DEFAULT_ITERATIONS, DEFAULT_RSS_LIST);
+        return EXIT_FAILURE;
+    }
+
+    int iterations = DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        iterations = atoi(argv[1]);
+        if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+    }
+    const char *rss_list = argc > 2 ? argv[2] : DEFAULT_RSS_LIST;
+    resolve_self(argv[0]);
+
+    long long *samples = malloc(iterations * sizeof(long long));
+    if (!samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    pthread_t pool_thread;
+    if (pthread_create(&pool_thread, NULL, pool_worker, NULL) != 0) {
+        perror("pthread_create (pool)");
+        return EXIT_FAILURE;
+    }
+
+    printf("Process/thread lifecycle throughput (%d iterations per op; latencies in us)\n", iterations);
+    printf("%-15s %7s %10s %9s %9s %9s %9s %10s %6s\n",
+           "operation", "rss_mb", "ops/sec", "min", "p50", "p99", "p99.9", "max", "fail");
+
+    for (const char *p = rss_list; *p; ) {
+        size_t rss_mb = (size_t)atol(p);
+
+        // Grow the parent's resident set so fork has real page tables to copy
+        char *ballast = NULL;
+        if (rss_mb > 0) {
+            ballast = mmap(NULL, rss_mb << 20, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ballast == MAP_FAILED) {
+                fprintf(stderr, "mmap %zu MB ballast: %s, skipping\n", rss_mb, strerror(errno));
+                ballast = NULL;
+            } else {
+                memset(ballast, 1, rss_mb << 20);
+            }
+        }
+
+        if (ballast || rss_mb == 0) {
+            for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+                run_op(&ops[i], iterations, samples, rss_mb);
+        }
+
+        if (ballast)
+            munmap(ballast, rss_mb << 20);
+
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    pool_shutdown = 1;
+    pthread_cond_signal(&pool_work);
+    pthread_mutex_unlock(&pool_lock);
+    pthread_join(pool_thread, NULL);
+
+    free(samples);
+    return 0;
+}
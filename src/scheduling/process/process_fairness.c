@@ -1,112 +1,199 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <sys/time.h>
+#include <sys/mman.h>
 #include <sched.h>
 #include <sys/resource.h>
 
-#define NUM_PROCS 10   /* Number of child processes */
-#define RUN_TIME 5     /* Run time in seconds for each child */
+#define NUM_PROCS 10          /* Default number of child processes */
+#define RUN_TIME 5            /* Default run time in seconds */
+#define SAMPLE_MS 100         /* Default sampling interval in milliseconds */
+#define CACHE_LINE_SIZE 64
+#define STARVATION_FRACTION 0.10  /* interval counts as starved below 10% of the fair share */
 
-int main(void) {
-    
-    int pipefd[NUM_PROCS][2];
-    pid_t pids[NUM_PROCS];
-    unsigned long long counts[NUM_PROCS];
+/* One counter per child, each on its own cache line of a shared mapping */
+typedef struct {
+    volatile unsigned long long count;
+    char pad[CACHE_LINE_SIZE - sizeof(unsigned long long)];
+} __attribute__((aligned(CACHE_LINE_SIZE))) proc_counter_t;
 
-    /* Create children and a dedicated pipe for each */
-    for (int i = 0; i < NUM_PROCS; i++) {
-        if (pipe(pipefd[i]) == -1) {
-            perror("pipe");
-            exit(EXIT_FAILURE);
-        }
+typedef struct {
+    volatile int stop;
+    char pad[CACHE_LINE_SIZE - sizeof(int)];
+} __attribute__((aligned(CACHE_LINE_SIZE))) shared_flag_t;
+
+/* Jain's fairness index: 1.0 when all shares are equal, 1/n when one process gets everything */
+double jain_index(const double *x, int n) {
+    double sum = 0.0, sum_sq = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i];
+        sum_sq += x[i] * x[i];
+    }
+    return sum_sq > 0.0 ? (sum * sum) / (n * sum_sq) : 1.0;
+}
+
+double coeff_of_variation(const double *x, int n) {
+    double mean = 0.0, var = 0.0;
+    for (int i = 0; i < n; i++) mean += x[i];
+    mean /= n;
+    for (int i = 0; i < n; i++) var += (x[i] - mean) * (x[i] - mean);
+    var /= n;
+    return mean > 0.0 ? sqrt(var) / mean : 0.0;
+}
+
+int main(int argc, char *argv[]) {
+    int num_procs = NUM_PROCS;
+    int run_time = RUN_TIME;
+    int sample_ms = SAMPLE_MS;
+
+    /* Optional: number of processes, run time in seconds, sample interval in ms */
+    if (argc > 1) {
+        num_procs = atoi(argv[1]);
+        if (num_procs <= 0) num_procs = NUM_PROCS;
+    }
+    if (argc > 2) {
+        run_time = atoi(argv[2]);
+        if (run_time <= 0) run_time = RUN_TIME;
+    }
+    if (argc > 3) {
+        sample_ms = atoi(argv[3]);
+        if (sample_ms <= 0) sample_ms = SAMPLE_MS;
+    }
+
+    /* Shared mapping: stop flag followed by the per-process counters */
+    size_t shm_size = sizeof(shared_flag_t) + num_procs * sizeof(proc_counter_t);
+    void *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    memset(shm, 0, shm_size);
+    shared_flag_t *flag = (shared_flag_t *)shm;
+    proc_counter_t *counters = (proc_counter_t *)((char *)shm + sizeof(shared_flag_t));
+
+    int max_samples = run_time * 1000 / sample_ms + 1;
+    unsigned long long *snapshots = calloc((size_t)max_samples * num_procs, sizeof(unsigned long long));
+    pid_t *pids = malloc(num_procs * sizeof(pid_t));
+    if (!snapshots || !pids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Create children */
+    for (int i = 0; i < num_procs; i++) {
         pids[i] = fork();
         if (pids[i] < 0) {
             perror("fork");
             exit(EXIT_FAILURE);
         }
         if (pids[i] == 0) {  /* Child process */
-            /* Close the read end; we only need to write the result */
-            close(pipefd[i][0]);
-
-            struct timeval start, current;
-            if (gettimeofday(&start, NULL) < 0) {
-                perror("gettimeofday");
-                exit(EXIT_FAILURE);
-            }
-
-            /* Use a volatile counter to prevent compiler optimizations */
-            volatile unsigned long long counter = 0;
-            while (1) {
-                counter++;
-                /* Check time every 1,000,000 iterations to reduce overhead */
-                if (counter % 1000000 == 0) {
-                    if (gettimeofday(&current, NULL) < 0) {
-                        perror("gettimeofday");
-                        exit(EXIT_FAILURE);
-                    }
-                    double elapsed = (current.tv_sec - start.tv_sec) +
-                                     (current.tv_usec - start.tv_usec) / 1e6;
-                    if (elapsed >= RUN_TIME) {
-                        break;
-                    }
-                }
-            }
-
-            /* Write the counter value as text to the pipe */
-            char buffer[64];
-            int len = snprintf(buffer, sizeof(buffer), "%llu", counter);
-            if (write(pipefd[i][1], buffer, len) < 0) {
-                perror("write");
+            unsigned long long counter = 0;
+            while (!flag->stop) {
+                counters[i].count = ++counter;
             }
-            close(pipefd[i][1]);
-            exit(EXIT_SUCCESS);
+            _exit(EXIT_SUCCESS);
         }
         /* Parent continues to fork the next child */
     }
 
-    /* Parent process: close write ends for all pipes */
-    for (int i = 0; i < NUM_PROCS; i++) {
-        close(pipefd[i][1]);
+    /* Parent acts as the sampler: snapshot every counter at a fixed interval */
+    int num_samples = 0;
+    struct timespec start, next, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    while (num_samples < max_samples) {
+        next.tv_nsec += (long)sample_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        unsigned long long *row = &snapshots[(size_t)num_samples * num_procs];
+        for (int i = 0; i < num_procs; i++)
+            row[i] = counters[i].count;
+        num_samples++;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        if (elapsed >= run_time)
+            break;
     }
+    flag->stop = 1;
 
     /* Wait for all child processes to finish */
-    for (int i = 0; i < NUM_PROCS; i++) {
-        wait(NULL);
+    for (int i = 0; i < num_procs; i++) {
+        waitpid(pids[i], NULL, 0);
     }
 
-    /* Read each child's result from its pipe */
-    for (int i = 0; i < NUM_PROCS; i++) {
-        char buf[64];
-        int n = read(pipefd[i][0], buf, sizeof(buf) - 1);
-        if (n > 0) {
-            buf[n] = '\0';
-            counts[i] = strtoull(buf, NULL, 10);
-        } else {
-            counts[i] = 0;
+    /* Per-interval progress, fairness over time and starvation streaks */
+    double *delta = malloc(num_procs * sizeof(double));
+    int *starved = calloc(num_procs, sizeof(int));
+    int *streak = calloc(num_procs, sizeof(int));
+    int *longest = calloc(num_procs, sizeof(int));
+    if (!delta || !starved || !streak || !longest) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Fairness over time (%d ms intervals):\n", sample_ms);
+    printf("%8s %8s %8s\n", "t_ms", "jain", "cov");
+    for (int s = 0; s < num_samples; s++) {
+        double total = 0.0;
+        for (int i = 0; i < num_procs; i++) {
+            unsigned long long cur = snapshots[(size_t)s * num_procs + i];
+            unsigned long long prev = s > 0 ? snapshots[(size_t)(s - 1) * num_procs + i] : 0;
+            delta[i] = (double)(cur - prev);
+            total += delta[i];
+        }
+        double fair_share = total / num_procs;
+        for (int i = 0; i < num_procs; i++) {
+            if (delta[i] < STARVATION_FRACTION * fair_share) {
+                starved[i]++;
+                if (++streak[i] > longest[i]) longest[i] = streak[i];
+            } else {
+                streak[i] = 0;
+            }
         }
-        close(pipefd[i][0]);
+        printf("%8d %8.4f %8.4f\n", (s + 1) * sample_ms,
+               jain_index(delta, num_procs), coeff_of_variation(delta, num_procs));
     }
 
     /* Compute basic statistics */
-    unsigned long long min = counts[0], max = counts[0], sum = 0;
-    for (int i = 0; i < NUM_PROCS; i++) {
-        if (counts[i] < min)
-            min = counts[i];
-        if (counts[i] > max)
-            max = counts[i];
-        sum += counts[i];
+    unsigned long long min = counters[0].count, max = counters[0].count, sum = 0;
+    for (int i = 0; i < num_procs; i++) {
+        unsigned long long c = counters[i].count;
+        delta[i] = (double)c;
+        if (c < min)
+            min = c;
+        if (c > max)
+            max = c;
+        sum += c;
     }
-    double avg = sum / (double)NUM_PROCS;
+    double avg = sum / (double)num_procs;
 
     /* Print the results */
-    printf("Process fairness test results after %d seconds:\n", RUN_TIME);
-    for (int i = 0; i < NUM_PROCS; i++) {
-        printf("Process %d: %llu iterations\n", i, counts[i]);
+    printf("\nProcess fairness test results after %d seconds:\n", run_time);
+    for (int i = 0; i < num_procs; i++) {
+        printf("Process %d: %llu iterations (%.2f%%), starved %d/%d intervals, longest starvation %d ms\n",
+               i, counters[i].count, sum ? 100.0 * counters[i].count / sum : 0.0,
+               starved[i], num_samples, longest[i] * sample_ms);
     }
     printf("Min: %llu, Max: %llu, Avg: %.0f\n", min, max, avg);
+    printf("Jain's fairness index: %.4f\n", jain_index(delta, num_procs));
+    printf("Coefficient of variation: %.4f\n", coeff_of_variation(delta, num_procs));
 
+    free(delta);
+    free(starved);
+    free(streak);
+    free(longest);
+    free(snapshots);
+    free(pids);
+    munmap(shm, shm_size);
     return 0;
 }
@@ -13,67 +13,146 @@
 #define DEFAULT_NUM_LOAD_PROCS  2
 #define SLEEP_INTERVAL_NS 10000000L  // 10 milliseconds in nanoseconds
 #define TEST_DURATION 5             // Run test for 5 seconds
+#define NSEC_PER_SEC 1000000000LL
+#define INITIAL_MARGIN_NS 200000L    // hybrid mode: first guess at sleep overshoot
+#define MIN_MARGIN_NS 5000L
 
-// Data structure to hold sleep process results.
+enum wake_mode { MODE_SLEEP, MODE_HYBRID };
+
+static enum wake_mode wake_mode = MODE_SLEEP;
+static long interval_ns = SLEEP_INTERVAL_NS;
+
+// Summary each sleep process sends back to the parent. Lateness is
+// wake time - deadline, so negative values mean the process woke early.
 typedef struct {
     int proc_id;
-    long total_jitter_ns;
     long iterations;
+    double min_us, p50_us, p99_us, p999_us, max_us, mean_us;
+    long early;
+    long missed_periods;
+    double cpu_us_per_wakeup;
+    double margin_us;
 } sleep_proc_data_t;
 
-// Function for sleep measurement process.
+static inline long long ts_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec ns_ts(long long ns) {
+    struct timespec t = { .tv_sec = ns / NSEC_PER_SEC, .tv_nsec = ns % NSEC_PER_SEC };
+    return t;
+}
+
+static inline long long clock_ns(clockid_t clk) {
+    struct timespec t;
+    if (clock_gettime(clk, &t) != 0) {
+        perror("clock_gettime");
+        exit(EXIT_FAILURE);
+    }
+    return ts_ns(&t);
+}
+
+// Sleeps until deadline - margin, then spins to the deadline. The margin
+// grows straight to any overshoot that made us late and decays slowly
+// otherwise; it is capped at a quarter of the period.
+static long long hybrid_wait(long long deadline, long *margin) {
+    long long wake_target = deadline - *margin;
+    struct timespec ts = ns_ts(wake_target);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+    long long woke = clock_ns(CLOCK_MONOTONIC);
+    long long overshoot = woke - wake_target;
+    if (overshoot >= *margin)
+        *margin = overshoot + overshoot / 8;
+    else
+        *margin -= (*margin - overshoot) / 64;
+    if (*margin > interval_ns / 4) *margin = interval_ns / 4;
+    if (*margin < MIN_MARGIN_NS) *margin = MIN_MARGIN_NS;
+
+    long long now = woke;
+    while (now < deadline)
+        now = clock_ns(CLOCK_MONOTONIC);
+    return now;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Function for sleep measurement process: wakes on a fixed grid of absolute
+// deadlines and records how far from each deadline it actually ran.
 void sleep_proc_function(int pipe_fd, int proc_id) {
     sleep_proc_data_t data;
+    memset(&data, 0, sizeof(data));
     data.proc_id = proc_id;
-    data.total_jitter_ns = 0;
-    data.iterations = 0;
 
-    struct timespec test_start, now, req;
-    req.tv_sec = 0;
-    req.tv_nsec = SLEEP_INTERVAL_NS;
-    if (clock_gettime(CLOCK_MONOTONIC, &test_start) != 0) {
-        perror("clock_gettime");
+    long max_samples = (long)(TEST_DURATION * NSEC_PER_SEC / interval_ns) + 16;
+    long long *lateness = malloc(max_samples * sizeof(long long));
+    if (!lateness) {
+        perror("malloc");
         exit(EXIT_FAILURE);
     }
 
-    while (1) {
-        struct timespec before, after;
-        if (clock_gettime(CLOCK_MONOTONIC, &before) != 0) {
-            perror("clock_gettime");
-            exit(EXIT_FAILURE);
-        }
-        if (nanosleep(&req, NULL) != 0) {
-            perror("nanosleep");
-            // Even if interrupted, we continue the test.
-        }
-        if (clock_gettime(CLOCK_MONOTONIC, &after) != 0) {
-            perror("clock_gettime");
-            exit(EXIT_FAILURE);
-        }
-        long elapsed_ns = (after.tv_sec - before.tv_sec) * 1000000000L +
-                          (after.tv_nsec - before.tv_nsec);
-        long jitter = elapsed_ns - SLEEP_INTERVAL_NS;
-        if (jitter < 0)
-            jitter = 0; // ignore if sleep was early
+    long margin = INITIAL_MARGIN_NS;
+    long long cpu_start = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    long long test_start = clock_ns(CLOCK_MONOTONIC);
+    long long test_end = test_start + TEST_DURATION * NSEC_PER_SEC;
+    long long deadline = test_start;
+    long long sum = 0;
 
-        data.total_jitter_ns += jitter;
-        data.iterations++;
+    while (data.iterations < max_samples) {
+        deadline += interval_ns;
+        if (deadline > test_end)
+            break;
 
-        if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
-            perror("clock_gettime");
-            exit(EXIT_FAILURE);
+        long long woke;
+        if (wake_mode == MODE_HYBRID) {
+            woke = hybrid_wait(deadline, &margin);
+        } else {
+            struct timespec ts = ns_ts(deadline);
+            int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            if (rc != 0 && rc != EINTR) {
+                errno = rc;
+                perror("clock_nanosleep");
+            }
+            woke = clock_ns(CLOCK_MONOTONIC);
         }
-        double total_elapsed = (now.tv_sec - test_start.tv_sec) +
-                               (now.tv_nsec - test_start.tv_nsec) / 1e9;
-        if (total_elapsed >= TEST_DURATION) {
-            break;
+
+        long long late = woke - deadline;
+        lateness[data.iterations++] = late;
+        sum += late;
+        if (late < 0)
+            data.early++;
+
+        // Fixed schedule: periods we overslept entirely are skipped, not queued up
+        while (woke - deadline >= interval_ns) {
+            deadline += interval_ns;
+            data.missed_periods++;
         }
     }
 
-    // Write results as text: "proc_id total_jitter_ns iterations"
-    char buffer[128];
-    int len = snprintf(buffer, sizeof(buffer), "%d %ld %ld", 
-                       data.proc_id, data.total_jitter_ns, data.iterations);
+    long n = data.iterations;
+    if (n > 0) {
+        qsort(lateness, n, sizeof(long long), cmp_ll);
+        data.min_us = lateness[0] / 1e3;
+        data.p50_us = lateness[n / 2] / 1e3;
+        data.p99_us = lateness[(long)(n * 0.99)] / 1e3;
+        data.p999_us = lateness[(long)(n * 0.999)] / 1e3;
+        data.max_us = lateness[n - 1] / 1e3;
+        data.mean_us = (double)sum / n / 1e3;
+        data.cpu_us_per_wakeup = (clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) / 1e3 / n;
+    }
+    data.margin_us = wake_mode == MODE_HYBRID ? margin / 1e3 : 0.0;
+    free(lateness);
+
+    // Write results as text, one field per column of the final report
+    char buffer[256];
+    int len = snprintf(buffer, sizeof(buffer), "%d %ld %f %f %f %f %f %f %ld %ld %f %f",
+                       data.proc_id, data.iterations, data.min_us, data.p50_us,
+                       data.p99_us, data.p999_us, data.max_us, data.mean_us,
+                       data.early, data.missed_periods, data.cpu_us_per_wakeup,
+                       data.margin_us);
     if (write(pipe_fd, buffer, len) != len) {
         perror("write");
     }
@@ -143,6 +222,19 @@ int main(int argc, char *argv[]) {
         if (num_load_procs < 0)
             num_load_procs = DEFAULT_NUM_LOAD_PROCS;
     }
+    if (argc > 3) {
+        if (strcmp(argv[3], "hybrid") == 0) {
+            wake_mode = MODE_HYBRID;
+        } else if (strcmp(argv[3], "sleep") != 0) {
+            fprintf(stderr, "Usage: %s [sleep_procs] [load_procs] [sleep|hybrid] [interval_us]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (argc > 4) {
+        long us = atol(argv[4]);
+        if (us > 0)
+            interval_ns = us * 1000L;
+    }
 
     // Allocate pipes for sleep processes.
     int (*sleep_pipes)[2] = malloc(num_sleep_procs * sizeof(int[2]));
@@ -195,19 +287,26 @@ int main(int argc, char *argv[]) {
         ;
 
     // Read and report results from sleep processes.
-    printf("Sleep/Wake Precision Test Results (over %d seconds):\n", TEST_DURATION);
+    printf("Sleep/Wake Precision Test Results (over %d seconds, %s mode, %ld us interval):\n",
+           TEST_DURATION, wake_mode == MODE_HYBRID ? "hybrid spin-sleep" : "absolute sleep",
+           interval_ns / 1000);
+    printf("%-7s %8s %9s %9s %9s %9s %9s %9s %7s %7s %10s %9s\n",
+           "process", "wakeups", "min_us", "p50_us", "p99_us", "p99.9_us", "max_us", "mean_us",
+           "early", "missed", "cpu_us/wk", "margin_us");
     for (int i = 0; i < num_sleep_procs; i++) {
-        char buf[128];
+        char buf[256];
         ssize_t n = read(sleep_pipes[i][0], buf, sizeof(buf) - 1);
         if (n > 0) {
             buf[n] = '\0';
-            sleep_proc_data_t result;
-            // Expecting format: "proc_id total_jitter_ns iterations"
-            if (sscanf(buf, "%d %ld %ld", &result.proc_id, &result.total_jitter_ns, &result.iterations) == 3) {
-                double avg_jitter = (result.iterations > 0) ?
-                                    (double)result.total_jitter_ns / result.iterations : 0.0;
-                printf("Sleep Process %d: %ld iterations, Average Jitter: %.2f ns\n",
-                       result.proc_id, result.iterations, avg_jitter);
+            sleep_proc_data_t r;
+            if (sscanf(buf, "%d %ld %lf %lf %lf %lf %lf %lf %ld %ld %lf %lf",
+                       &r.proc_id, &r.iterations, &r.min_us, &r.p50_us, &r.p99_us,
+                       &r.p999_us, &r.max_us, &r.mean_us, &r.early, &r.missed_periods,
+                       &r.cpu_us_per_wakeup, &r.margin_us) == 12) {
+                printf("%-7d %8ld %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %7ld %7ld %10.1f %9.1f\n",
+                       r.proc_id, r.iterations, r.min_us, r.p50_us, r.p99_us, r.p999_us,
+                       r.max_us, r.mean_us, r.early, r.missed_periods,
+                       r.cpu_us_per_wakeup, r.margin_us);
             } else {
                 fprintf(stderr, "Error parsing result from process %d: %s\n", i, buf);
             }
@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#ifdef __linux__
+  #include <sys/syscall.h>
+  #include <linux/futex.h>
+#endif
+
+#define DEFAULT_WAITERS  "1,4,16,64"
+#define DEFAULT_ROUNDS   200
+#define SETTLE_NS        1000000L   // let the last waiter actually block
+#define WAITER_PRIORITY  50
+#define WAKER_PRIORITY   60
+
+enum primitive { PRIM_CONDVAR, PRIM_FUTEX, PRIM_SEM, NUM_PRIMS };
+enum mode { MODE_NORMAL, MODE_RT, NUM_MODES };
+
+static const char *prim_names[NUM_PRIMS] = { "condvar", "futex", "sem" };
+static const char *mode_names[NUM_MODES] = { "normal", "rt" };
+
+static enum primitive prim;
+static int num_waiters;
+
+static pthread_mutex_t cv_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+static sem_t sem;
+static int futex_word;
+
+static volatile unsigned int generation;
+static volatile int ready;
+static volatile int quit;
+static volatile long long broadcast_ns;
+static long long *wake_ns;          // per-waiter delay for the current round
+static pthread_barrier_t round_done;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int prim_supported(enum primitive p) {
+#ifdef __linux__
+    (void)p;
+    return 1;
+#else
+    return p != PRIM_FUTEX;
+#endif
+}
+
+// Blocks until the waker starts round `gen`
+static void wait_for_broadcast(unsigned int gen) {
+    switch (prim) {
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&cv_mutex);
+        __atomic_add_fetch(&ready, 1, __ATOMIC_RELEASE);
+        while (generation == gen)
+            pthread_cond_wait(&cv, &cv_mutex);
+        pthread_mutex_unlock(&cv_mutex);
+        break;
+    case PRIM_FUTEX:
+#ifdef __linux__
+        __atomic_add_fetch(&ready, 1, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&futex_word, __ATOMIC_ACQUIRE) == (int)gen)
+            syscall(SYS_futex, &futex_word, FUTEX_WAIT_PRIVATE, (int)gen, NULL, NULL, 0);
+#endif
+        break;
+    case PRIM_SEM:
+        __atomic_add_fetch(&ready, 1, __ATOMIC_RELEASE);
+        while (sem_wait(&sem) != 0 && errno == EINTR)
+            ;
+        break;
+    default:
+        break;
+    }
+}
+
+static void broadcast(void) {
+    switch (prim) {
+    case PRIM_CONDVAR:
+        pthread_mutex_lock(&cv_mutex);
+        broadcast_ns = now_ns();
+        generation++;
+        pthread_cond_broadcast(&cv);
+        pthread_mutex_unlock(&cv_mutex);
+        break;
+    case PRIM_FUTEX:
+#ifdef __linux__
+        broadcast_ns = now_ns();
+        generation++;
+        __atomic_store_n(&futex_word, (int)generation, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &futex_word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+        break;
+    case PRIM_SEM:
+        // No broadcast for semaphores: one post per waiter is how it is done
+        broadcast_ns = now_ns();
+        generation++;
+        for (int i = 0; i < num_waiters; i++)
+            sem_post(&sem);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* waiter_function(void *arg) {
+    int id = (int)(intptr_t)arg;
+    for (;;) {
+        unsigned int gen = generation;
+        wait_for_broadcast(gen);
+        if (quit) break;
+        wake_ns[id] = now_ns() - broadcast_ns;
+        pthread_barrier_wait(&round_done);
+    }
+    return NULL;
+}
+
+static int set_fifo(pthread_attr_t *attr, int prio) {
+    struct sched_param sp = { .sched_priority = prio };
+    pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(attr, SCHED_FIFO);
+    return pthread_attr_setschedparam(attr, &sp);
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void wait_until_all_blocked(void) {
+    struct timespec poll = { 0, 100000 };
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < num_waiters)
+        nanosleep(&poll, NULL);
+    struct timespec settle = { 0, SETTLE_NS };
+    nanosleep(&settle, NULL);
+}
+
+static void run_config(enum primitive p, enum mode mode, int waiters, int rounds) {
+    prim = p;
+    num_waiters = waiters;
+    generation = 0;
+    futex_word = 0;
+    ready = 0;
+    quit = 0;
+    sem_init(&sem, 0, 0);
+    pthread_barrier_init(&round_done, NULL, waiters + 1);
+
+    wake_ns = calloc(waiters, sizeof(long long));
+    long long *first = malloc(rounds * sizeof(long long));
+    long long *median = malloc(rounds * sizeof(long long));
+    long long *last = malloc(rounds * sizeof(long long));
+    pthread_t *tids = malloc(waiters * sizeof(pthread_t));
+    if (!wake_ns || !first || !median || !last || !tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // The waker outranks the waiters in RT mode so every wakeup is issued
+    // before any waiter gets the CPU back; we measure the wake path, not
+    // the waker being preempted halfway through its broadcast.
+    struct sched_param old_param;
+    int old_policy;
+    pthread_getschedparam(pthread_self(), &old_policy, &old_param);
+    if (mode == MODE_RT) {
+        struct sched_param sp = { .sched_priority = WAKER_PRIORITY };
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (rc != 0) {
+            printf("%-8s %-6s %7d skipped: SCHED_FIFO unavailable (%s)\n",
+                   prim_names[p], mode_names[mode], waiters, strerror(rc));
+            goto out;
+        }
+    }
+
+    int created = 0;
+    for (int i = 0; i < waiters; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (mode == MODE_RT)
+            set_fifo(&attr, WAITER_PRIORITY);
+        int rc = pthread_create(&tids[i], &attr, waiter_function, (void *)(intptr_t)i);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(rc));
+            exit(EXIT_FAILURE);
+        }
+        created++;
+    }
+
+    for (int r = 0; r < rounds; r++) {
+        wait_until_all_blocked();
+        ready = 0;
+        broadcast();
+        pthread_barrier_wait(&round_done);
+
+        qsort(wake_ns, waiters, sizeof(long long), cmp_ll);
+        first[r] = wake_ns[0];
+        median[r] = wake_ns[waiters / 2];
+        last[r] = wake_ns[waiters - 1];
+    }
+
+    // Release the waiters one final time so they can exit
+    wait_until_all_blocked();
+    quit = 1;
+    broadcast();
+    for (int i = 0; i < created; i++)
+        pthread_join(tids[i], NULL);
+
+    qsort(first, rounds, sizeof(long long), cmp_ll);
+    qsort(median, rounds, sizeof(long long), cmp_ll);
+    qsort(last, rounds, sizeof(long long), cmp_ll);
+    printf("%-8s %-6s %7d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+           prim_names[p], mode_names[mode], waiters,
+           first[rounds / 2] / 1e3, first[(int)(rounds * 0.99)] / 1e3,
+           median[rounds / 2] / 1e3, median[(int)(rounds * 0.99)] / 1e3,
+           last[rounds / 2] / 1e3, last[(int)(rounds * 0.99)] / 1e3,
+           last[rounds - 1] / 1e3);
+    fflush(stdout);
+
+out:
+    pthread_setschedparam(pthread_self(), old_policy, &old_param);
+    pthread_barrier_destroy(&round_done);
+    sem_destroy(&sem);
+    free(tids);
+    free(last);
+    free(median);
+    free(first);
+    free(wake_ns);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [condvar|futex|sem|all] [waiters_list=%s] [rounds=%d] [normal|rt|all]\n",
+            prog, DEFAULT_WAITERS, DEFAULT_ROUNDS);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int only_prim = -1, only_sched = -1;
+    if (argc > 1 && strcmp(argv[1], "all") != 0) {
+        for (int i = 0; i < NUM_PRIMS; i++)
+            if (strcmp(argv[1], prim_names[i]) == 0) only_prim = i;
+        if (only_prim < 0) usage(argv[0]);
+    }
+    const char *waiter_list = argc > 2 ? argv[2] : DEFAULT_WAITERS;
+    int rounds = argc > 3 ? atoi(argv[3]) : DEFAULT_ROUNDS;
+    if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+    if (argc > 4 && strcmp(argv[4], "all") != 0) {
+        for (int i = 0; i < NUM_MODES; i++)
+            if (strcmp(argv[4], mode_names[i]) == 0) only_sched = i;
+        if (only_sched < 0) usage(argv[0]);
+    }
+
+    printf("Broadcast wake latency (%d rounds; us from broadcast to waiter running, p50/p99 over rounds)\n",
+           rounds);
+    printf("%-8s %-6s %7s %9s %9s %9s %9s %9s %9s %9s\n", "prim", "sched", "waiters",
+           "first50", "first99", "median50", "median99", "last50", "last99", "lastmax");
+
+    for (int p = 0; p < NUM_PRIMS; p++) {
+        if (only_prim >= 0 && p != only_prim) continue;
+        if (!prim_supported((enum primitive)p)) {
+            printf("%-8s unsupported on this platform\n", prim_names[p]);
+            continue;
+        }
+        for (int m = 0; m < NUM_MODES; m++) {
+            if (only_sched >= 0 && m != only_sched) continue;
+            for (const char *w = waiter_list; *w; ) {
+                int waiters = atoi(w);
+                if (waiters > 0)
+                    run_config((enum primitive)p, (enum mode)m, waiters, rounds);
+                w = strchr(w, ',');
+                if (!w) break;
+                w++;
+            }
+        }
+    }
+    return 0;
+}
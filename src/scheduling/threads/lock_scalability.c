@@ -0,0 +1,463 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define CACHE_LINE_SIZE     64
+#define DEFAULT_CS_NS       100
+#define DEFAULT_NONCS_NS    200
+#define DEFAULT_DURATION_MS 1000
+#define DEFAULT_READ_PCTS   "0,50,90,99"
+#define MAX_THREADS         256
+
+// Acquire latency histogram: exact below 64 ns, then 16 sub-buckets per
+// power of two, which keeps ~6% resolution up to the longest stalls.
+#define HIST_LINEAR  64
+#define HIST_SUB     16
+#define HIST_BUCKETS (HIST_LINEAR + 58 * HIST_SUB)
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+  #define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+  #define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+enum lock_kind {
+    LOCK_MUTEX_NORMAL, LOCK_MUTEX_ADAPTIVE, LOCK_MUTEX_PI, LOCK_SPIN,
+    LOCK_RWLOCK, LOCK_TICKET, LOCK_MCS, NUM_LOCKS
+};
+
+static const char *lock_names[NUM_LOCKS] = {
+    "mutex", "mutex_adaptive", "mutex_pi", "spinlock", "rwlock", "ticket", "mcs"
+};
+
+typedef struct {
+    volatile unsigned int next __attribute__((aligned(CACHE_LINE_SIZE)));
+    volatile unsigned int serving __attribute__((aligned(CACHE_LINE_SIZE)));
+} ticket_lock_t;
+
+typedef struct mcs_node {
+    struct mcs_node *volatile next;
+    volatile int locked;
+} __attribute__((aligned(CACHE_LINE_SIZE))) mcs_node_t;
+
+typedef struct {
+    mcs_node_t *volatile tail;
+} mcs_lock_t;
+
+typedef struct {
+    int id;
+    int cpu;
+    int read_pct;
+    unsigned int rng;
+    mcs_node_t node;
+    unsigned long ops;
+    unsigned long hist[HIST_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_t;
+
+static enum lock_kind kind;
+static pthread_mutex_t mutex;
+static pthread_spinlock_t spin;
+static pthread_rwlock_t rwlock;
+static ticket_lock_t ticket;
+static mcs_lock_t mcs;
+
+// Data guarded by the lock, touched in every critical section so the cache
+// line really moves between owners.
+static volatile unsigned long shared_data[CACHE_LINE_SIZE / sizeof(unsigned long)]
+    __attribute__((aligned(CACHE_LINE_SIZE)));
+
+static volatile int stop;
+static pthread_barrier_t start_barrier;
+static unsigned long cs_loops, noncs_loops;
+static double loops_per_ns;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static inline void spin_work(unsigned long loops) {
+    for (volatile unsigned long i = 0; i < loops; i++)
+        ;
+}
+
+static void calibrate_work(void) {
+    unsigned long loops = 1000000;
+    long long t0 = now_ns();
+    spin_work(loops);
+    long long dt = now_ns() - t0;
+    loops_per_ns = dt > 0 ? (double)loops / dt : 1.0;
+}
+
+static inline int hist_bucket(unsigned long long v) {
+    if (v < HIST_LINEAR) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int idx = HIST_LINEAR + (msb - 6) * HIST_SUB + (int)((v >> (msb - 4)) & (HIST_SUB - 1));
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+static inline unsigned long long hist_value(int idx) {
+    if (idx < HIST_LINEAR) return idx;
+    int msb = (idx - HIST_LINEAR) / HIST_SUB + 6;
+    unsigned long long sub = (idx - HIST_LINEAR) % HIST_SUB;
+    return (1ULL << msb) | (sub << (msb - 4));
+}
+
+static inline void ticket_acquire(ticket_lock_t *l) {
+    unsigned int me = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&l->serving, __ATOMIC_ACQUIRE) != me)
+        cpu_relax();
+}
+
+static inline void ticket_release(ticket_lock_t *l) {
+    __atomic_store_n(&l->serving, l->serving + 1, __ATOMIC_RELEASE);
+}
+
+// Each waiter spins on its own node, so a release touches exactly one
+// remote cache line instead of invalidating every spinner.
+static inline void mcs_acquire(mcs_lock_t *l, mcs_node_t *me) {
+    me->next = NULL;
+    me->locked = 1;
+    mcs_node_t *prev = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    if (!prev) return;
+    __atomic_store_n(&prev->next, me, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&me->locked, __ATOMIC_ACQUIRE))
+        cpu_relax();
+}
+
+static inline void mcs_release(mcs_lock_t *l, mcs_node_t *me) {
+    mcs_node_t *succ = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    if (!succ) {
+        mcs_node_t *expected = me;
+        if (__atomic_compare_exchange_n(&l->tail, &expected, NULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+        // A successor swapped itself in but has not linked yet
+        while (!(succ = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE)))
+            cpu_relax();
+    }
+    __atomic_store_n(&succ->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline void lock_acquire(worker_t *w, int reader) {
+    switch (kind) {
+    case LOCK_MUTEX_NORMAL:
+    case LOCK_MUTEX_ADAPTIVE:
+    case LOCK_MUTEX_PI:
+        pthread_mutex_lock(&mutex);
+        break;
+    case LOCK_SPIN:
+        pthread_spin_lock(&spin);
+        break;
+    case LOCK_RWLOCK:
+        if (reader) pthread_rwlock_rdlock(&rwlock);
+        else pthread_rwlock_wrlock(&rwlock);
+        break;
+    case LOCK_TICKET:
+        ticket_acquire(&ticket);
+        break;
+    case LOCK_MCS:
+        mcs_acquire(&mcs, &w->node);
+        break;
+    default:
+        break;
+    }
+}
+
+static inline void lock_release(worker_t *w) {
+    switch (kind) {
+    case LOCK_MUTEX_NORMAL:
+    case LOCK_MUTEX_ADAPTIVE:
+    case LOCK_MUTEX_PI:
+        pthread_mutex_unlock(&mutex);
+        break;
+    case LOCK_SPIN:
+        pthread_spin_unlock(&spin);
+        break;
+    case LOCK_RWLOCK:
+        pthread_rwlock_unlock(&rwlock);
+        break;
+    case LOCK_TICKET:
+        ticket_release(&ticket);
+        break;
+    case LOCK_MCS:
+        mcs_release(&mcs, &w->node);
+        break;
+    default:
+        break;
+    }
+}
+
+// Returns 0 if the lock could be set up on this platform
+static int lock_init(enum lock_kind k) {
+    pthread_mutexattr_t attr;
+    kind = k;
+    switch (k) {
+    case LOCK_MUTEX_NORMAL:
+    case LOCK_MUTEX_ADAPTIVE:
+    case LOCK_MUTEX_PI: {
+        pthread_mutexattr_init(&attr);
+        int rc = 0;
+        if (k == LOCK_MUTEX_NORMAL) {
+            rc = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+        } else if (k == LOCK_MUTEX_ADAPTIVE) {
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+            rc = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+#else
+            rc = ENOTSUP;
+#endif
+        } else {
+            rc = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+        }
+        if (rc == 0)
+            rc = pthread_mutex_init(&mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        return rc;
+    }
+    case LOCK_SPIN:
+        return pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+    case LOCK_RWLOCK:
+        return pthread_rwlock_init(&rwlock, NULL);
+    case LOCK_TICKET:
+        ticket.next = ticket.serving = 0;
+        return 0;
+    case LOCK_MCS:
+        mcs.tail = NULL;
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+
+static void lock_destroy(void) {
+    switch (kind) {
+    case LOCK_MUTEX_NORMAL:
+    case LOCK_MUTEX_ADAPTIVE:
+    case LOCK_MUTEX_PI:
+        pthread_mutex_destroy(&mutex);
+        break;
+    case LOCK_SPIN:
+        pthread_spin_destroy(&spin);
+        break;
+    case LOCK_RWLOCK:
+        pthread_rwlock_destroy(&rwlock);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* worker_function(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    if (pin_self(w->cpu) != 0)
+        fprintf(stderr, "warning: could not pin worker %d to CPU %d\n", w->id, w->cpu);
+    pthread_barrier_wait(&start_barrier);
+
+    while (!stop) {
+        int reader = 0;
+        if (w->read_pct > 0) {
+            w->rng ^= w->rng << 13;
+            w->rng ^= w->rng >> 17;
+            w->rng ^= w->rng << 5;
+            reader = (int)(w->rng % 100) < w->read_pct;
+        }
+
+        long long t0 = now_ns();
+        lock_acquire(w, reader);
+        long long t1 = now_ns();
+
+        if (reader) {
+            (void)shared_data[0];
+        } else {
+            shared_data[0]++;
+        }
+        spin_work(cs_loops);
+        lock_release(w);
+
+        w->hist[hist_bucket((unsigned long long)(t1 - t0))]++;
+        w->ops++;
+        spin_work(noncs_loops);
+    }
+    return NULL;
+}
+
+static unsigned long long percentile(const unsigned long *hist, unsigned long total, double p) {
+    unsigned long target = (unsigned long)(total * p), seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > target) return hist_value(i);
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+static void run_config(enum lock_kind k, int nthreads, int read_pct, int ncpus, int duration_ms) {
+    char label[32];
+    if (k == LOCK_RWLOCK)
+        snprintf(label, sizeof(label), "rwlock_r%d", read_pct);
+    else
+        snprintf(label, sizeof(label), "%s", lock_names[k]);
+
+    int rc = lock_init(k);
+    if (rc != 0) {
+        printf("%-16s %7d unsupported: %s\n", label, nthreads, strerror(rc));
+        return;
+    }
+
+    worker_t *workers;
+    if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, nthreads * sizeof(worker_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    memset(workers, 0, nthreads * sizeof(worker_t));
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    stop = 0;
+    pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].id = i;
+        workers[i].cpu = i % ncpus;
+        workers[i].read_pct = k == LOCK_RWLOCK ? read_pct : 0;
+        workers[i].rng = 0x9e3779b9u * (i + 1);
+        if (pthread_create(&tids[i], NULL, worker_function, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    long long start = now_ns();
+    struct timespec ts = { duration_ms / 1000, (duration_ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+    stop = 1;
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    long long elapsed = now_ns() - start;
+    pthread_barrier_destroy(&start_barrier);
+    lock_destroy();
+
+    // Merge histograms; fairness is Jain's index over per-thread acquisitions
+    static unsigned long merged[HIST_BUCKETS];
+    memset(merged, 0, sizeof(merged));
+    unsigned long total = 0, min_ops = (unsigned long)-1, max_ops = 0;
+    double sum = 0, sum_sq = 0;
+    for (int i = 0; i < nthreads; i++) {
+        for (int b = 0; b < HIST_BUCKETS; b++) merged[b] += workers[i].hist[b];
+        unsigned long ops = workers[i].ops;
+        total += ops;
+        sum += ops;
+        sum_sq += (double)ops * ops;
+        if (ops < min_ops) min_ops = ops;
+        if (ops > max_ops) max_ops = ops;
+    }
+
+    if (total == 0) {
+        printf("%-16s %7d no acquisitions completed\n", label, nthreads);
+    } else {
+        double jain = sum_sq > 0 ? (sum * sum) / (nthreads * sum_sq) : 1.0;
+        printf("%-16s %7d %10.3f %8llu %8llu %9llu %10llu %6.3f %8.3f\n",
+               label, nthreads, total * 1e3 / elapsed,
+               percentile(merged, total, 0.50), percentile(merged, total, 0.99),
+               percentile(merged, total, 0.999), percentile(merged, total, 0.99999),
+               jain, max_ops ? (double)min_ops / max_ops : 0.0);
+    }
+    fflush(stdout);
+
+    free(tids);
+    free(workers);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [lock|all] [max_threads=ncpus] [cs_ns=%d] [noncs_ns=%d] "
+            "[duration_ms=%d] [read_pct_list=%s]\n",
+            prog, DEFAULT_CS_NS, DEFAULT_NONCS_NS, DEFAULT_DURATION_MS, DEFAULT_READ_PCTS);
+    fprintf(stderr, "  locks:");
+    for (int i = 0; i < NUM_LOCKS; i++) fprintf(stderr, " %s", lock_names[i]);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int only = -1;
+    if (argc > 1 && strcmp(argv[1], "all") != 0) {
+        for (int i = 0; i < NUM_LOCKS; i++)
+            if (strcmp(argv[1], lock_names[i]) == 0) only = i;
+        if (only < 0) usage(argv[0]);
+    }
+
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    int max_threads = ncpus;
+    if (argc > 2) {
+        max_threads = atoi(argv[2]);
+        if (max_threads <= 0) max_threads = ncpus;
+        if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    }
+    long cs_ns = argc > 3 ? atol(argv[3]) : DEFAULT_CS_NS;
+    long noncs_ns = argc > 4 ? atol(argv[4]) : DEFAULT_NONCS_NS;
+    int duration_ms = argc > 5 ? atoi(argv[5]) : DEFAULT_DURATION_MS;
+    const char *read_pcts = argc > 6 ? argv[6] : DEFAULT_READ_PCTS;
+    if (cs_ns < 0) cs_ns = 0;
+    if (noncs_ns < 0) noncs_ns = 0;
+    if (duration_ms <= 0) duration_ms = DEFAULT_DURATION_MS;
+
+    calibrate_work();
+    cs_loops = (unsigned long)(cs_ns * loops_per_ns);
+    noncs_loops = (unsigned long)(noncs_ns * loops_per_ns);
+
+    printf("Lock scalability (%d CPUs, cs=%ld ns, non-cs=%ld ns, %d ms per run)\n",
+           ncpus, cs_ns, noncs_ns, duration_ms);
+    printf("Acquire latency in ns; fairness is Jain's index and min/max per-thread acquisitions\n");
+    printf("%-16s %7s %10s %8s %8s %9s %10s %6s %8s\n",
+           "lock", "threads", "Macq/s", "p50", "p99", "p99.9", "p99.999", "jain", "min/max");
+
+    for (int k = 0; k < NUM_LOCKS; k++) {
+        if (only >= 0 && k != only) continue;
+        for (const char *p = read_pcts; ; ) {
+            int read_pct = k == LOCK_RWLOCK ? atoi(p) : 0;
+            if (read_pct < 0) read_pct = 0;
+            if (read_pct > 100) read_pct = 100;
+
+            // Powers of two up to max_threads, always ending on max_threads
+            for (int t = 1; ; t *= 2) {
+                if (t > max_threads) t = max_threads;
+                run_config(k, t, read_pct, ncpus, duration_ms);
+                if (t == max_threads) break;
+            }
+
+            if (k != LOCK_RWLOCK) break;
+            p = strchr(p, ',');
+            if (!p) break;
+            p++;
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <pthread.h>
 #include <unistd.h>
@@ -11,40 +12,99 @@
 #define DEFAULT_NUM_LOAD_THREADS 2
 #define SLEEP_INTERVAL_NS 10000000L  // 10 milliseconds in nanoseconds
 #define TEST_DURATION 5             // Run test for 5 seconds
+#define NSEC_PER_SEC 1000000000LL
+#define INITIAL_MARGIN_NS 200000L    // hybrid mode: first guess at sleep overshoot
+#define MIN_MARGIN_NS 5000L
+
+enum wake_mode { MODE_SLEEP, MODE_HYBRID };
 
 // Global flag to signal threads to stop
 volatile int stop = 0;
 
+static enum wake_mode wake_mode = MODE_SLEEP;
+static long interval_ns = SLEEP_INTERVAL_NS;
+
 // Data structure for sleep measurement threads
 typedef struct {
     int thread_id;
-    long total_jitter_ns;
     long iterations;
+    long max_samples;
+    long long *lateness_ns;     // wake time - deadline; negative means early
+    long missed_periods;
+    long long cpu_ns;           // CPU consumed by the thread over the run
+    long margin_ns;             // hybrid mode: final auto-tuned margin
 } sleep_thread_data_t;
 
-// Thread function for measuring sleep/wake precision
+static inline long long ts_ns(const struct timespec *t) {
+    return (long long)t->tv_sec * NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec ns_ts(long long ns) {
+    struct timespec t = { .tv_sec = ns / NSEC_PER_SEC, .tv_nsec = ns % NSEC_PER_SEC };
+    return t;
+}
+
+static inline long long clock_ns(clockid_t clk) {
+    struct timespec t;
+    clock_gettime(clk, &t);
+    return ts_ns(&t);
+}
+
+// Sleeps until deadline - margin, then spins to the deadline. The margin
+// grows straight to any overshoot that made us late and decays slowly
+// otherwise, so it settles just above the kernel's typical sleep overshoot.
+// It is capped at a quarter of the period so a preemption burst cannot turn
+// the wait into a pure spin.
+static long long hybrid_wait(long long deadline, long *margin) {
+    long long wake_target = deadline - *margin;
+    struct timespec ts = ns_ts(wake_target);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+    long long woke = clock_ns(CLOCK_MONOTONIC);
+    long long overshoot = woke - wake_target;
+    if (overshoot >= *margin)
+        *margin = overshoot + overshoot / 8;
+    else
+        *margin -= (*margin - overshoot) / 64;
+    if (*margin > interval_ns / 4) *margin = interval_ns / 4;
+    if (*margin < MIN_MARGIN_NS) *margin = MIN_MARGIN_NS;
+
+    long long now = woke;
+    while (now < deadline)
+        now = clock_ns(CLOCK_MONOTONIC);
+    return now;
+}
+
+// Thread function for measuring sleep/wake precision against absolute deadlines
 void* sleep_thread_function(void* arg) {
     sleep_thread_data_t *data = (sleep_thread_data_t *)arg;
-    struct timespec start, end;
-    struct timespec req = { .tv_sec = 0, .tv_nsec = SLEEP_INTERVAL_NS };
-    while (!stop) {
-        // Record start time
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        // Sleep for the requested interval
-        nanosleep(&req, NULL);
-        // Record end time
-        clock_gettime(CLOCK_MONOTONIC, &end);
-
-        // Calculate elapsed time in nanoseconds
-        long elapsed_ns = (end.tv_sec - start.tv_sec) * 1000000000L +
-                          (end.tv_nsec - start.tv_nsec);
-        // Jitter: the extra time beyond the requested sleep duration
-        long jitter = elapsed_ns - SLEEP_INTERVAL_NS;
-        if (jitter < 0) jitter = 0; // Only consider delays
-
-        data->total_jitter_ns += jitter;
-        data->iterations++;
+    long margin = INITIAL_MARGIN_NS;
+    long long cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    long long deadline = clock_ns(CLOCK_MONOTONIC);
+
+    while (!stop && data->iterations < data->max_samples) {
+        deadline += interval_ns;
+
+        long long woke;
+        if (wake_mode == MODE_HYBRID) {
+            woke = hybrid_wait(deadline, &margin);
+        } else {
+            struct timespec ts = ns_ts(deadline);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            woke = clock_ns(CLOCK_MONOTONIC);
+        }
+
+        data->lateness_ns[data->iterations++] = woke - deadline;
+
+        // Fixed schedule: periods we overslept entirely are skipped, not queued up
+        while (woke - deadline >= interval_ns) {
+            deadline += interval_ns;
+            data->missed_periods++;
+        }
     }
+
+    data->cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    data->margin_ns = margin;
     pthread_exit(NULL);
 }
 
@@ -58,6 +118,11 @@ void* load_thread_function(void* arg) {
     pthread_exit(NULL);
 }
 
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
 int main(int argc, char *argv[]) {
 #ifdef __linux__
     // use only 1 cpu
@@ -74,7 +139,7 @@ int main(int argc, char *argv[]) {
     // Set both soft and hard limits to 512 MB.
     mem_limit.rlim_cur = 512UL * 1024 * 1024;
     mem_limit.rlim_max = 512UL * 1024 * 1024;
-    
+
     if (setrlimit(RLIMIT_AS, &mem_limit) != 0) {
         perror("setrlimit");
         exit(EXIT_FAILURE);
@@ -84,7 +149,7 @@ int main(int argc, char *argv[]) {
     int num_sleep_threads = DEFAULT_NUM_SLEEP_THREADS;
     int num_load_threads = DEFAULT_NUM_LOAD_THREADS;
 
-    // Optional command line parameters: number of sleep threads, load threads
+    // Optional command line parameters: sleep threads, load threads, mode, interval
     if (argc > 1) {
         num_sleep_threads = atoi(argv[1]);
         if (num_sleep_threads <= 0) num_sleep_threads = DEFAULT_NUM_SLEEP_THREADS;
@@ -93,9 +158,21 @@ int main(int argc, char *argv[]) {
         num_load_threads = atoi(argv[2]);
         if (num_load_threads < 0) num_load_threads = DEFAULT_NUM_LOAD_THREADS;
     }
+    if (argc > 3) {
+        if (strcmp(argv[3], "hybrid") == 0) {
+            wake_mode = MODE_HYBRID;
+        } else if (strcmp(argv[3], "sleep") != 0) {
+            fprintf(stderr, "Usage: %s [sleep_threads] [load_threads] [sleep|hybrid] [interval_us]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (argc > 4) {
+        long us = atol(argv[4]);
+        if (us > 0) interval_ns = us * 1000L;
+    }
 
     pthread_t *sleep_threads = malloc(num_sleep_threads * sizeof(pthread_t));
-    sleep_thread_data_t *sleep_data = malloc(num_sleep_threads * sizeof(sleep_thread_data_t));
+    sleep_thread_data_t *sleep_data = calloc(num_sleep_threads, sizeof(sleep_thread_data_t));
     pthread_t *load_threads = malloc(num_load_threads * sizeof(pthread_t));
 
     if (!sleep_threads || !sleep_data || !load_threads) {
@@ -104,10 +181,15 @@ int main(int argc, char *argv[]) {
     }
 
     // Create sleep measurement threads
+    long max_samples = (long)(TEST_DURATION * NSEC_PER_SEC / interval_ns) + 16;
     for (int i = 0; i < num_sleep_threads; i++) {
         sleep_data[i].thread_id = i;
-        sleep_data[i].total_jitter_ns = 0;
-        sleep_data[i].iterations = 0;
+        sleep_data[i].max_samples = max_samples;
+        sleep_data[i].lateness_ns = malloc(max_samples * sizeof(long long));
+        if (!sleep_data[i].lateness_ns) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
         if (pthread_create(&sleep_threads[i], NULL, sleep_thread_function, &sleep_data[i]) != 0) {
             perror("pthread_create (sleep thread)");
             exit(EXIT_FAILURE);
@@ -136,14 +218,31 @@ int main(int argc, char *argv[]) {
         pthread_join(load_threads[i], NULL);
     }
 
-    // Report the results: average jitter per sleep thread
-    printf("Sleep/Wake Precision Test Results (over %d seconds):\n", TEST_DURATION);
+    // Report the lateness distribution (negative = early) and CPU cost per wakeup
+    printf("Sleep/Wake Precision Test Results (over %d seconds, %s mode, %ld us interval):\n",
+           TEST_DURATION, wake_mode == MODE_HYBRID ? "hybrid spin-sleep" : "absolute sleep",
+           interval_ns / 1000);
+    printf("%-7s %8s %9s %9s %9s %9s %9s %9s %7s %7s %10s %9s\n",
+           "thread", "wakeups", "min_us", "p50_us", "p99_us", "p99.9_us", "max_us", "mean_us",
+           "early", "missed", "cpu_us/wk", "margin_us");
     for (int i = 0; i < num_sleep_threads; i++) {
-        if (sleep_data[i].iterations > 0) {
-            double avg_jitter = (double)sleep_data[i].total_jitter_ns / sleep_data[i].iterations;
-            printf("Sleep Thread %d: %ld iterations, Average Jitter: %.2f ns\n",
-                   sleep_data[i].thread_id, sleep_data[i].iterations, avg_jitter);
+        sleep_thread_data_t *d = &sleep_data[i];
+        long n = d->iterations;
+        if (n == 0) continue;
+        long long sum = 0;
+        long early = 0;
+        for (long k = 0; k < n; k++) {
+            sum += d->lateness_ns[k];
+            if (d->lateness_ns[k] < 0) early++;
         }
+        qsort(d->lateness_ns, n, sizeof(long long), cmp_ll);
+        printf("%-7d %8ld %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %7ld %7ld %10.1f %9.1f\n",
+               d->thread_id, n, d->lateness_ns[0] / 1e3, d->lateness_ns[n / 2] / 1e3,
+               d->lateness_ns[(long)(n * 0.99)] / 1e3, d->lateness_ns[(long)(n * 0.999)] / 1e3,
+               d->lateness_ns[n - 1] / 1e3, (double)sum / n / 1e3, early, d->missed_periods,
+               (double)d->cpu_ns / n / 1e3,
+               wake_mode == MODE_HYBRID ? d->margin_ns / 1e3 : 0.0);
+        free(d->lateness_ns);
     }
 
     free(sleep_threads);
@@ -0,0 +1,363 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define DEFAULT_DURATION_MS 2000
+#define MAX_CPUS            1024
+#define PROBE_LINES         512                 // 32 KB pointer chase, L1/L2 resident
+#define PROBE_STEPS         2048                // chase steps per timed unit
+#define MEM_KERNEL_BYTES    (64UL << 20)        // well past any LLC
+#define MAX_SAMPLES         (1 << 22)
+
+enum kernel { K_IDLE, K_INT, K_FP, K_MEM, NUM_KERNELS };
+static const char *kernel_names[NUM_KERNELS] = { "idle", "int", "fp", "mem" };
+
+typedef struct {
+    void *next;
+    char pad[64 - sizeof(void *)];
+} line_t;
+
+typedef double v4d __attribute__((vector_size(32)));
+
+typedef struct {
+    int probe_cpu;
+    int sibling_cpu;     // shares the core with probe_cpu
+    int other_cpu;       // a different core, -1 if there is none
+} cpu_pair_t;
+
+static volatile int stop_interferer;
+static enum kernel interferer_kernel;
+static char *mem_buf;
+static line_t *probe_lines;
+static void * volatile sink;
+static volatile double fp_sink;
+static volatile uint64_t int_sink;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+// Parses a sysfs CPU list ("0,4" or "0-1") into cpus[]; returns the count
+static int parse_list(const char *s, int *cpus, int max) {
+    int n = 0;
+    while (*s && n < max) {
+        char *end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s) break;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi && n < max; c++) cpus[n++] = (int)c;
+        s = *end == ',' ? end + 1 : end;
+        if (*s == '\n') break;
+    }
+    return n;
+}
+
+static int read_siblings(int cpu, int *sib, int max) {
+    char path[128], buf[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int n = 0;
+    if (fgets(buf, sizeof(buf), f)) n = parse_list(buf, sib, max);
+    fclose(f);
+    return n;
+}
+
+// One pair per physical core: its first two hardware threads, plus a CPU on
+// some other core as a control for shared-cache (not SMT) effects
+static int discover_pairs(cpu_pair_t *pairs, int max) {
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int seen[MAX_CPUS] = { 0 };
+    int n = 0;
+    for (int c = 0; c < ncpus && c < MAX_CPUS && n < max; c++) {
+        if (seen[c]) continue;
+        int sib[16];
+        int ns = read_siblings(c, sib, 16);
+        for (int i = 0; i < ns; i++)
+            if (sib[i] < MAX_CPUS) seen[sib[i]] = 1;
+        if (ns < 2) continue;
+        pairs[n].probe_cpu = sib[0];
+        pairs[n].sibling_cpu = sib[1];
+        pairs[n].other_cpu = -1;
+        for (int o = 0; o < ncpus; o++) {
+            int same_core = 0;
+            for (int i = 0; i < ns; i++)
+                if (sib[i] == o) same_core = 1;
+            if (!same_core) {
+                pairs[n].other_cpu = o;
+                break;
+            }
+        }
+        n++;
+    }
+    return n;
+}
+
+static void build_probe(void) {
+    if (posix_memalign((void **)&probe_lines, 64, PROBE_LINES * sizeof(line_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    int order[PROBE_LINES];
+    for (int i = 0; i < PROBE_LINES; i++) order[i] = i;
+    unsigned int seed = 7;
+    for (int i = PROBE_LINES - 1; i > 0; i--) {
+        int j = rand_r(&seed) % (i + 1);
+        int t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for (int i = 0; i < PROBE_LINES; i++)
+        probe_lines[order[i]].next = &probe_lines[order[(i + 1) % PROBE_LINES]];
+}
+
+// One latency-sensitive unit of work: a dependent pointer chase interleaved
+// with integer arithmetic, so it needs both the load pipeline and the ALUs.
+static inline void probe_unit(void) {
+    void *p = sink ? sink : &probe_lines[0];
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < PROBE_STEPS; i++) {
+        p = *(void **)p;
+        h = (h ^ (uintptr_t)p) * 0xff51afd7ed558ccdULL;
+    }
+    sink = p;
+    int_sink = h;
+}
+
+static void kernel_int(void) {
+    uint64_t a = 1, b = 2, c = 3, d = 4;
+    while (!stop_interferer) {
+        for (int i = 0; i < 4096; i++) {
+            a = a * 6364136223846793005ULL + 1442695040888963407ULL;
+            b ^= b << 13; b ^= b >> 7; b ^= b << 17;
+            c = (c + a) * 0x9e3779b97f4a7c15ULL;
+            d += __builtin_popcountll(b ^ c);
+        }
+    }
+    int_sink = a + b + c + d;
+}
+
+// Four independent multiply-add chains on 256-bit vectors. Built plainly
+// this is SSE2 (two 128-bit halves, separate mul and add); the AVX2 clone
+// below turns each line into one 256-bit FMA.
+static inline __attribute__((always_inline)) void kernel_fp_body(void) {
+    v4d x[4] = { { 1.0, 1.1, 1.2, 1.3 }, { 2.0, 2.1, 2.2, 2.3 },
+                 { 3.0, 3.1, 3.2, 3.3 }, { 4.0, 4.1, 4.2, 4.3 } };
+    const v4d m = { 0.999999, 0.999998, 0.999997, 0.999996 };
+    const v4d a = { 1e-6, 2e-6, 3e-6, 4e-6 };
+    while (!stop_interferer) {
+        for (int i = 0; i < 4096; i++) {
+            x[0] = x[0] * m + a;
+            x[1] = x[1] * m + a;
+            x[2] = x[2] * m + a;
+            x[3] = x[3] * m + a;
+        }
+    }
+    v4d s = x[0] + x[1] + x[2] + x[3];
+    fp_sink = s[0] + s[1] + s[2] + s[3];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_FP_AVX2 1
+__attribute__((target("avx2,fma")))
+static void kernel_fp_avx2(void) {
+    kernel_fp_body();
+}
+
+static int fp_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#endif
+
+static void kernel_fp(void) {
+#ifdef HAVE_FP_AVX2
+    if (fp_avx2()) {
+        kernel_fp_avx2();
+        return;
+    }
+#endif
+    kernel_fp_body();
+}
+
+static const char *fp_kernel_desc(void) {
+#ifdef HAVE_FP_AVX2
+    if (fp_avx2()) return "256-bit AVX2 FMA";
+#endif
+    return "128-bit SIMD multiply + add";
+}
+
+static void kernel_mem(void) {
+    size_t words = MEM_KERNEL_BYTES / sizeof(uint64_t);
+    uint64_t *w = (uint64_t *)mem_buf;
+    while (!stop_interferer) {
+        for (size_t i = 0; i < words && !stop_interferer; i += 8)
+            w[i]++;
+    }
+}
+
+static void* interferer_function(void *arg) {
+    int cpu = (int)(intptr_t)arg;
+    if (pin_self(cpu) != 0)
+        fprintf(stderr, "warning: could not pin interferer to CPU %d\n", cpu);
+    switch (interferer_kernel) {
+    case K_INT: kernel_int(); break;
+    case K_FP:  kernel_fp(); break;
+    case K_MEM: kernel_mem(); break;
+    default: break;
+    }
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs the probe for duration_ms; returns units/sec and fills percentiles
+static double run_probe(int probe_cpu, int duration_ms, long long *samples, long long pct[4]) {
+    if (pin_self(probe_cpu) != 0)
+        fprintf(stderr, "warning: could not pin probe to CPU %d\n", probe_cpu);
+    for (int i = 0; i < 1000; i++) probe_unit();
+
+    long n = 0;
+    long long start = now_ns(), end = start + duration_ms * 1000000LL, t = start;
+    while (t < end && n < MAX_SAMPLES) {
+        probe_unit();
+        long long t1 = now_ns();
+        samples[n++] = t1 - t;
+        t = t1;
+    }
+    qsort(samples, n, sizeof(long long), cmp_ll);
+    pct[0] = samples[n / 2];
+    pct[1] = samples[(long)(n * 0.99)];
+    pct[2] = samples[(long)(n * 0.999)];
+    pct[3] = samples[n - 1];
+    return n * 1e9 / (t - start);
+}
+
+static void run_pairing(int probe_cpu, int interferer_cpu, const char *placement, enum kernel k,
+                        int duration_ms, long long *samples, double *idle_rate) {
+    pthread_t tid;
+    interferer_kernel = k;
+    stop_interferer = 0;
+    int started = 0;
+    if (k != K_IDLE && interferer_cpu >= 0) {
+        if (pthread_create(&tid, NULL, interferer_function, (void *)(intptr_t)interferer_cpu) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+        started = 1;
+        // Let the interferer reach its steady state before measuring
+        struct timespec ts = { 0, 50000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    long long pct[4];
+    double rate = run_probe(probe_cpu, duration_ms, samples, pct);
+    stop_interferer = 1;
+    if (started) pthread_join(tid, NULL);
+
+    if (k == K_IDLE) *idle_rate = rate;
+    printf("%5d %5d %-8s %-5s %12.0f %8.1f%% %9.2f %9.2f %9.2f %10.2f\n",
+           probe_cpu, interferer_cpu, placement, kernel_names[k], rate,
+           *idle_rate > 0 ? 100.0 * (1.0 - rate / *idle_rate) : 0.0,
+           pct[0] / 1e3, pct[1] / 1e3, pct[2] / 1e3, pct[3] / 1e3);
+    fflush(stdout);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [duration_ms=%d] [idle|int|fp|mem|all] [first|all|probe_cpu,sibling_cpu[,other_cpu]]\n",
+            prog, DEFAULT_DURATION_MS);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int duration_ms = argc > 1 ? atoi(argv[1]) : DEFAULT_DURATION_MS;
+    if (duration_ms <= 0) duration_ms = DEFAULT_DURATION_MS;
+    int only = -1;
+    if (argc > 2 && strcmp(argv[2], "all") != 0) {
+        for (int i = 0; i < NUM_KERNELS; i++)
+            if (strcmp(argv[2], kernel_names[i]) == 0) only = i;
+        if (only < 0) usage(argv[0]);
+    }
+    const char *pair_arg = argc > 3 ? argv[3] : "first";
+
+    static cpu_pair_t pairs[MAX_CPUS];
+    int num_pairs = 0;
+    if (strcmp(pair_arg, "first") == 0 || strcmp(pair_arg, "all") == 0) {
+        num_pairs = discover_pairs(pairs, MAX_CPUS);
+        if (num_pairs == 0) {
+            printf("No SMT siblings found in /sys/devices/system/cpu topology; "
+                   "pass probe_cpu,sibling_cpu explicitly to test a chosen pair\n");
+            return 0;
+        }
+        if (strcmp(pair_arg, "first") == 0) num_pairs = 1;
+    } else {
+        int cpus[3] = { -1, -1, -1 };
+        int n = parse_list(pair_arg, cpus, 3);
+        if (n < 2) usage(argv[0]);
+        pairs[0].probe_cpu = cpus[0];
+        pairs[0].sibling_cpu = cpus[1];
+        pairs[0].other_cpu = n > 2 ? cpus[2] : -1;
+        num_pairs = 1;
+    }
+
+    mem_buf = malloc(MEM_KERNEL_BYTES);
+    long long *samples = malloc(MAX_SAMPLES * sizeof(long long));
+    if (!mem_buf || !samples) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    memset(mem_buf, 1, MEM_KERNEL_BYTES);
+    build_probe();
+
+    printf("SMT sibling interference (%d ms per run; probe = %d-step L1 pointer chase + integer mix)\n",
+           duration_ms, PROBE_STEPS);
+    printf("Slowdown is relative to an idle sibling; per-unit latency in us; fp load is %s\n",
+           fp_kernel_desc());
+    printf("%5s %5s %-8s %-5s %12s %9s %9s %9s %9s %10s\n", "probe", "intf", "place", "load",
+           "units/s", "slowdown", "p50", "p99", "p99.9", "max");
+
+    for (int p = 0; p < num_pairs; p++) {
+        double idle_rate = 0;
+        run_pairing(pairs[p].probe_cpu, pairs[p].sibling_cpu, "sibling", K_IDLE,
+                    duration_ms, samples, &idle_rate);
+        for (int k = K_INT; k < NUM_KERNELS; k++) {
+            if (only >= 0 && k != only) continue;
+            run_pairing(pairs[p].probe_cpu, pairs[p].sibling_cpu, "sibling", (enum kernel)k,
+                        duration_ms, samples, &idle_rate);
+            // Same kernel on another core separates SMT contention from shared-cache effects
+            if (pairs[p].other_cpu >= 0)
+                run_pairing(pairs[p].probe_cpu, pairs[p].other_cpu, "other", (enum kernel)k,
+                            duration_ms, samples, &idle_rate);
+        }
+    }
+
+    free(samples);
+    free(mem_buf);
+    free(probe_lines);
+    return 0;
+}
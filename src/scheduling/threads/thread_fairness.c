@@ -2,32 +2,91 @@
 #include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/resource.h>
 
-#define DEFAULT_NUM_THREADS 4
+#define DEFAULT_NUM_THREADS     4
+#define DEFAULT_RUN_SECONDS     5
+#define DEFAULT_SAMPLE_MS       100
+#define CACHE_LINE_SIZE         64
+#define STARVATION_FRACTION     0.10   // interval counts as starved below 10% of the fair share
 
 // Global flag used to signal threads to stop work
 volatile int stop = 0;
 
-// Structure to hold per-thread data
+// Structure to hold per-thread data. Each counter sits on its own cache line
+// so the workers do not false-share while incrementing.
 typedef struct {
+    volatile unsigned long iterations;
     int thread_id;
-    unsigned long iterations;
-} thread_data_t;
+    char pad[CACHE_LINE_SIZE - sizeof(unsigned long) - sizeof(int)];
+} __attribute__((aligned(CACHE_LINE_SIZE))) thread_data_t;
+
+typedef struct {
+    thread_data_t *workers;
+    int num_threads;
+    int sample_ms;
+    int max_samples;
+    int num_samples;
+    unsigned long *snapshots;   // max_samples x num_threads cumulative counts
+} sampler_t;
 
 void* thread_function(void* arg) {
     thread_data_t *data = (thread_data_t *)arg;
+    unsigned long local = 0;
     // Loop until the global stop flag is set
     while (!stop) {
-        data->iterations++;
+        data->iterations = ++local;
+    }
+    pthread_exit(NULL);
+}
+
+void* sampler_function(void* arg) {
+    sampler_t *s = (sampler_t *)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!stop && s->num_samples < s->max_samples) {
+        next.tv_nsec += (long)s->sample_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        unsigned long *row = &s->snapshots[(size_t)s->num_samples * s->num_threads];
+        for (int i = 0; i < s->num_threads; i++)
+            row[i] = s->workers[i].iterations;
+        s->num_samples++;
     }
     pthread_exit(NULL);
 }
 
+// Jain's fairness index: 1.0 when all shares are equal, 1/n when one worker gets everything
+double jain_index(const double *x, int n) {
+    double sum = 0.0, sum_sq = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i];
+        sum_sq += x[i] * x[i];
+    }
+    return sum_sq > 0.0 ? (sum * sum) / (n * sum_sq) : 1.0;
+}
+
+double coeff_of_variation(const double *x, int n) {
+    double mean = 0.0, var = 0.0;
+    for (int i = 0; i < n; i++) mean += x[i];
+    mean /= n;
+    for (int i = 0; i < n; i++) var += (x[i] - mean) * (x[i] - mean);
+    var /= n;
+    return mean > 0.0 ? sqrt(var) / mean : 0.0;
+}
+
 int main(int argc, char *argv[]) {
-#ifdef __linux__  
+#ifdef __linux__
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
     CPU_SET(0, &cpuset);
@@ -41,7 +100,7 @@ int main(int argc, char *argv[]) {
     // Set both soft and hard limits to 512 MB.
     mem_limit.rlim_cur = 512UL * 1024 * 1024;
     mem_limit.rlim_max = 512UL * 1024 * 1024;
-    
+
     if (setrlimit(RLIMIT_AS, &mem_limit) != 0) {
         perror("setrlimit");
         exit(EXIT_FAILURE);
@@ -49,8 +108,10 @@ int main(int argc, char *argv[]) {
 #endif
 
     int num_threads = DEFAULT_NUM_THREADS;
-    
-    // Allow the number of threads to be specified via command line argument
+    int run_seconds = DEFAULT_RUN_SECONDS;
+    int sample_ms = DEFAULT_SAMPLE_MS;
+
+    // Optional command line parameters: number of threads, run time, sample interval
     if (argc > 1) {
         num_threads = atoi(argv[1]);
         if (num_threads <= 0) {
@@ -58,41 +119,118 @@ int main(int argc, char *argv[]) {
             num_threads = DEFAULT_NUM_THREADS;
         }
     }
+    if (argc > 2) {
+        run_seconds = atoi(argv[2]);
+        if (run_seconds <= 0) run_seconds = DEFAULT_RUN_SECONDS;
+    }
+    if (argc > 3) {
+        sample_ms = atoi(argv[3]);
+        if (sample_ms <= 0) sample_ms = DEFAULT_SAMPLE_MS;
+    }
 
-    // Allocate memory for thread handles and their data
+    // Allocate memory for thread handles and their cache-line aligned data
     pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
-    thread_data_t *thread_data = malloc(num_threads * sizeof(thread_data_t));
-    if (!threads || !thread_data) {
+    thread_data_t *thread_data = NULL;
+    if (posix_memalign((void **)&thread_data, CACHE_LINE_SIZE, num_threads * sizeof(thread_data_t)) != 0)
+        thread_data = NULL;
+    sampler_t sampler = {
+        .workers = thread_data,
+        .num_threads = num_threads,
+        .sample_ms = sample_ms,
+        .max_samples = run_seconds * 1000 / sample_ms + 1,
+        .num_samples = 0
+    };
+    sampler.snapshots = calloc((size_t)sampler.max_samples * num_threads, sizeof(unsigned long));
+    if (!threads || !thread_data || !sampler.snapshots) {
         perror("malloc");
         exit(EXIT_FAILURE);
     }
 
     // Create the threads
     for (int i = 0; i < num_threads; i++) {
+        memset(&thread_data[i], 0, sizeof(thread_data_t));
         thread_data[i].thread_id = i;
-        thread_data[i].iterations = 0;
         if (pthread_create(&threads[i], NULL, thread_function, (void*)&thread_data[i]) != 0) {
             perror("pthread_create");
             exit(EXIT_FAILURE);
         }
     }
 
-    // Let the threads run for 5 seconds
-    // make this configurable
-    sleep(5);
+    // The sampler sleeps between snapshots, so it only steals a sliver of CPU
+    pthread_t sampler_thread;
+    if (pthread_create(&sampler_thread, NULL, sampler_function, &sampler) != 0) {
+        perror("pthread_create (sampler)");
+        exit(EXIT_FAILURE);
+    }
+
+    sleep(run_seconds);
     stop = 1;
 
     // Wait for all threads to finish
+    pthread_join(sampler_thread, NULL);
     for (int i = 0; i < num_threads; i++) {
         pthread_join(threads[i], NULL);
     }
 
+    // Per-interval progress, fairness over time and starvation streaks
+    double *delta = malloc(num_threads * sizeof(double));
+    int *starved = calloc(num_threads, sizeof(int));
+    int *streak = calloc(num_threads, sizeof(int));
+    int *longest = calloc(num_threads, sizeof(int));
+    if (!delta || !starved || !streak || !longest) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Fairness over time (%d ms intervals):\n", sample_ms);
+    printf("%8s %8s %8s\n", "t_ms", "jain", "cov");
+    for (int s = 0; s < sampler.num_samples; s++) {
+        double total = 0.0;
+        for (int i = 0; i < num_threads; i++) {
+            unsigned long cur = sampler.snapshots[(size_t)s * num_threads + i];
+            unsigned long prev = s > 0 ? sampler.snapshots[(size_t)(s - 1) * num_threads + i] : 0;
+            delta[i] = (double)(cur - prev);
+            total += delta[i];
+        }
+        double fair_share = total / num_threads;
+        for (int i = 0; i < num_threads; i++) {
+            if (delta[i] < STARVATION_FRACTION * fair_share) {
+                starved[i]++;
+                if (++streak[i] > longest[i]) longest[i] = streak[i];
+            } else {
+                streak[i] = 0;
+            }
+        }
+        printf("%8d %8.4f %8.4f\n", (s + 1) * sample_ms,
+               jain_index(delta, num_threads), coeff_of_variation(delta, num_threads));
+    }
+
     // Report the results
-    printf("Thread Fairness Test Results (2 seconds run):\n");
+    unsigned long min = thread_data[0].iterations, max = min, sum = 0;
+    for (int i = 0; i < num_threads; i++) {
+        unsigned long it = thread_data[i].iterations;
+        delta[i] = (double)it;
+        if (it < min) min = it;
+        if (it > max) max = it;
+        sum += it;
+    }
+
+    printf("\nThread Fairness Test Results (%d seconds run):\n", run_seconds);
     for (int i = 0; i < num_threads; i++) {
-        printf("Thread %d: %lu iterations\n", thread_data[i].thread_id, thread_data[i].iterations);
+        printf("Thread %d: %lu iterations (%.2f%%), starved %d/%d intervals, longest starvation %d ms\n",
+               thread_data[i].thread_id, thread_data[i].iterations,
+               sum ? 100.0 * thread_data[i].iterations / sum : 0.0,
+               starved[i], sampler.num_samples, longest[i] * sample_ms);
     }
+    printf("Min: %lu, Max: %lu, Avg: %.0f\n", min, max, (double)sum / num_threads);
+    printf("Jain's fairness index: %.4f\n", jain_index(delta, num_threads));
+    printf("Coefficient of variation: %.4f\n", coeff_of_variation(delta, num_threads));
 
+    free(delta);
+    free(starved);
+    free(streak);
+    free(longest);
+    free(sampler.snapshots);
     free(threads);
     free(thread_data);
     return 0;
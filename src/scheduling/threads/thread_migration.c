@@ -0,0 +1,338 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define DEFAULT_WS_KB        1024
+#define DEFAULT_FREQS_MS     "1,10,100"
+#define DEFAULT_DURATION_S   3
+#define CACHE_LINE_SIZE      64
+#define RECOVERED_RATIO      1.10   // chunk within 10% of baseline counts as warm again
+#define MAX_TARGETS          8
+#define MAX_MIGRATIONS       100000
+
+typedef struct {
+    void *next;
+    char pad[CACHE_LINE_SIZE - sizeof(void *)];
+} cache_line_t;
+
+typedef struct {
+    char label[24];
+    int cpu;
+} target_t;
+
+static cache_line_t *lines;
+static size_t num_lines;
+static size_t chunk_steps;
+static void *chase_pos;
+static void * volatile sink;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+}
+
+// Links every line into one random cycle so the hardware prefetcher cannot help
+static void build_chase(size_t ws_bytes) {
+    num_lines = ws_bytes / CACHE_LINE_SIZE;
+    if (num_lines < 2) num_lines = 2;
+    if (posix_memalign((void **)&lines, CACHE_LINE_SIZE, num_lines * sizeof(cache_line_t)) != 0) {
+        perror("posix_memalign");
+        exit(EXIT_FAILURE);
+    }
+    size_t *order = malloc(num_lines * sizeof(size_t));
+    if (!order) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < num_lines; i++) order[i] = i;
+    unsigned int seed = 42;
+    for (size_t i = num_lines - 1; i > 0; i--) {
+        size_t j = (size_t)rand_r(&seed) % (i + 1);
+        size_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for (size_t i = 0; i < num_lines; i++)
+        lines[order[i]].next = &lines[order[(i + 1) % num_lines]];
+    chase_pos = &lines[order[0]];
+    free(order);
+
+    // Resolution: 1/16 of a full pass, but never so short that timer overhead dominates
+    chunk_steps = num_lines / 16;
+    if (chunk_steps < 1024) chunk_steps = 1024;
+}
+
+static long long run_chunk(void) {
+    void *p = chase_pos;
+    long long t0 = now_ns();
+    for (size_t i = 0; i < chunk_steps; i++)
+        p = *(void **)p;
+    long long dt = now_ns() - t0;
+    chase_pos = p;
+    sink = p;
+    return dt;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Median chunk time while pinned to `cpu` with a warm cache
+static long long measure_baseline(int cpu, long long duration_ns) {
+    pin_self(cpu);
+    for (size_t i = 0; i < 32; i++) run_chunk();
+
+    size_t cap = 1 << 16, n = 0;
+    long long *t = malloc(cap * sizeof(long long));
+    if (!t) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    long long start = now_ns();
+    while (now_ns() - start < duration_ns && n < cap)
+        t[n++] = run_chunk();
+    qsort(t, n, sizeof(long long), cmp_ll);
+    long long median = t[n / 2];
+    free(t);
+    return median;
+}
+
+#ifdef __linux__
+static int read_int_file(const char *path, int *value) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int ok = fscanf(fp, "%d", value) == 1;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+static int parse_cpu_list_into(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p) break;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++) CPU_SET(c, set);
+        p = *end == ',' ? end + 1 : end;
+        if (*p == '\n') break;
+    }
+    return 0;
+}
+
+// CPUs sharing the given cache level with `cpu`
+static int cache_sharers(int cpu, int level, cpu_set_t *set) {
+    char path[128], buf[1024];
+    for (int idx = 0; idx < 8; idx++) {
+        int lvl;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, idx);
+        if (read_int_file(path, &lvl) != 0) break;
+        if (lvl != level) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, idx);
+        FILE *fp = fopen(path, "r");
+        if (!fp) return -1;
+        int ok = fgets(buf, sizeof(buf), fp) != NULL;
+        fclose(fp);
+        if (!ok) return -1;
+        return parse_cpu_list_into(buf, set);
+    }
+    return -1;
+}
+
+static int package_of(int cpu) {
+    char path[128];
+    int pkg = -1;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    read_int_file(path, &pkg);
+    return pkg;
+}
+
+// Picks one CPU per relationship class from sysfs topology
+static int discover_targets(int src, target_t *targets) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t l2, llc;
+    int have_l2 = cache_sharers(src, 2, &l2) == 0;
+    int have_llc = cache_sharers(src, 3, &llc) == 0;
+    if (!have_llc && have_l2) { llc = l2; have_llc = 1; }
+    int src_pkg = package_of(src);
+    int same_l2 = -1, same_llc = -1, cross_llc = -1, cross_socket = -1;
+
+    for (int c = 0; c < ncpu; c++) {
+        if (c == src) continue;
+        int pkg = package_of(c);
+        int in_l2 = have_l2 && CPU_ISSET(c, &l2);
+        int in_llc = have_llc && CPU_ISSET(c, &llc);
+        if (in_l2 && same_l2 < 0) same_l2 = c;
+        else if (!in_l2 && in_llc && same_llc < 0) same_llc = c;
+        else if (!in_llc && pkg == src_pkg && cross_llc < 0) cross_llc = c;
+        else if (pkg != src_pkg && cross_socket < 0) cross_socket = c;
+    }
+
+    int n = 0;
+    const char *labels[] = { "same_l2", "same_llc", "cross_llc", "cross_socket" };
+    int cpus[] = { same_l2, same_llc, cross_llc, cross_socket };
+    for (int i = 0; i < 4; i++) {
+        if (cpus[i] < 0) {
+            printf("  %-12s no CPU found relative to CPU %d\n", labels[i], src);
+            continue;
+        }
+        snprintf(targets[n].label, sizeof(targets[n].label), "%s", labels[i]);
+        targets[n].cpu = cpus[i];
+        printf("  %-12s CPU %d\n", labels[i], cpus[i]);
+        n++;
+    }
+    return n;
+}
+#endif
+
+static void run_migration(const target_t *t, int src, long long freq_ns, long long duration_ns,
+                          long long *first, long long *recover) {
+    // Fresh baseline right before each run so clock/thermal drift does not leak into the ratio
+    long long baseline = measure_baseline(src, duration_ns / 4 > 200000000LL ? duration_ns / 4 : 200000000LL);
+
+    int on_src = 1, recovering = 0, first_pending = 0;
+    long migrations = 0, unrecovered = 0, nfirst = 0, nrecover = 0;
+    unsigned long long steps = 0;
+    long long mig_time = 0;
+    long long start = now_ns(), next_mig = start + freq_ns, now = start;
+
+    while (now - start < duration_ns) {
+        if (now >= next_mig) {
+            if (recovering) unrecovered++;
+            pin_self(on_src ? t->cpu : src);
+            on_src = !on_src;
+            migrations++;
+            mig_time = now_ns();
+            recovering = first_pending = 1;
+            next_mig += freq_ns;
+            if (next_mig < now) next_mig = now + freq_ns;
+        }
+        long long dt = run_chunk();
+        steps += chunk_steps;
+        now = now_ns();
+        if (recovering) {
+            if (first_pending && nfirst < MAX_MIGRATIONS) {
+                first[nfirst++] = dt;
+                first_pending = 0;
+            }
+            if (dt <= baseline * RECOVERED_RATIO) {
+                if (nrecover < MAX_MIGRATIONS) recover[nrecover++] = now - mig_time;
+                recovering = 0;
+            }
+        }
+    }
+    long long elapsed = now - start;
+    double rel = (double)steps / elapsed / ((double)chunk_steps / baseline);
+
+    qsort(first, nfirst, sizeof(long long), cmp_ll);
+    qsort(recover, nrecover, sizeof(long long), cmp_ll);
+    printf("%-12s %4d %8.1f %9.1f %6ld %8.1f %8.2f %8.2f %9.1f %9.1f %7ld\n",
+           t->label, t->cpu, freq_ns / 1e6, baseline / 1e3, migrations, 100.0 * rel,
+           nfirst ? (double)first[nfirst / 2] / baseline : 0.0,
+           nfirst ? (double)first[(long)(nfirst * 0.9)] / baseline : 0.0,
+           nrecover ? recover[nrecover / 2] / 1e3 : 0.0,
+           nrecover ? recover[(long)(nrecover * 0.9)] / 1e3 : 0.0,
+           unrecovered);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        fprintf(stderr, "Usage: %s [working_set_kb=%d] [migrate_every_ms_list=%s] [src_cpu=0] "
+                "[duration_s=%d] [target_cpu_list]\n",
+                argv[0], DEFAULT_WS_KB, DEFAULT_FREQS_MS, DEFAULT_DURATION_S);
+        return EXIT_FAILURE;
+    }
+
+    long ws_kb = argc > 1 && atol(argv[1]) > 0 ? atol(argv[1]) : DEFAULT_WS_KB;
+    const char *freqs = argc > 2 ? argv[2] : DEFAULT_FREQS_MS;
+    int src = argc > 3 ? atoi(argv[3]) : 0;
+    int duration_s = argc > 4 && atoi(argv[4]) > 0 ? atoi(argv[4]) : DEFAULT_DURATION_S;
+    long long duration_ns = duration_s * 1000000000LL;
+
+    if (pin_self(src) != 0) {
+        fprintf(stderr, "Cannot pin to source CPU %d: %s\n", src, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    target_t targets[MAX_TARGETS];
+    int num_targets = 0;
+    printf("Migration targets relative to CPU %d:\n", src);
+    if (argc > 5) {
+        // Explicit targets, e.g. "1,8,32"
+        for (const char *p = argv[5]; *p && num_targets < MAX_TARGETS; ) {
+            targets[num_targets].cpu = atoi(p);
+            snprintf(targets[num_targets].label, sizeof(targets[num_targets].label), "cpu%d",
+                     targets[num_targets].cpu);
+            printf("  %-12s CPU %d\n", targets[num_targets].label, targets[num_targets].cpu);
+            num_targets++;
+            p = strchr(p, ',');
+            if (!p) break;
+            p++;
+        }
+    } else {
+#ifdef __linux__
+        num_targets = discover_targets(src, targets);
+#else
+        printf("  no sysfs topology on this OS; pass target CPUs explicitly\n");
+#endif
+    }
+    if (num_targets == 0) {
+        printf("No migration targets; nothing to measure.\n");
+        return 0;
+    }
+
+    build_chase((size_t)ws_kb * 1024);
+    long long *first = malloc(MAX_MIGRATIONS * sizeof(long long));
+    long long *recover = malloc(MAX_MIGRATIONS * sizeof(long long));
+    if (!first || !recover) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("\nWorking set %ld KB, %zu-step chunks, source CPU %d\n", ws_kb, chunk_steps, src);
+    printf("slowdown = first chunk after a migration / baseline; recover = time until a chunk is within %.0f%% of baseline\n",
+           (RECOVERED_RATIO - 1.0) * 100);
+    printf("baseline = median us/chunk pinned to the source CPU, measured before each run\n");
+    printf("%-12s %4s %8s %9s %6s %8s %8s %8s %9s %9s %7s\n",
+           "class", "cpu", "every_ms", "baseline", "migs", "thru%", "slow_p50", "slow_p90",
+           "rec_p50us", "rec_p90us", "unrecov");
+
+    for (int t = 0; t < num_targets; t++) {
+        for (const char *p = freqs; *p; ) {
+            double ms = atof(p);
+            if (ms > 0)
+                run_migration(&targets[t], src, (long long)(ms * 1e6), duration_ns, first, recover);
+            p = strchr(p, ',');
+            if (!p) break;
+            p++;
+        }
+    }
+
+    free(first);
+    free(recover);
+    free(lines);
+    return 0;
+}
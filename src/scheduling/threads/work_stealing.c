@@ -0,0 +1,518 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __QNX__
+  #include <sys/neutrino.h>
+#endif
+
+#define CACHE_LINE_SIZE      64
+#define DEFAULT_GRAINS       "0,1000,10000"
+#define DEFAULT_FJ_DEPTH     18          // 2^19 - 1 tasks
+#define DAG_WIDTH            1024
+#define MAX_THREADS          256
+#define DEQUE_CAPACITY       (1 << 16)   // per worker; a full deque runs the task inline
+#define SPIN_ROUNDS          64          // idle steal rounds before yielding
+#define YIELD_ROUNDS         16          // then yields before parking
+#define PARK_TIMEOUT_NS      1000000L    // bounds the cost of a missed wakeup
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+  #define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+  #define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+enum pool_kind { POOL_WS, POOL_MUTEX, NUM_POOLS };
+enum workload { WL_FORK_JOIN, WL_DAG, NUM_WORKLOADS };
+
+static const char *pool_names[NUM_POOLS] = { "ws", "mutex" };
+static const char *workload_names[NUM_WORKLOADS] = { "fj", "dag" };
+
+// Tasks are preallocated per run. Fork-join uses heap numbering (children of
+// k are 2k+1 and 2k+2); the DAG is DAG_WIDTH nodes per layer, each depending
+// on two nodes of the previous layer.
+typedef struct task {
+    struct task *parent;
+    int depth;
+    int pending;        // fork-join: children outstanding; DAG: unmet dependencies
+    long result;
+    long index;
+} task_t;
+
+// Chase-Lev work-stealing deque: the owner pushes and takes at the bottom,
+// thieves steal from the top (Le et al., "Correct and Efficient Work-Stealing
+// for Weak Memory Models", 2013).
+typedef struct {
+    long top __attribute__((aligned(CACHE_LINE_SIZE)));
+    long bottom __attribute__((aligned(CACHE_LINE_SIZE)));
+    task_t **buf;
+} deque_t;
+
+typedef struct {
+    int id;
+    int cpu;
+    unsigned int rng;
+    deque_t deque;
+    unsigned long executed;
+    unsigned long steal_attempts;
+    unsigned long steals;
+    unsigned long parks;
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_t;
+
+static enum pool_kind pool;
+static enum workload workload;
+static int num_workers;
+static worker_t *workers;
+static task_t *tasks;
+static long num_tasks;
+static int fj_depth = DEFAULT_FJ_DEPTH;
+static int dag_layers;
+static unsigned long grain_loops;
+static double loops_per_ns;
+
+static volatile int done;
+static long long finish_ns;
+static long sinks_remaining;
+static pthread_barrier_t start_barrier;
+
+// Idle parking shared by both pools
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static int sleepers;
+
+// Global FIFO for the mutex pool; sized so it can never overflow
+static task_t **queue;
+static long queue_mask, queue_head, queue_tail;
+
+static inline long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pin_self(int cpu) {
+#ifdef __QNX__
+    return ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)(1u << cpu)) == -1 ? -1 : 0;
+#else
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+static inline void spin_work(unsigned long loops) {
+    for (volatile unsigned long i = 0; i < loops; i++)
+        ;
+}
+
+static void calibrate_work(void) {
+    unsigned long loops = 1000000;
+    long long t0 = now_ns();
+    spin_work(loops);
+    long long dt = now_ns() - t0;
+    loops_per_ns = dt > 0 ? (double)loops / dt : 1.0;
+}
+
+static int deque_push(deque_t *d, task_t *t) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (b - top >= DEQUE_CAPACITY) return -1;
+    __atomic_store_n(&d->buf[b & (DEQUE_CAPACITY - 1)], t, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static task_t *deque_take(deque_t *d) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    task_t *t = NULL;
+    if (top <= b) {
+        t = __atomic_load_n(&d->buf[b & (DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+        if (top == b) {
+            // Last element: race the thieves for it
+            if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, 0,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                t = NULL;
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return t;
+}
+
+static task_t *deque_steal(deque_t *d) {
+    long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (top >= b) return NULL;
+    task_t *t = __atomic_load_n(&d->buf[top & (DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+    return t;
+}
+
+static int work_visible(void) {
+    if (pool == POOL_MUTEX)
+        return queue_head != queue_tail;
+    for (int i = 0; i < num_workers; i++) {
+        deque_t *d = &workers[i].deque;
+        if (__atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE) >
+            __atomic_load_n(&d->top, __ATOMIC_ACQUIRE))
+            return 1;
+    }
+    return 0;
+}
+
+// Wakes one parked worker. Sleepers are read without the lock, so a worker
+// that is just about to park can be missed; the park timeout bounds that.
+static void notify_one(void) {
+    if (__atomic_load_n(&sleepers, __ATOMIC_ACQUIRE) == 0) return;
+    pthread_mutex_lock(&idle_lock);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+static void finish_run(void) {
+    finish_ns = now_ns();
+    pthread_mutex_lock(&idle_lock);
+    done = 1;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+static void run_task(worker_t *w, task_t *t);
+
+static void spawn(worker_t *w, task_t *t) {
+    if (pool == POOL_WS) {
+        if (deque_push(&w->deque, t) != 0) {
+            run_task(w, t);
+            return;
+        }
+        notify_one();
+    } else {
+        pthread_mutex_lock(&idle_lock);
+        queue[queue_tail++ & queue_mask] = t;
+        if (sleepers > 0)
+            pthread_cond_signal(&idle_cond);
+        pthread_mutex_unlock(&idle_lock);
+    }
+}
+
+// Fork-join completion: fold the result into the parent and complete it
+// too once its last child is in, all the way up to the root.
+static void fj_complete(task_t *t) {
+    for (;;) {
+        task_t *p = t->parent;
+        if (!p) {
+            finish_run();
+            return;
+        }
+        __atomic_add_fetch(&p->result, t->result, __ATOMIC_RELAXED);
+        if (__atomic_sub_fetch(&p->pending, 1, __ATOMIC_ACQ_REL) != 0)
+            return;
+        t = p;
+    }
+}
+
+static void dag_complete(worker_t *w, task_t *t) {
+    long layer = t->index / DAG_WIDTH, col = t->index % DAG_WIDTH;
+    if (layer == dag_layers - 1) {
+        if (__atomic_sub_fetch(&sinks_remaining, 1, __ATOMIC_ACQ_REL) == 0)
+            finish_run();
+        return;
+    }
+    // Successors are (layer+1, col) and (layer+1, col - stride): the inverse
+    // of the two dependencies set up in init_dag().
+    long stride = DAG_WIDTH / 2 + 1;
+    long next = (layer + 1) * DAG_WIDTH;
+    task_t *s1 = &tasks[next + col];
+    task_t *s2 = &tasks[next + (col - stride + DAG_WIDTH) % DAG_WIDTH];
+    if (__atomic_sub_fetch(&s1->pending, 1, __ATOMIC_ACQ_REL) == 0) spawn(w, s1);
+    if (__atomic_sub_fetch(&s2->pending, 1, __ATOMIC_ACQ_REL) == 0) spawn(w, s2);
+}
+
+static void run_task(worker_t *w, task_t *t) {
+    w->executed++;
+    if (workload == WL_FORK_JOIN) {
+        if (t->depth > 0) {
+            task_t *l = &tasks[2 * t->index + 1], *r = &tasks[2 * t->index + 2];
+            l->index = 2 * t->index + 1;
+            r->index = 2 * t->index + 2;
+            l->parent = r->parent = t;
+            l->depth = r->depth = t->depth - 1;
+            t->pending = 2;
+            spawn(w, r);
+            spawn(w, l);
+            return;
+        }
+        spin_work(grain_loops);
+        t->result = 1;
+        fj_complete(t);
+    } else {
+        spin_work(grain_loops);
+        dag_complete(w, t);
+    }
+}
+
+static task_t *ws_find_task(worker_t *w) {
+    task_t *t = deque_take(&w->deque);
+    if (t || num_workers == 1) return t;
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 17;
+    w->rng ^= w->rng << 5;
+    int start = (int)(w->rng % num_workers);
+    for (int i = 0; i < num_workers; i++) {
+        int v = (start + i) % num_workers;
+        if (v == w->id) continue;
+        w->steal_attempts++;
+        t = deque_steal(&workers[v].deque);
+        if (t) {
+            w->steals++;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void park(worker_t *w) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += PARK_TIMEOUT_NS;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&idle_lock);
+    __atomic_add_fetch(&sleepers, 1, __ATOMIC_ACQ_REL);
+    if (!done && !work_visible()) {
+        w->parks++;
+        pthread_cond_timedwait(&idle_cond, &idle_lock, &ts);
+    }
+    __atomic_sub_fetch(&sleepers, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+static task_t *mutex_find_task(worker_t *w) {
+    task_t *t = NULL;
+    pthread_mutex_lock(&idle_lock);
+    while (queue_head == queue_tail && !done) {
+        sleepers++;
+        w->parks++;
+        pthread_cond_wait(&idle_cond, &idle_lock);
+        sleepers--;
+    }
+    if (queue_head != queue_tail)
+        t = queue[queue_head++ & queue_mask];
+    pthread_mutex_unlock(&idle_lock);
+    return t;
+}
+
+static void* worker_function(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    if (pin_self(w->cpu) != 0)
+        fprintf(stderr, "warning: could not pin worker %d to CPU %d\n", w->id, w->cpu);
+    pthread_barrier_wait(&start_barrier);
+
+    int idle = 0;
+    while (!done) {
+        task_t *t = pool == POOL_WS ? ws_find_task(w) : mutex_find_task(w);
+        if (t) {
+            run_task(w, t);
+            idle = 0;
+            continue;
+        }
+        if (pool == POOL_MUTEX) continue;
+        // Spin, then yield, then park: how long a worker stays hot decides
+        // how much the kernel's wakeup path shows up in the result
+        if (++idle < SPIN_ROUNDS)
+            cpu_relax();
+        else if (idle < SPIN_ROUNDS + YIELD_ROUNDS)
+            sched_yield();
+        else
+            park(w);
+    }
+    return NULL;
+}
+
+// Node (l, c) depends on (l-1, c) and (l-1, (c + stride) % DAG_WIDTH); only
+// the counts are stored, dag_complete() walks the edges the other way.
+static void init_dag(void) {
+    for (long i = 0; i < num_tasks; i++) {
+        tasks[i].index = i;
+        tasks[i].pending = i < DAG_WIDTH ? 0 : 2;
+    }
+    sinks_remaining = DAG_WIDTH;
+}
+
+// Returns tasks/sec; the per-worker counters are left in workers[]
+static double run_config(int nthreads, int ncpus) {
+    num_workers = nthreads;
+    memset(tasks, 0, num_tasks * sizeof(task_t));
+    memset(workers, 0, nthreads * sizeof(worker_t));
+    queue_head = queue_tail = 0;
+    done = 0;
+    sleepers = 0;
+
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].id = i;
+        workers[i].cpu = i % ncpus;
+        workers[i].rng = 0x9e3779b9u * (i + 1);
+        workers[i].deque.buf = calloc(DEQUE_CAPACITY, sizeof(task_t *));
+        if (!workers[i].deque.buf) {
+            perror("calloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Seed the run before any worker exists, so single-threaded pushes are safe
+    if (workload == WL_FORK_JOIN) {
+        tasks[0].depth = fj_depth;
+        spawn(&workers[0], &tasks[0]);
+    } else {
+        init_dag();
+        for (long i = 0; i < DAG_WIDTH; i++)
+            spawn(&workers[i % nthreads], &tasks[i]);
+    }
+
+    pthread_t *tids = malloc(nthreads * sizeof(pthread_t));
+    if (!tids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&tids[i], NULL, worker_function, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    // Timed from the release of the workers to the completion of the last
+    // task, so neither thread startup nor teardown is counted
+    long long start = now_ns();
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    long long elapsed = finish_ns - start;
+    pthread_barrier_destroy(&start_barrier);
+    free(tids);
+    for (int i = 0; i < nthreads; i++)
+        free(workers[i].deque.buf);
+
+    if (workload == WL_FORK_JOIN && tasks[0].result != (1L << fj_depth))
+        fprintf(stderr, "fork-join result %ld, expected %ld\n", tasks[0].result, 1L << fj_depth);
+    return num_tasks * 1e9 / elapsed;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [ws|mutex|all] [fj|dag|all] [grain_ns_list=%s] "
+            "[max_threads=ncpus] [fj_depth=%d]\n", prog, DEFAULT_GRAINS, DEFAULT_FJ_DEPTH);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int only_pool = -1, only_wl = -1;
+    if (argc > 1 && strcmp(argv[1], "all") != 0) {
+        for (int i = 0; i < NUM_POOLS; i++)
+            if (strcmp(argv[1], pool_names[i]) == 0) only_pool = i;
+        if (only_pool < 0) usage(argv[0]);
+    }
+    if (argc > 2 && strcmp(argv[2], "all") != 0) {
+        for (int i = 0; i < NUM_WORKLOADS; i++)
+            if (strcmp(argv[2], workload_names[i]) == 0) only_wl = i;
+        if (only_wl < 0) usage(argv[0]);
+    }
+    const char *grains = argc > 3 ? argv[3] : DEFAULT_GRAINS;
+    int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    int max_threads = argc > 4 ? atoi(argv[4]) : ncpus;
+    if (max_threads <= 0) max_threads = ncpus;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    if (argc > 5) {
+        fj_depth = atoi(argv[5]);
+        if (fj_depth < 1 || fj_depth > 26) fj_depth = DEFAULT_FJ_DEPTH;
+    }
+    // The DAG gets roughly as many tasks as the fork-join tree
+    dag_layers = (int)(((2L << fj_depth) - 1) / DAG_WIDTH);
+    if (dag_layers < 2) dag_layers = 2;
+
+    long max_tasks = (2L << fj_depth) - 1;
+    if ((long)dag_layers * DAG_WIDTH > max_tasks) max_tasks = (long)dag_layers * DAG_WIDTH;
+    tasks = malloc(max_tasks * sizeof(task_t));
+    queue_mask = 1;
+    while (queue_mask < max_tasks) queue_mask <<= 1;
+    queue = malloc(queue_mask * sizeof(task_t *));
+    queue_mask--;
+    if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, max_threads * sizeof(worker_t)) != 0 ||
+        !tasks || !queue) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    calibrate_work();
+    printf("Task pool scaling (%d CPUs; fj depth %d = %ld tasks, dag %d x %d)\n",
+           ncpus, fj_depth, (2L << fj_depth) - 1, dag_layers, DAG_WIDTH);
+    printf("%-6s %-4s %8s %7s %12s %8s %12s %8s %10s\n", "pool", "wl", "grain_ns", "threads",
+           "tasks/s", "speedup", "steals/s", "steal%", "parks");
+
+    for (int p = 0; p < NUM_POOLS; p++) {
+        if (only_pool >= 0 && p != only_pool) continue;
+        pool = (enum pool_kind)p;
+        for (int wl = 0; wl < NUM_WORKLOADS; wl++) {
+            if (only_wl >= 0 && wl != only_wl) continue;
+            workload = (enum workload)wl;
+            num_tasks = workload == WL_FORK_JOIN ? (2L << fj_depth) - 1 : (long)dag_layers * DAG_WIDTH;
+
+            for (const char *g = grains; *g; ) {
+                long grain_ns = atol(g);
+                grain_loops = grain_ns > 0 ? (unsigned long)(grain_ns * loops_per_ns) : 0;
+                double base = 0;
+                for (int t = 1; ; t *= 2) {
+                    if (t > max_threads) t = max_threads;
+                    double rate = run_config(t, ncpus);
+                    if (t == 1) base = rate;
+
+                    unsigned long steals = 0, attempts = 0, parks = 0;
+                    for (int i = 0; i < t; i++) {
+                        steals += workers[i].steals;
+                        attempts += workers[i].steal_attempts;
+                        parks += workers[i].parks;
+                    }
+                    double seconds = num_tasks / rate;
+                    if (pool == POOL_WS)
+                        printf("%-6s %-4s %8ld %7d %12.0f %8.2f %12.0f %7.2f%% %10lu\n",
+                               pool_names[p], workload_names[wl], grain_ns, t, rate, rate / base,
+                               steals / seconds, attempts ? 100.0 * steals / attempts : 0.0, parks);
+                    else
+                        printf("%-6s %-4s %8ld %7d %12.0f %8.2f %12s %8s %10lu\n",
+                               pool_names[p], workload_names[wl], grain_ns, t, rate, rate / base,
+                               "-", "-", parks);
+                    fflush(stdout);
+                    if (t == max_threads) break;
+                }
+                g = strchr(g, ',');
+                if (!g) break;
+                g++;
+            }
+        }
+    }
+
+    free(queue);
+    free(tasks);
+    free(workers);
+    return 0;
+}